@@ -0,0 +1,142 @@
+/*******************************************************************************
+ *
+ * File: ReplayBench.cpp
+ *	Replays a packet capture into a UdpValueTable and reports how fast the
+ *	table took it
+ *
+ *	usage: ReplayBench [-r] [-i] capture_file [repeat_count]
+ *
+ *	The capture is one made by a table with the capture XML attribute.  It
+ *	is fed to a table with the replay XML attribute through
+ *	UdpValueTableReplay, so it goes through the same decoding, buffering and
+ *	apply path as live packets.  By default it is replayed as fast as the
+ *	table takes it repeat_count times (default 5) and the best and mean
+ *	packets per second are printed.  With -r it is replayed once with the
+ *	timing of the capture.  -i sets use_ids on the table, which must match
+ *	the table that was captured.
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gsi/Thread.h"
+
+#include "gsu/UdpValueTable.h"
+#include "gsu/UdpValueTableReplay.h"
+
+using namespace gsi;
+using namespace gsu;
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+static int usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-r] [-i] capture_file [repeat_count]\n", name);
+	fprintf(stderr, "    -r    replay with the timing of the capture\n");
+	fprintf(stderr, "    -i    the captured table used IDs (use_ids)\n");
+	return 1;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+int main(int argc, char **argv)
+{
+	bool real_time = false;
+	bool use_ids = false;
+	const char *file_name = NULL;
+	uint32_t repeat_count = 5;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-r") == 0)
+		{
+			real_time = true;
+		}
+		else if (strcmp(argv[i], "-i") == 0)
+		{
+			use_ids = true;
+		}
+		else if (file_name == NULL)
+		{
+			file_name = argv[i];
+		}
+		else
+		{
+			repeat_count = (uint32_t)strtoul(argv[i], NULL, 0);
+		}
+	}
+
+	if ((file_name == NULL) || (repeat_count == 0))
+	{
+		return usage(argv[0]);
+	}
+
+	if (real_time)
+	{
+		repeat_count = 1;
+	}
+
+	char xml[256];
+	sprintf(xml, "<table local_host=\"127.0.0.1\" remote_host=\"127.0.0.1\" "
+		"local_port=\"46330\" remote_port=\"46331\" period=\"0.02\" "
+		"use_ids=\"%s\" replay=\"true\"/>", use_ids ? "true" : "false");
+
+	tinyxml2::XMLDocument doc;
+	doc.Parse(xml);
+	UdpValueTable *table = new UdpValueTable("replay", doc.FirstChildElement());
+	UdpValueTableReplay replay(table);
+
+	double best = 0.0;
+	double total_rate = 0.0;
+	int status = 0;
+	for (uint32_t r = 0; r < repeat_count; r++)
+	{
+		if (! replay.replay(file_name, real_time))
+		{
+			status = 1;
+			break;
+		}
+
+		double elapsed = replay.getElapsedTime();
+		double rate = (elapsed > 0.0) ? replay.getPacketCount() / elapsed : 0.0;
+		if (rate > best)
+		{
+			best = rate;
+		}
+		total_rate += rate;
+	}
+
+	if (status == 0)
+	{
+		printf("%u packets, %.3f s captured, %s\n", replay.getPacketCount(),
+			replay.getCaptureLength(), real_time ? "real time" : "as fast as possible");
+		if (real_time)
+		{
+			printf("replayed in %.3f s, %.0f packets/s\n", replay.getElapsedTime(), best);
+		}
+		else
+		{
+			printf("%u runs, best %.0f packets/s, mean %.0f packets/s\n",
+				repeat_count, best, total_rate / repeat_count);
+		}
+		table->printTable();
+	}
+
+	// the table's threads are stopped but it is not deleted
+	table->requestStop();
+	while (table->isRunning())
+	{
+		Thread::sleep(0.001);
+	}
+
+	return status;
+}
@@ -0,0 +1,322 @@
+/*******************************************************************************
+ *
+ * File: RingBench.cpp
+ *	Compares the UdpBufferedRing that UdpBufferedReceiver hands packets to
+ *	its reader with to the Mutex guarded queue it used before
+ *
+ *	usage: RingBench [packet_count]
+ *
+ *	A producer thread puts packets in a queue and the main thread takes them
+ *	out, the way the receive thread and the table's thread do.  Each queue is
+ *	run twice: flooded, where the producer goes as fast as the queue takes
+ *	packets, for packets per second, then paced at PACED_RATE packets per
+ *	second for the time from enqueue to dequeue.  In both the producer waits
+ *	when the queue is full so every packet is counted.
+ *
+ *	On a machine with one core the latency is mostly how long the scheduler
+ *	takes to switch threads, not the queue.
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(PTHREADS)
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <vector>
+
+#include "gsi/Mutex.h"
+#include "gsi/Thread.h"
+#include "gsi/Time.h"
+
+#include "gsu/UdpBufferedDefs.h"
+#include "gsu/UdpBufferedRing.h"
+
+using namespace gsi;
+
+static const uint32_t SLOT_SIZE = 128;		// about a parameter update
+static const uint32_t SLOT_COUNT = 100;		// what UdpValueTable asks for
+static const double PACED_RATE = 20000.0;
+
+/*******************************************************************************
+ *
+ * Let the other thread run while waiting on it.
+ *
+ ******************************************************************************/
+static void relax(void)
+{
+#if defined(PTHREADS)
+	sched_yield();
+#else
+	Thread::sleep(0.0001);
+#endif
+}
+
+/*******************************************************************************
+ *
+ * What both queues look like to the benchmark.  A packet is the time it was
+ * queued and its sequence number, padded out to SLOT_SIZE.
+ *
+ ******************************************************************************/
+class BenchQueue
+{
+	public:
+		virtual ~BenchQueue(void) {}
+
+		virtual const char *getName(void) = 0;
+		virtual bool put(double time, uint32_t sequence) = 0;
+		virtual bool get(double *time, uint32_t *sequence) = 0;
+};
+
+/*******************************************************************************
+ *
+ * The queue UdpBufferedReceiver used before the ring: one buffer of slots,
+ * a head and tail index that wrap at the slot count, and a Mutex held by
+ * both sides.  It overwrote the oldest packet when full, here put() fails
+ * instead so the benchmark can wait for room.
+ *
+ ******************************************************************************/
+class MutexQueue : public BenchQueue
+{
+	public:
+		MutexQueue(void)
+		{
+			buffer = new uint8_t[SLOT_SIZE * SLOT_COUNT];
+			head_idx = 0;
+			tail_idx = 0;
+		}
+
+		~MutexQueue(void)
+		{
+			delete[] buffer;
+		}
+
+		const char *getName(void)	{ return "mutex queue"; }
+
+		bool put(double time, uint32_t sequence)
+		{
+			MutexScopeLock lock(buffer_lock);
+
+			uint32_t next = (head_idx + 1) % SLOT_COUNT;
+			if (next == tail_idx)
+			{
+				return false;
+			}
+
+			uint8_t *slot = &buffer[head_idx * SLOT_SIZE];
+			memcpy(&slot[0], &time, sizeof(time));
+			memcpy(&slot[sizeof(time)], &sequence, sizeof(sequence));
+			head_idx = next;
+			return true;
+		}
+
+		bool get(double *time, uint32_t *sequence)
+		{
+			MutexScopeLock lock(buffer_lock);
+
+			if (tail_idx == head_idx)
+			{
+				return false;
+			}
+
+			uint8_t *slot = &buffer[tail_idx * SLOT_SIZE];
+			memcpy(time, &slot[0], sizeof(*time));
+			memcpy(sequence, &slot[sizeof(*time)], sizeof(*sequence));
+			tail_idx = (tail_idx + 1) % SLOT_COUNT;
+			return true;
+		}
+
+	private:
+		uint8_t *buffer;
+		uint32_t head_idx;
+		uint32_t tail_idx;
+		Mutex buffer_lock;
+};
+
+/*******************************************************************************
+ *
+ * The queue UdpBufferedReceiver uses now.
+ *
+ ******************************************************************************/
+class RingQueue : public BenchQueue
+{
+	public:
+		RingQueue(void) : ring(SLOT_SIZE, SLOT_COUNT) {}
+
+		const char *getName(void)	{ return "UdpBufferedRing"; }
+
+		bool put(double time, uint32_t sequence)
+		{
+			uint8_t *slot = ring.reserve();
+			if (slot == NULL)
+			{
+				return false;
+			}
+
+			memcpy(&slot[0], &time, sizeof(time));
+			memcpy(&slot[sizeof(time)], &sequence, sizeof(sequence));
+			ring.commit();
+			return true;
+		}
+
+		bool get(double *time, uint32_t *sequence)
+		{
+			uint8_t *slot = ring.peek();
+			if (slot == NULL)
+			{
+				return false;
+			}
+
+			memcpy(time, &slot[0], sizeof(*time));
+			memcpy(sequence, &slot[sizeof(*time)], sizeof(*sequence));
+			ring.release();
+			return true;
+		}
+
+	private:
+		UdpBufferedRing ring;
+};
+
+/*******************************************************************************
+ *
+ * Puts packet_count packets in a queue, at rate packets per second or as
+ * fast as it can if rate is 0.
+ *
+ ******************************************************************************/
+class Producer : public Thread
+{
+	public:
+		Producer(BenchQueue *queue, uint32_t packet_count, double rate)
+			: Thread("RingBench producer")
+		{
+			producer_queue = queue;
+			producer_count = packet_count;
+			producer_rate = rate;
+		}
+
+	protected:
+		void run(void)
+		{
+			double start = Time::getMonotonicTime();
+			for (uint32_t i = 0; i < producer_count; i++)
+			{
+				if (producer_rate > 0.0)
+				{
+					while (Time::getMonotonicTime() < start + i / producer_rate)
+					{
+						relax();
+					}
+				}
+
+				while (! producer_queue->put(Time::getMonotonicTime(), i))
+				{
+					if (isStopRequested())
+					{
+						return;
+					}
+					relax();
+				}
+			}
+		}
+
+	private:
+		BenchQueue *producer_queue;
+		uint32_t producer_count;
+		double producer_rate;
+};
+
+/*******************************************************************************
+ *
+ * Run one producer against the queue and print what the consumer saw.
+ *
+ ******************************************************************************/
+static bool runQueue(BenchQueue *queue, uint32_t packet_count, double rate)
+{
+	std::vector<double> latency(packet_count);
+	uint32_t received = 0;
+	uint32_t out_of_order = 0;
+
+	Producer producer(queue, packet_count, rate);
+	double start = Time::getMonotonicTime();
+	producer.start();
+
+	while (received < packet_count)
+	{
+		double time;
+		uint32_t sequence;
+		if (queue->get(&time, &sequence))
+		{
+			latency[received] = Time::getMonotonicTime() - time;
+			if (sequence != received)
+			{
+				out_of_order++;
+			}
+			received++;
+		}
+		else
+		{
+			relax();
+		}
+	}
+
+	double elapsed = Time::getMonotonicTime() - start;
+	while (producer.isRunning())
+	{
+		Thread::sleep(0.001);
+	}
+
+	std::sort(latency.begin(), latency.end());
+	printf("%-16s %-8s %10.0f packets/s   latency p50 %7.2f us  p99 %7.2f us  max %8.2f us\n",
+		queue->getName(), (rate > 0.0) ? "paced" : "flooded",
+		packet_count / elapsed,
+		latency[packet_count / 2] * 1e6,
+		latency[(uint32_t)(packet_count * 0.99)] * 1e6,
+		latency[packet_count - 1] * 1e6);
+
+	if (out_of_order != 0)
+	{
+		printf("%s - %u packets out of order\n", queue->getName(), out_of_order);
+		return false;
+	}
+	return true;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+int main(int argc, char **argv)
+{
+	uint32_t packet_count = 200000;
+	if (argc > 1)
+	{
+		packet_count = (uint32_t)strtoul(argv[1], NULL, 0);
+	}
+
+	if (packet_count < 100)
+	{
+		fprintf(stderr, "usage: %s [packet_count], at least 100 packets\n", argv[0]);
+		return 1;
+	}
+
+	MutexQueue mutex_queue;
+	RingQueue ring_queue;
+	BenchQueue *queues[] = { &mutex_queue, &ring_queue };
+
+	bool ok = true;
+	for (uint32_t i = 0; i < sizeof(queues) / sizeof(queues[0]); i++)
+	{
+		ok = runQueue(queues[i], packet_count, 0.0) && ok;
+		ok = runQueue(queues[i], packet_count / 10, PACED_RATE) && ok;
+	}
+
+	return ok ? 0 : 1;
+}
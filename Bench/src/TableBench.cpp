@@ -0,0 +1,438 @@
+/*******************************************************************************
+ *
+ * File: TableBench.cpp
+ *	Times building the keyframe of a full UdpValueTable and 10k random gets
+ *
+ *	usage: TableBench [repeat_count]
+ *
+ *	The tables have MAX_PARAMETERS parameters, mostly floats and 32 bit ints
+ *	with a string every eighth one.  The keyframe is built the way
+ *	sendKeyframe() does it, with buildFrame() filling frames until every
+ *	parameter is in one, but the frames are not sent.  It is timed with the
+ *	records keyed by name and keyed by ID (the use_ids XML attribute).
+ *
+ *	For the layout, walking every parameter and random gets are also timed
+ *	with the parameters in one array indexed by ID, the way the table keeps
+ *	them, and with each one allocated on its own and reached through a
+ *	vector of pointers, the way the table kept them before.  The old
+ *	parameter class was the same size as the current one, so the baseline
+ *	allocates the current one; the allocations are spread over the heap as
+ *	they would be in a program that has been running a while.
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "gsi/Thread.h"
+#include "gsi/Time.h"
+
+#include "gsu/UdpBufferedDefs.h"
+#include "gsu/UdpValueTable.h"
+
+using namespace gsi;
+using namespace gsu;
+
+static const uint32_t PARAMETER_COUNT = UdpValueTable::MAX_PARAMETERS;
+static const uint32_t GET_COUNT = 10000;
+
+static volatile uint32_t sink;
+
+namespace gsu
+{
+
+/*******************************************************************************
+ *
+ * Reaches into a table for what the benchmark times.
+ *
+ ******************************************************************************/
+class UdpValueTableBench
+{
+	public:
+		/***********************************************************************
+		 *
+		 * Build every frame of a keyframe of the whole table, without
+		 * sending them.
+		 *
+		 * @return	the number of bytes in the frames
+		 *
+		 **********************************************************************/
+		static uint32_t buildKeyframe(UdpValueTable *table, const uint16_t *ids,
+			uint32_t count)
+		{
+			char buffer[UDP_BUFFERED_MAX_FRAME_LENGTH];
+			uint32_t total = 0;
+			uint32_t sent = 0;
+			while (sent < count)
+			{
+				uint16_t length = 0;
+				uint32_t records = table->buildFrame(buffer, &length, &ids[sent],
+					count - sent);
+				if (records == 0)
+				{
+					break;
+				}
+
+				total += length;
+				sent += records;
+			}
+
+			return total;
+		}
+};
+
+} // namespace gsu
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+static std::string getParameterName(uint32_t i)
+{
+	char name[UdpValueTable::NAME_LENGTH + 1];
+	sprintf(name, "param%u", i);
+	return name;
+}
+
+/*******************************************************************************
+ *
+ * Give a parameter its value, every eighth is a string and the rest are
+ * floats or ints.
+ *
+ ******************************************************************************/
+static void initParameter(UdpValueTableParameter *p, uint32_t i)
+{
+	if ((i % 8) == 7)
+	{
+		p->init<std::string>(std::string("a string value"));
+	}
+	else if (i & 1)
+	{
+		p->init<float>(i * 0.5f);
+	}
+	else
+	{
+		p->init<int32_t>((int32_t)i);
+	}
+}
+
+/*******************************************************************************
+ *
+ * Add a parameter to a table with the same value initParameter() gives.
+ *
+ ******************************************************************************/
+static void putParameter(UdpValueTable *table, uint32_t i)
+{
+	if ((i % 8) == 7)
+	{
+		table->put<std::string>(getParameterName(i), std::string("a string value"), false);
+	}
+	else if (i & 1)
+	{
+		table->put<float>(getParameterName(i), i * 0.5f, false);
+	}
+	else
+	{
+		table->put<int32_t>(getParameterName(i), (int32_t)i, false);
+	}
+}
+
+/*******************************************************************************
+ *
+ * Read a parameter the way a caller that knows its type would.
+ *
+ ******************************************************************************/
+static uint32_t getParameter(UdpValueTableParameter *p)
+{
+	switch (p->getType())
+	{
+		case UdpValueTableParameter::TYPE_FLOAT32:
+			return (uint32_t)p->get<float>();
+
+		case UdpValueTableParameter::TYPE_INT32:
+			return (uint32_t)p->get<int32_t>();
+
+		default:
+			return p->getSize();
+	}
+}
+
+/*******************************************************************************
+ *
+ * Read a table's parameter by ID, the type follows from the ID the way it
+ * does in initParameter().
+ *
+ ******************************************************************************/
+static uint32_t getTableParameter(UdpValueTable *table, uint16_t id)
+{
+	if ((id % 8) == 7)
+	{
+		return table->get<std::string>(id, std::string("")).size();
+	}
+	else if (id & 1)
+	{
+		return (uint32_t)table->get<float>(id, 0.0f);
+	}
+	else
+	{
+		return (uint32_t)table->get<int32_t>(id, 0);
+	}
+}
+
+/*******************************************************************************
+ *
+ * The same by name.
+ *
+ ******************************************************************************/
+static uint32_t getTableParameter(UdpValueTable *table, const std::string &name,
+	uint16_t id)
+{
+	if ((id % 8) == 7)
+	{
+		return table->get<std::string>(name, std::string("")).size();
+	}
+	else if (id & 1)
+	{
+		return (uint32_t)table->get<float>(name, 0.0f);
+	}
+	else
+	{
+		return (uint32_t)table->get<int32_t>(name, 0);
+	}
+}
+
+/*******************************************************************************
+ *
+ * Put every parameter's value in network byte order, one at a time.
+ *
+ ******************************************************************************/
+static uint32_t walkParameters(UdpValueTableParameter **params, uint32_t count)
+{
+	uint8_t value[UdpValueTableParameter::VALUE_CAPACITY];
+	uint32_t total = 0;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		total += params[i]->toNetBytes(value);
+	}
+
+	return total;
+}
+
+/*******************************************************************************
+ *
+ * Make a table with every parameter, keyed by ID if use_ids is set.
+ *
+ ******************************************************************************/
+static UdpValueTable *makeTable(const char *name, uint32_t port, bool use_ids)
+{
+	char xml[256];
+	sprintf(xml, "<table local_host=\"127.0.0.1\" remote_host=\"127.0.0.1\" "
+		"local_port=\"%u\" remote_port=\"%u\" period=\"0.02\" use_ids=\"%s\"/>",
+		port, port + 1, use_ids ? "true" : "false");
+
+	tinyxml2::XMLDocument doc;
+	doc.Parse(xml);
+	UdpValueTable *table = new UdpValueTable(name, doc.FirstChildElement());
+	for (uint32_t i = 0; i < PARAMETER_COUNT; i++)
+	{
+		putParameter(table, i);
+	}
+
+	return table;
+}
+
+/*******************************************************************************
+ *
+ * Stop a table's threads.  It is not deleted, its receiver may still be
+ * blocked on the socket.
+ *
+ ******************************************************************************/
+static void stopTable(UdpValueTable *table)
+{
+	table->requestStop();
+	while (table->isRunning())
+	{
+		Thread::sleep(0.001);
+	}
+}
+
+/*******************************************************************************
+ *
+ * Print how long one run of what was timed took.
+ *
+ ******************************************************************************/
+static void printTime(const char *label, double elapsed, uint32_t repeat_count,
+	uint32_t per_run)
+{
+	double run_time = elapsed / repeat_count;
+	printf("%-40s %9.2f us per run  %7.1f ns each\n", label, run_time * 1e6,
+		run_time * 1e9 / per_run);
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+int main(int argc, char **argv)
+{
+	uint32_t repeat_count = 1000;
+	if (argc > 1)
+	{
+		repeat_count = (uint32_t)strtoul(argv[1], NULL, 0);
+	}
+
+	if (repeat_count == 0)
+	{
+		fprintf(stderr, "usage: %s [repeat_count]\n", argv[0]);
+		return 1;
+	}
+
+	printf("%u parameters, %u runs of each\n", PARAMETER_COUNT, repeat_count);
+
+	// the keyframe of a full table
+	UdpValueTable *name_table = makeTable("bench_names", 46320, false);
+	UdpValueTable *id_table = makeTable("bench_ids", 46322, true);
+
+	std::vector<uint16_t> all_ids(PARAMETER_COUNT);
+	for (uint32_t i = 0; i < PARAMETER_COUNT; i++)
+	{
+		all_ids[i] = (uint16_t)i;
+	}
+
+	double start = Time::getMonotonicTime();
+	for (uint32_t r = 0; r < repeat_count; r++)
+	{
+		sink = UdpValueTableBench::buildKeyframe(name_table, &all_ids[0], PARAMETER_COUNT);
+	}
+	printTime("keyframe buildFrame, keyed by name", Time::getMonotonicTime() - start,
+		repeat_count, PARAMETER_COUNT);
+
+	start = Time::getMonotonicTime();
+	for (uint32_t r = 0; r < repeat_count; r++)
+	{
+		sink = UdpValueTableBench::buildKeyframe(id_table, &all_ids[0], PARAMETER_COUNT);
+	}
+	printTime("keyframe buildFrame, keyed by ID", Time::getMonotonicTime() - start,
+		repeat_count, PARAMETER_COUNT);
+
+	// the array layout, all parameters in one allocation
+	UdpValueTableParameter *store = new UdpValueTableParameter[PARAMETER_COUNT];
+	std::vector<UdpValueTableParameter *> array_params(PARAMETER_COUNT);
+	for (uint32_t i = 0; i < PARAMETER_COUNT; i++)
+	{
+		initParameter(&store[i], i);
+		array_params[i] = &store[i];
+	}
+
+	// the old layout, each parameter allocated on its own between other
+	// allocations that are freed afterwards
+	std::vector<UdpValueTableParameter *> old_params(PARAMETER_COUNT);
+	std::vector<char *> filler;
+	srand(118);
+	for (uint32_t i = 0; i < PARAMETER_COUNT; i++)
+	{
+		filler.push_back(new char[16 + (rand() % 512)]);
+		old_params[i] = new UdpValueTableParameter();
+		initParameter(old_params[i], i);
+	}
+	for (uint32_t i = 0; i < filler.size(); i++)
+	{
+		delete[] filler[i];
+	}
+
+	start = Time::getMonotonicTime();
+	for (uint32_t r = 0; r < repeat_count; r++)
+	{
+		sink = walkParameters(&array_params[0], PARAMETER_COUNT);
+	}
+	printTime("walk every parameter, array", Time::getMonotonicTime() - start,
+		repeat_count, PARAMETER_COUNT);
+
+	start = Time::getMonotonicTime();
+	for (uint32_t r = 0; r < repeat_count; r++)
+	{
+		sink = walkParameters(&old_params[0], PARAMETER_COUNT);
+	}
+	printTime("walk every parameter, old pointers", Time::getMonotonicTime() - start,
+		repeat_count, PARAMETER_COUNT);
+
+	std::vector<uint16_t> get_ids(GET_COUNT);
+	std::vector<std::string> get_names(GET_COUNT);
+	for (uint32_t i = 0; i < GET_COUNT; i++)
+	{
+		get_ids[i] = (uint16_t)(rand() % PARAMETER_COUNT);
+		get_names[i] = getParameterName(get_ids[i]);
+	}
+
+	start = Time::getMonotonicTime();
+	for (uint32_t r = 0; r < repeat_count; r++)
+	{
+		uint32_t total = 0;
+		for (uint32_t i = 0; i < GET_COUNT; i++)
+		{
+			total += getParameter(&store[get_ids[i]]);
+		}
+		sink = total;
+	}
+	printTime("10k random gets, array by ID", Time::getMonotonicTime() - start,
+		repeat_count, GET_COUNT);
+
+	start = Time::getMonotonicTime();
+	for (uint32_t r = 0; r < repeat_count; r++)
+	{
+		uint32_t total = 0;
+		for (uint32_t i = 0; i < GET_COUNT; i++)
+		{
+			total += getParameter(old_params[get_ids[i]]);
+		}
+		sink = total;
+	}
+	printTime("10k random gets, old pointers by ID", Time::getMonotonicTime() - start,
+		repeat_count, GET_COUNT);
+
+	// the same gets through the table
+	uint32_t table_repeat = (repeat_count + 9) / 10;
+	start = Time::getMonotonicTime();
+	for (uint32_t r = 0; r < table_repeat; r++)
+	{
+		uint32_t total = 0;
+		for (uint32_t i = 0; i < GET_COUNT; i++)
+		{
+			total += getTableParameter(name_table, get_ids[i]);
+		}
+		sink = total;
+	}
+	printTime("10k random gets, UdpValueTable by ID", Time::getMonotonicTime() - start,
+		table_repeat, GET_COUNT);
+
+	start = Time::getMonotonicTime();
+	for (uint32_t r = 0; r < table_repeat; r++)
+	{
+		uint32_t total = 0;
+		for (uint32_t i = 0; i < GET_COUNT; i++)
+		{
+			total += getTableParameter(name_table, get_names[i], get_ids[i]);
+		}
+		sink = total;
+	}
+	printTime("10k random gets, UdpValueTable by name", Time::getMonotonicTime() - start,
+		table_repeat, GET_COUNT);
+
+	stopTable(name_table);
+	stopTable(id_table);
+
+	for (uint32_t i = 0; i < PARAMETER_COUNT; i++)
+	{
+		delete old_params[i];
+	}
+	delete[] store;
+
+	return 0;
+}
@@ -0,0 +1,172 @@
+/*******************************************************************************
+ *
+ * File: TaskPoolBench.cpp
+ *	Shows how the cycle time of subsystem updates forked with a TaskGroup
+ *	scales with the number of TaskPool workers
+ *
+ *	usage: TaskPoolBench [max_workers]
+ *
+ *	Each cycle forks SUBSYSTEM_COUNT updates that each do about the same
+ *	amount of math, the way Robot::doPeriodic() forks drive, arm, intake and
+ *	the like, then joins them.  The cycles are timed first with the updates
+ *	run one after the other on one thread, then with a pool of 1 up to
+ *	max_workers workers (default the number of CPUs).  The thread that forks
+ *	the updates runs its share while it waits, so a pool of n workers can
+ *	use n + 1 CPUs.
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(LINUX)
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <vector>
+
+#include "gsi/TaskPool.h"
+#include "gsi/Time.h"
+
+using namespace gsi;
+
+static const uint32_t SUBSYSTEM_COUNT = 8;
+static const uint32_t CYCLE_COUNT = 500;
+static const uint32_t WORK_STEPS = 20000;	// a few hundred microseconds
+
+/*******************************************************************************
+ *
+ * Stands in for one subsystem's update.
+ *
+ ******************************************************************************/
+class SubsystemUpdate : public Task
+{
+	public:
+		SubsystemUpdate(void)
+		{
+			result = 0.0;
+		}
+
+		void execute(void)
+		{
+			double x = result;
+			for (uint32_t i = 0; i < WORK_STEPS; i++)
+			{
+				x = x * 0.999 + sin(i * 0.001);
+			}
+			result = x;
+		}
+
+		double result;
+};
+
+/*******************************************************************************
+ *
+ * @return	the number of CPUs that are online, 1 if it is not known
+ *
+ ******************************************************************************/
+static uint32_t getCpuCount(void)
+{
+#if defined(LINUX)
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	if (count > 0)
+	{
+		return (uint32_t)count;
+	}
+#endif
+	return 1;
+}
+
+/*******************************************************************************
+ *
+ * Run the cycles and print their mean and 99th percentile time.
+ *
+ * @param	pool	the pool to fork to, NULL to run the updates in order
+ *
+ * @return	the mean cycle time in seconds
+ *
+ ******************************************************************************/
+static double runCycles(TaskPool *pool, const char *label, double serial_mean)
+{
+	SubsystemUpdate updates[SUBSYSTEM_COUNT];
+	std::vector<double> cycle_time(CYCLE_COUNT);
+	double total = 0.0;
+
+	for (uint32_t c = 0; c < CYCLE_COUNT; c++)
+	{
+		double start = Time::getMonotonicTime();
+
+		if (pool == NULL)
+		{
+			for (uint32_t i = 0; i < SUBSYSTEM_COUNT; i++)
+			{
+				updates[i].execute();
+			}
+		}
+		else
+		{
+			TaskGroup group(pool);
+			for (uint32_t i = 1; i < SUBSYSTEM_COUNT; i++)
+			{
+				group.spawn(&updates[i]);
+			}
+			updates[0].execute();
+			group.wait();
+		}
+
+		cycle_time[c] = Time::getMonotonicTime() - start;
+		total += cycle_time[c];
+	}
+
+	std::sort(cycle_time.begin(), cycle_time.end());
+	double mean = total / CYCLE_COUNT;
+
+	printf("%-12s cycle mean %8.1f us  p99 %8.1f us  speedup %5.2f",
+		label, mean * 1e6, cycle_time[(uint32_t)(CYCLE_COUNT * 0.99)] * 1e6,
+		(serial_mean > 0.0) ? serial_mean / mean : 1.0);
+	if (pool != NULL)
+	{
+		printf("  steals %u", pool->getStealCount());
+	}
+	printf("\n");
+
+	return mean;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+int main(int argc, char **argv)
+{
+	uint32_t cpu_count = getCpuCount();
+	uint32_t max_workers = cpu_count;
+	if (argc > 1)
+	{
+		max_workers = (uint32_t)strtoul(argv[1], NULL, 0);
+	}
+
+	printf("%u subsystems of %u steps, %u cycles, %u CPUs\n",
+		SUBSYSTEM_COUNT, WORK_STEPS, CYCLE_COUNT, cpu_count);
+
+	double serial_mean = runCycles(NULL, "serial", 0.0);
+
+	for (uint32_t workers = 1; workers <= max_workers; workers++)
+	{
+		char label[32];
+		sprintf(label, "%u workers", workers);
+
+		TaskPool pool("bench", workers);
+		pool.start();
+		runCycles(&pool, label, serial_mean);
+		pool.stop();
+	}
+
+	return 0;
+}
@@ -0,0 +1,305 @@
+/*******************************************************************************
+ *
+ * File: FlightReader.cpp
+ *	Prints a dump written by gsi::FlightRecorder
+ *
+ *	usage: FlightReader dump_file
+ *
+ *	The records still in the ring are printed oldest first, each after the
+ *	seconds since the recorder was opened.  The dump may come from a
+ *	computer with the other byte order.
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gsi/FlightRecorder.h"
+
+using namespace gsi;
+
+static bool swap_bytes = false;
+
+/*******************************************************************************
+ *
+ * Put values from the dump in this computer's byte order.
+ *
+ ******************************************************************************/
+static uint16_t fix16(uint16_t v)
+{
+	return swap_bytes ? (uint16_t)((v >> 8) | (v << 8)) : v;
+}
+
+static uint32_t fix32(uint32_t v)
+{
+	if (! swap_bytes)
+	{
+		return v;
+	}
+	return (v >> 24) | ((v >> 8) & 0x0000FF00) | ((v << 8) & 0x00FF0000) | (v << 24);
+}
+
+static double fixDouble(double v)
+{
+	if (! swap_bytes)
+	{
+		return v;
+	}
+
+	uint8_t bytes[sizeof(v)];
+	memcpy(bytes, &v, sizeof(v));
+	std::reverse(bytes, bytes + sizeof(bytes));
+	memcpy(&v, bytes, sizeof(v));
+	return v;
+}
+
+/*******************************************************************************
+ *
+ * Get a big endian number from a value table value.
+ *
+ ******************************************************************************/
+static uint32_t getNet(const uint8_t *src, uint32_t length)
+{
+	uint32_t v = 0;
+	for (uint32_t i = 0; i < length; i++)
+	{
+		v = (v << 8) | src[i];
+	}
+	return v;
+}
+
+/*******************************************************************************
+ *
+ * Print a value table value, the types are the UdpValueTableParameter types
+ * and the value is in network byte order.
+ *
+ ******************************************************************************/
+static void printValue(const uint8_t *data, uint32_t length)
+{
+	FlightRecorder::ValueSample sample;
+	memset(&sample, 0, sizeof(sample));
+	memcpy(&sample, data, (length < sizeof(sample)) ? length : sizeof(sample));
+
+	uint32_t value_length = sample.length;
+	if (value_length > sizeof(sample.value))
+	{
+		value_length = sizeof(sample.value);
+	}
+	const uint8_t *v = sample.value;
+
+	printf("VALUE     id=%u ", fix16(sample.id));
+	switch (sample.type)
+	{
+		case 1:		printf("bool %s\n", (v[0] != 0) ? "true" : "false");			break;
+		case 2:		printf("int8 %d\n", (int8_t)v[0]);								break;
+		case 3:		printf("uint8 %u\n", v[0]);										break;
+		case 4:		printf("int16 %d\n", (int16_t)getNet(v, 2));					break;
+		case 5:		printf("uint16 %u\n", getNet(v, 2));							break;
+		case 6:		printf("int32 %d\n", (int32_t)getNet(v, 4));					break;
+		case 7:		printf("uint32 %u\n", getNet(v, 4));							break;
+
+		case 8:
+		{
+			uint32_t bits = getNet(v, 4);
+			float f;
+			memcpy(&f, &bits, sizeof(f));
+			printf("float %g\n", f);
+		} break;
+
+		case 9:
+			printf("string \"%.*s\"\n", (int)strnlen((const char *)v, value_length), v);
+			break;
+
+		default:
+			printf("type %u", sample.type);
+			for (uint32_t i = 0; i < value_length; i++)
+			{
+				printf(" %02x", v[i]);
+			}
+			printf("\n");
+			break;
+	}
+}
+
+/*******************************************************************************
+ *
+ * Print a periodic thread's timing sample.
+ *
+ ******************************************************************************/
+static void printTiming(const uint8_t *data, uint32_t length)
+{
+	FlightRecorder::TimingSample sample;
+	memset(&sample, 0, sizeof(sample));
+	memcpy(&sample, data, (length < sizeof(sample)) ? length : sizeof(sample));
+	sample.name[FlightRecorder::NAME_LENGTH - 1] = 0;
+
+	printf("TIMING    %-16s cycle %u  execution %.6f  latency %.6f  overruns %u\n",
+		sample.name, fix32(sample.cycle), fixDouble(sample.execution),
+		fixDouble(sample.latency), fix32(sample.overruns));
+}
+
+/*******************************************************************************
+ *
+ * Print one whole record.
+ *
+ ******************************************************************************/
+static void printRecord(uint8_t kind, double time, const std::string &data, bool torn)
+{
+	printf("[%12.6f] ", time);
+
+	const uint8_t *bytes = (const uint8_t *)data.data();
+	switch (kind)
+	{
+		case FlightRecorder::RECORD_VALUE:
+			printValue(bytes, data.size());
+			return;
+
+		case FlightRecorder::RECORD_TIMING:
+			printTiming(bytes, data.size());
+			return;
+
+		case FlightRecorder::RECORD_LOG:				printf("LOG       ");	break;
+		case FlightRecorder::RECORD_EXCEPTION:			printf("EXCEPTION ");	break;
+		case FlightRecorder::RECORD_THREAD_EXCEPTION:	printf("THREAD    ");	break;
+		case FlightRecorder::RECORD_SIGNAL:				printf("SIGNAL    ");	break;
+		case FlightRecorder::RECORD_NOTE:				printf("NOTE      ");	break;
+		default:										printf("KIND %-4u ", kind);	break;
+	}
+
+	std::string text = data;
+	while ((! text.empty()) && (text[text.size() - 1] == '\n'))
+	{
+		text.erase(text.size() - 1);
+	}
+	printf("%s%s\n", text.c_str(), torn ? " (cut off)" : "");
+}
+
+/*******************************************************************************
+ *
+ * Sort slots by their sequence.
+ *
+ ******************************************************************************/
+static bool bySequence(const FlightRecorder::Record *a, const FlightRecorder::Record *b)
+{
+	return fix32(a->sequence) < fix32(b->sequence);
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+int main(int argc, char **argv)
+{
+	if (argc != 2)
+	{
+		fprintf(stderr, "usage: %s dump_file\n", argv[0]);
+		return 1;
+	}
+
+	FILE *file = fopen(argv[1], "rb");
+	if (file == NULL)
+	{
+		fprintf(stderr, "could not open %s\n", argv[1]);
+		return 1;
+	}
+
+	FlightRecorder::Header header;
+	if ((fread(&header, 1, sizeof(header), file) != sizeof(header)) ||
+		(memcmp(header.magic, "GSIFDR", 6) != 0))
+	{
+		fprintf(stderr, "%s is not a flight recorder dump\n", argv[1]);
+		fclose(file);
+		return 1;
+	}
+
+	swap_bytes = (header.byte_order != FlightRecorder::BYTE_ORDER_MARK);
+	uint32_t count = fix32(header.record_count);
+	if ((fix32(header.version) != FlightRecorder::VERSION) ||
+		(fix32(header.header_size) != sizeof(header)) ||
+		(fix32(header.record_size) != sizeof(FlightRecorder::Record)) ||
+		(count == 0) || ((count & (count - 1)) != 0))
+	{
+		fprintf(stderr, "%s is not a version %u dump\n", argv[1], FlightRecorder::VERSION);
+		fclose(file);
+		return 1;
+	}
+
+	std::vector<FlightRecorder::Record> records(count);
+	uint32_t read = fread(&records[0], sizeof(FlightRecorder::Record), count, file);
+	fclose(file);
+
+	double start = fixDouble(header.start_monotonic);
+	header.trigger_reason[FlightRecorder::REASON_LENGTH - 1] = 0;
+
+	printf("started      %.6f\n", fixDouble(header.start_time));
+	printf("records      %u of %u slots\n", fix32(header.next), count);
+	printf("triggers     %u\n", fix32(header.trigger_count));
+	if (fix32(header.trigger_count) > 0)
+	{
+		printf("last trigger [%12.6f] %s (%d)\n", fixDouble(header.trigger_time) - start,
+			header.trigger_reason, (int32_t)fix32((uint32_t)header.trigger_code));
+	}
+	printf("\n");
+
+	// a slot is whole when its sequence is the one for where it is
+	std::vector<const FlightRecorder::Record *> slots;
+	for (uint32_t i = 0; i < read; i++)
+	{
+		uint32_t sequence = fix32(records[i].sequence);
+		if ((sequence != 0) && (((sequence - 1) & (count - 1)) == i))
+		{
+			slots.push_back(&records[i]);
+		}
+	}
+	std::sort(slots.begin(), slots.end(), bySequence);
+
+	std::string data;
+	uint32_t expected = 0;
+	for (uint32_t i = 0; i < slots.size(); i++)
+	{
+		const FlightRecorder::Record *r = slots[i];
+		uint32_t sequence = fix32(r->sequence);
+
+		// parts after the first have to follow right after the part before
+		// them, the others are what is left of records that were cut off
+		if (r->part == 0)
+		{
+			if (! data.empty())
+			{
+				printRecord(slots[i - 1]->kind, fixDouble(slots[i - 1]->time) - start, data, true);
+			}
+			data.clear();
+		}
+		else if ((i == 0) || (sequence != expected) || (slots[i - 1]->part + 1 != r->part))
+		{
+			data.clear();
+			continue;
+		}
+
+		uint32_t length = (r->length < FlightRecorder::DATA_LENGTH) ? r->length : FlightRecorder::DATA_LENGTH;
+		data.append((const char *)r->data, length);
+		expected = sequence + 1;
+
+		if (r->part + 1 >= r->parts)
+		{
+			printRecord(r->kind, fixDouble(r->time) - start, data, false);
+			data.clear();
+		}
+	}
+
+	if (! data.empty())
+	{
+		const FlightRecorder::Record *r = slots[slots.size() - 1];
+		printRecord(r->kind, fixDouble(r->time) - start, data, true);
+	}
+
+	return 0;
+}
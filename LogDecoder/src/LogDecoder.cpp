@@ -0,0 +1,368 @@
+/*******************************************************************************
+ *
+ * File: LogDecoder.cpp
+ *	Prints the lines of a binary log written by RobotLogger::startBinary()
+ *
+ *	usage: LogDecoder [-n] log_file
+ *		-n	leave out the time in front of each line
+ *
+ *	Each line is printed the way RobotLogger would have printed it, after
+ *	the seconds since the log was started.  After a record that does not
+ *	make sense, such as one cut off by a crash before the log was appended
+ *	to, decoding goes on from the next log start in the file.
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "gsi/RobotLogFormat.h"
+#include "gsi/RobotLogger.h"
+
+using namespace gsi;
+
+// how many records back to look for a RECORD_START after a bad record
+static const uint32_t RESYNC_RECORDS = 4;
+
+/*******************************************************************************
+ *
+ * Read exactly count bytes.
+ *
+ ******************************************************************************/
+static bool readBytes(FILE *file, uint8_t *dest, uint32_t count)
+{
+	return fread(dest, 1, count, file) == count;
+}
+
+/*******************************************************************************
+ *
+ * Read a varint, see RobotLogFormat.
+ *
+ ******************************************************************************/
+static bool readVarint(FILE *file, uint64_t *v)
+{
+	uint8_t bytes[10];
+	for (uint32_t i = 0; i < sizeof(bytes); i++)
+	{
+		int c = fgetc(file);
+		if (c == EOF)
+		{
+			return false;
+		}
+
+		bytes[i] = (uint8_t)c;
+		if ((c & 0x80) == 0)
+		{
+			return RobotLogFormat::getVarint(bytes, &bytes[i + 1], v) != 0;
+		}
+	}
+	return false;
+}
+
+/*******************************************************************************
+ *
+ * Read a signed varint, see RobotLogFormat.
+ *
+ ******************************************************************************/
+static bool readSignedVarint(FILE *file, int64_t *v)
+{
+	uint64_t u;
+	if (! readVarint(file, &u))
+	{
+		return false;
+	}
+
+	uint8_t bytes[10];
+	uint32_t length = RobotLogFormat::putVarint(bytes, u);
+	return RobotLogFormat::getSignedVarint(bytes, &bytes[length], v) != 0;
+}
+
+/*******************************************************************************
+ *
+ * Look for the next RECORD_START, its kind byte followed by the magic, and
+ * leave the file at it.
+ *
+ * @return	false if there is none before the end of the file
+ *
+ ******************************************************************************/
+static bool findStart(FILE *file)
+{
+	uint8_t start[5];
+	start[0] = RobotLogFormat::RECORD_START;
+	RobotLogFormat::put32(&start[1], RobotLogFormat::MAGIC);
+
+	// the kind byte is not in the magic, so a partial match only has to
+	// start over
+	uint32_t matched = 0;
+	int c;
+	while ((c = fgetc(file)) != EOF)
+	{
+		if (c == start[matched])
+		{
+			matched++;
+			if (matched == sizeof(start))
+			{
+				return fseek(file, -(long)sizeof(start), SEEK_CUR) == 0;
+			}
+		}
+		else
+		{
+			matched = (c == start[0]) ? 1 : 0;
+		}
+	}
+
+	return false;
+}
+
+/*******************************************************************************
+ *
+ * @return	true if a site's bytes are a tag and a format that each end with
+ *			a null, the way RobotLogger writes them
+ *
+ ******************************************************************************/
+static bool isSite(const uint8_t *data, uint64_t length)
+{
+	const uint8_t *tag_end = (const uint8_t *)memchr(data, 0, length);
+	if (tag_end == NULL)
+	{
+		return false;
+	}
+
+	uint64_t rest = length - (tag_end + 1 - data);
+	return memchr(tag_end + 1, 0, rest) != NULL;
+}
+
+/*******************************************************************************
+ *
+ * Print one line, after its time if times are wanted.  Lines with times
+ * always end with a newline, without times lines are printed as logged.
+ *
+ ******************************************************************************/
+static void printLine(const char *text, int64_t time, bool show_time)
+{
+	if (show_time)
+	{
+		printf("[%12.6f] ", time / 1000000.0);
+	}
+	else
+	{
+		fputs(text, stdout);
+		return;
+	}
+	fputs(text, stdout);
+
+	uint32_t length = strlen(text);
+	if ((length == 0) || (text[length - 1] != '\n'))
+	{
+		fputc('\n', stdout);
+	}
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+int main(int argc, char **argv)
+{
+	bool show_time = true;
+	const char *file_name = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-n") == 0)
+		{
+			show_time = false;
+		}
+		else
+		{
+			file_name = argv[i];
+		}
+	}
+
+	if (file_name == NULL)
+	{
+		fprintf(stderr, "usage: %s [-n] log_file\n", argv[0]);
+		return 1;
+	}
+
+	FILE *file = fopen(file_name, "rb");
+	if (file == NULL)
+	{
+		fprintf(stderr, "could not open %s\n", file_name);
+		return 1;
+	}
+
+	std::vector<std::string> sites;
+	int64_t start = 0;
+	int64_t time = 0;
+	uint32_t lines = 0;
+
+	// where the last few records began, a record cut off by a crash can
+	// swallow the RECORD_START after it and only fail a record or two later
+	long recent[RESYNC_RECORDS];
+	uint32_t recent_count = 0;
+	long last_start = -1;
+
+	uint8_t header[RobotLogFormat::START_LENGTH];
+	uint8_t data[65536];
+	char text[RobotLogger::LINE_LENGTH];
+
+	int status = 0;
+	while (true)
+	{
+		long record_start = ftell(file);
+		if (! readBytes(file, header, 1))
+		{
+			break;
+		}
+
+		bool ok = true;
+		uint64_t id = 0;
+		uint64_t length = 0;
+		int64_t delta = 0;
+
+		switch (header[0])
+		{
+			case RobotLogFormat::RECORD_START:
+			{
+				ok = readBytes(file, &header[1], RobotLogFormat::START_LENGTH - 1) &&
+					(RobotLogFormat::get32(&header[1]) == RobotLogFormat::MAGIC);
+				if (ok)
+				{
+					last_start = record_start;
+				}
+
+				if (ok && (RobotLogFormat::get16(&header[5]) != RobotLogFormat::VERSION))
+				{
+					fprintf(stderr, "%s has a log that is not version %d, skipped\n",
+						file_name, RobotLogFormat::VERSION);
+					status = 1;
+					ok = false;
+					break;
+				}
+
+				if (ok)
+				{
+					sites.clear();
+					start = (int64_t)(RobotLogFormat::getDouble(&header[15]) * 1000000.0);
+					time = start;
+					recent_count = 0;
+				}
+			} break;
+
+			case RobotLogFormat::RECORD_SITE:
+			{
+				ok = readVarint(file, &id) && (id < RobotLogFormat::MAX_SITES) &&
+					readVarint(file, &length) && (length <= sizeof(data)) &&
+					readBytes(file, data, length);
+				if (ok && ! isSite(data, length))
+				{
+					fprintf(stderr, "site %u is not a tag and a format\n", (uint32_t)id);
+					ok = false;
+				}
+				if (ok)
+				{
+					if (id >= sites.size())
+					{
+						sites.resize(id + 1);
+					}
+					sites[id].assign((const char *)data, length);
+				}
+			} break;
+
+			case RobotLogFormat::RECORD_LINE:
+			{
+				ok = readVarint(file, &id) && readSignedVarint(file, &delta) &&
+					readVarint(file, &length) && (length <= sizeof(data)) &&
+					readBytes(file, data, length);
+				if (! ok)
+				{
+					break;
+				}
+
+				// sites are always written before they are used
+				if ((id >= sites.size()) || sites[id].empty())
+				{
+					fprintf(stderr, "line %u uses unknown site %u\n", lines, (uint32_t)id);
+					ok = false;
+					break;
+				}
+
+				time += delta;
+				const char *tag = sites[id].c_str();
+				const char *format = &tag[strlen(tag) + 1];
+				RobotLogFormat::formatLine(tag, format, data, length, text, sizeof(text));
+				printLine(text, time - start, show_time);
+				lines++;
+			} break;
+
+			case RobotLogFormat::RECORD_TEXT:
+			{
+				ok = readSignedVarint(file, &delta) && readVarint(file, &length) &&
+					(length < sizeof(text)) && readBytes(file, (uint8_t *)text, length);
+				if (ok)
+				{
+					time += delta;
+					text[length] = 0;
+					printLine(text, time - start, show_time);
+					lines++;
+				}
+			} break;
+
+			default:
+				fprintf(stderr, "unknown record %d after %u lines\n", header[0], lines);
+				ok = false;
+				break;
+		}
+
+		if (ok)
+		{
+			if (recent_count == RESYNC_RECORDS)
+			{
+				memmove(&recent[0], &recent[1], (RESYNC_RECORDS - 1) * sizeof(recent[0]));
+				recent_count--;
+			}
+			recent[recent_count++] = record_start;
+			continue;
+		}
+
+		// a log cut off by a crash ends in the middle of a record, and when
+		// the log was appended to the next log starts there, so look for it
+		// from just after the oldest recent record, but never go back to a
+		// start that was already read
+		bool at_end = (feof(file) != 0);
+		long from = ((recent_count > 0) ? recent[0] : record_start) + 1;
+		if (from <= last_start)
+		{
+			from = last_start + 1;
+		}
+		clearerr(file);
+		if ((fseek(file, from, SEEK_SET) != 0) || (! findStart(file)))
+		{
+			if (at_end)
+			{
+				fprintf(stderr, "log ends in the middle of a record\n");
+			}
+			else
+			{
+				fprintf(stderr, "no log starts after the bad record\n");
+				status = 1;
+			}
+			break;
+		}
+
+		fprintf(stderr, "bad record after %u lines, skipped to the log that starts "
+			"at byte %ld\n", lines, ftell(file));
+		recent_count = 0;
+	}
+
+	fclose(file);
+	return status;
+}
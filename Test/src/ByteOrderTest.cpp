@@ -0,0 +1,295 @@
+/*******************************************************************************
+ *
+ * File: ByteOrderTest.cpp
+ *	Checks gsi::ByteOrder against htons() and htonl() and reports how fast
+ *	it converts
+ *
+ *	usage: ByteOrderTest [repeat_count]
+ *
+ *	Every count up to MAX_COUNT is converted at every alignment of the
+ *	source and destination and in place, so the SIMD blocks, the values
+ *	left over after them, and unaligned loads and stores are all covered.
+ *	The test is built once with ByteOrder as it is in gsi and again with it
+ *	compiled for SSSE3 and for AVX2 (ByteOrderTest_ssse3, _avx2), those skip
+ *	themselves on a CPU that does not have the instructions.  The
+ *	throughput is timed over repeat_count conversions (default
+ *	BENCH_REPEAT) of BENCH_COUNT values.
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+
+#include <vector>
+
+#include "gsi/ByteOrder.h"
+#include "gsi/Time.h"
+
+using namespace gsi;
+
+static const uint32_t MAX_COUNT = 100;		// several 32 byte blocks and a tail
+static const uint32_t BENCH_COUNT = 65536;
+static const uint32_t BENCH_REPEAT = 2000;
+
+typedef void (*ConvertFunction)(const void *src, void *dest, uint32_t count);
+
+/*******************************************************************************
+ *
+ * @return	the name of the ByteOrder code this executable was built with
+ *
+ ******************************************************************************/
+static const char *getPath(void)
+{
+#if defined(GSI_BIG_ENDIAN)
+	return "big endian copy";
+#elif defined(__AVX2__)
+	return "AVX2";
+#elif defined(__SSSE3__)
+	return "SSSE3";
+#else
+	return "scalar";
+#endif
+}
+
+/*******************************************************************************
+ *
+ * @return	false if ByteOrder was built for instructions this CPU does not
+ *			have
+ *
+ ******************************************************************************/
+static bool isSupported(void)
+{
+#if defined(__GNUC__) && defined(__AVX2__)
+	return __builtin_cpu_supports("avx2");
+#elif defined(__GNUC__) && defined(__SSSE3__)
+	return __builtin_cpu_supports("ssse3");
+#else
+	return true;
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Fill the values of an array in host order, the bytes of each value are
+ * all different so a swap in the wrong place shows.
+ *
+ ******************************************************************************/
+static void fillValues(uint8_t *bytes, uint32_t length)
+{
+	for (uint32_t i = 0; i < length; i++)
+	{
+		bytes[i] = (uint8_t)(i * 7 + 1);
+	}
+}
+
+/*******************************************************************************
+ *
+ * Convert the values with ByteOrder and with htons() or htonl(), and
+ * compare.  The bytes past the end of the destination must not change.
+ *
+ * @param	width	2 or 4
+ *
+ ******************************************************************************/
+static bool checkConvert(const char *name, ConvertFunction convert, uint32_t width,
+	uint32_t count, uint32_t src_offset, uint32_t dest_offset, bool in_place)
+{
+	uint8_t src_buffer[MAX_COUNT * 4 + 8];
+	uint8_t dest_buffer[MAX_COUNT * 4 + 8];
+	uint8_t expect[MAX_COUNT * 4 + 8];
+
+	fillValues(src_buffer, sizeof(src_buffer));
+	memset(dest_buffer, 0xA5, sizeof(dest_buffer));
+
+	uint8_t *src = &src_buffer[src_offset];
+	uint8_t *dest = in_place ? src : &dest_buffer[dest_offset];
+
+	// expect starts as the buffer that is converted into
+	uint8_t *result = in_place ? src_buffer : dest_buffer;
+	memcpy(expect, result, sizeof(expect));
+	uint8_t *expect_dest = &expect[in_place ? src_offset : dest_offset];
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (width == 2)
+		{
+			uint16_t v;
+			memcpy(&v, &src[i * 2], sizeof(v));
+			v = htons(v);
+			memcpy(&expect_dest[i * 2], &v, sizeof(v));
+		}
+		else
+		{
+			uint32_t v;
+			memcpy(&v, &src[i * 4], sizeof(v));
+			v = htonl(v);
+			memcpy(&expect_dest[i * 4], &v, sizeof(v));
+		}
+	}
+
+	convert(src, dest, count);
+
+	if (memcmp(result, expect, sizeof(expect)) != 0)
+	{
+		printf("FAIL - %s of %u values, src offset %u, dest offset %u%s\n",
+			name, count, src_offset, dest_offset, in_place ? ", in place" : "");
+		return false;
+	}
+
+	return true;
+}
+
+/*******************************************************************************
+ *
+ * Check one function at every count, every alignment, and in place.
+ *
+ ******************************************************************************/
+static bool checkFunction(const char *name, ConvertFunction convert, uint32_t width)
+{
+	bool ok = true;
+	for (uint32_t count = 0; count <= MAX_COUNT; count++)
+	{
+		for (uint32_t src_offset = 0; src_offset < 4; src_offset++)
+		{
+			for (uint32_t dest_offset = 0; dest_offset < 4; dest_offset++)
+			{
+				ok = checkConvert(name, convert, width, count, src_offset,
+					dest_offset, false) && ok;
+			}
+
+			ok = checkConvert(name, convert, width, count, src_offset,
+				src_offset, true) && ok;
+		}
+	}
+
+	return ok;
+}
+
+/*******************************************************************************
+ *
+ * A float converted as a 32 bit value comes back the same.
+ *
+ ******************************************************************************/
+static bool checkFloats(void)
+{
+	float values[MAX_COUNT];
+	float net[MAX_COUNT];
+	float back[MAX_COUNT];
+	for (uint32_t i = 0; i < MAX_COUNT; i++)
+	{
+		values[i] = i * -1.25f + 0.1f;
+	}
+
+	ByteOrder::toNet32(values, net, MAX_COUNT);
+	ByteOrder::fromNet32(net, back, MAX_COUNT);
+
+	for (uint32_t i = 0; i < MAX_COUNT; i++)
+	{
+		uint32_t v;
+		memcpy(&v, &values[i], sizeof(v));
+		v = htonl(v);
+		if ((memcmp(&net[i], &v, sizeof(v)) != 0) || (back[i] != values[i]))
+		{
+			printf("FAIL - float %u did not convert\n", i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*******************************************************************************
+ *
+ * Print how fast ByteOrder and a loop of htons() or htonl() convert.
+ *
+ ******************************************************************************/
+static void reportThroughput(const char *name, ConvertFunction convert, uint32_t width,
+	uint32_t repeat_count)
+{
+	std::vector<uint8_t> src(BENCH_COUNT * width + 1);
+	std::vector<uint8_t> dest(BENCH_COUNT * width + 1);
+	fillValues(&src[0], src.size());
+
+	double start = Time::getMonotonicTime();
+	for (uint32_t r = 0; r < repeat_count; r++)
+	{
+		convert(&src[1], &dest[1], BENCH_COUNT);
+	}
+	double convert_time = Time::getMonotonicTime() - start;
+
+	start = Time::getMonotonicTime();
+	for (uint32_t r = 0; r < repeat_count; r++)
+	{
+		uint8_t *s = &src[1];
+		uint8_t *d = &dest[1];
+		for (uint32_t i = 0; i < BENCH_COUNT; i++)
+		{
+			if (width == 2)
+			{
+				uint16_t v;
+				memcpy(&v, &s[i * 2], sizeof(v));
+				v = htons(v);
+				memcpy(&d[i * 2], &v, sizeof(v));
+			}
+			else
+			{
+				uint32_t v;
+				memcpy(&v, &s[i * 4], sizeof(v));
+				v = htonl(v);
+				memcpy(&d[i * 4], &v, sizeof(v));
+			}
+		}
+	}
+	double loop_time = Time::getMonotonicTime() - start;
+
+	double bytes = (double)BENCH_COUNT * width * repeat_count;
+	printf("%-10s unaligned  ByteOrder %8.1f MB/s   htons/htonl loop %8.1f MB/s\n",
+		name, bytes / convert_time / 1e6, bytes / loop_time / 1e6);
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+int main(int argc, char **argv)
+{
+	uint32_t repeat_count = BENCH_REPEAT;
+	if (argc > 1)
+	{
+		repeat_count = (uint32_t)strtoul(argv[1], NULL, 0);
+	}
+
+	if (repeat_count == 0)
+	{
+		fprintf(stderr, "usage: %s [repeat_count]\n", argv[0]);
+		return 1;
+	}
+
+	if (! isSupported())
+	{
+		printf("ByteOrder built for %s, which this CPU does not have, skipped\n",
+			getPath());
+		return 0;
+	}
+
+	printf("ByteOrder built for %s\n", getPath());
+
+	bool ok = true;
+	ok = checkFunction("toNet16", ByteOrder::toNet16, 2) && ok;
+	ok = checkFunction("fromNet16", ByteOrder::fromNet16, 2) && ok;
+	ok = checkFunction("toNet32", ByteOrder::toNet32, 4) && ok;
+	ok = checkFunction("fromNet32", ByteOrder::fromNet32, 4) && ok;
+	ok = checkFloats() && ok;
+
+	reportThroughput("toNet16", ByteOrder::toNet16, 2, repeat_count);
+	reportThroughput("toNet32", ByteOrder::toNet32, 4, repeat_count);
+
+	printf("%s\n", ok ? "all conversions match" : "FAIL");
+	return ok ? 0 : 1;
+}
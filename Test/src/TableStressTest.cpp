@@ -0,0 +1,416 @@
+/*******************************************************************************
+ *
+ * File: TableStressTest.cpp
+ *	Several threads read a UdpValueTable while another sets it at 1 kHz
+ *
+ *	usage: TableStressTest [seconds]
+ *
+ *	The writer flips a float and a string between two values and adds new
+ *	parameters while READER_COUNT threads read them by ID, by name, and
+ *	through a ParamHandle.  A reader that sees anything but one of the two
+ *	values, such as a string mixing both, fails the test.  The writer also
+ *	reports how late it ran since the readers should not hold it up.
+ *
+ *	At the same time ADDER_COUNT threads add and subscribe to parameters,
+ *	some shared by every adder and some only their own, half subscribing
+ *	before they add and half after.  Once they are done a peer table sends
+ *	every one of those parameters a new value, each adder's listener must
+ *	be told about exactly the parameters it subscribed to.
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "gsi/Atomic.h"
+#include "gsi/Thread.h"
+#include "gsi/Time.h"
+
+#include "gsu/UdpValueTable.h"
+
+using namespace gsi;
+using namespace gsu;
+
+static const uint32_t READER_COUNT = 4;
+static const uint32_t ADDED_COUNT = 300;
+static const uint32_t ADDER_COUNT = 3;
+static const uint32_t SHARED_COUNT = 100;	// added by every adder
+static const uint32_t OWN_COUNT = 50;		// added by one adder each
+static const double NOTIFY_TIMEOUT = 3.0;
+static const double WRITE_PERIOD = 0.001;
+
+static const float FLOAT_A = 1.0f;
+static const float FLOAT_B = 2.0f;
+static const std::string STRING_A("aaaa");
+static const std::string STRING_B(UdpValueTableParameter::MAX_STR_LENGTH, 'b');
+
+/*******************************************************************************
+ *
+ * Reads the table as fast as it can until asked to stop.
+ *
+ ******************************************************************************/
+class Reader : public Thread
+{
+	public:
+		Reader(UdpValueTable *table) : Thread("TableStressTest reader")
+		{
+			reader_table = table;
+			read_count = 0;
+			bad_count = 0;
+		}
+
+		uint32_t getReadCount(void)	{ return Atomic::loadAcquire(&read_count); }
+		uint32_t getBadCount(void)	{ return Atomic::loadAcquire(&bad_count); }
+
+	protected:
+		void run(void)
+		{
+			ParamHandle<std::string> text = reader_table->getHandle<std::string>("text", STRING_A);
+			uint16_t value_id = reader_table->getId("value");
+			char name[32];
+			uint32_t reads = 0;
+
+			while (! isStopRequested())
+			{
+				std::string s = text.get();
+				if ((s != STRING_A) && (s != STRING_B))
+				{
+					Atomic::fetchAdd(&bad_count, 1);
+				}
+
+				float f = reader_table->get<float>(value_id, -1.0f);
+				if ((f != FLOAT_A) && (f != FLOAT_B))
+				{
+					Atomic::fetchAdd(&bad_count, 1);
+				}
+
+				// may or may not have been added yet
+				uint32_t n = reads % ADDED_COUNT;
+				sprintf(name, "added%u", n);
+				int32_t v = reader_table->get<int32_t>(name, -1);
+				if ((v != -1) && (v != (int32_t)n))
+				{
+					Atomic::fetchAdd(&bad_count, 1);
+				}
+
+				reads++;
+				Atomic::storeRelease(&read_count, reads);
+			}
+		}
+
+	private:
+		UdpValueTable *reader_table;
+		volatile uint32_t read_count;
+		volatile uint32_t bad_count;
+};
+
+/*******************************************************************************
+ *
+ * Notes which parameters it was told about, and counts the ones it did not
+ * subscribe to.
+ *
+ ******************************************************************************/
+class AdderListener : public UdpValueTableListener
+{
+	public:
+		AdderListener(uint32_t adder)
+		{
+			listener_adder = adder;
+			bad_count = 0;
+			for (uint32_t i = 0; i < UdpValueTable::MAX_PARAMETERS; i++)
+			{
+				notified[i] = 0;
+			}
+		}
+
+		void valueChanged(UdpValueTable *table, uint16_t id)
+		{
+			if (! isSubscribed(table->getName(id)))
+			{
+				Atomic::fetchAdd(&bad_count, 1);
+			}
+			else if (id < UdpValueTable::MAX_PARAMETERS)
+			{
+				Atomic::storeRelease(&notified[id], 1);
+			}
+		}
+
+		bool isSubscribed(const std::string &name)
+		{
+			char own[32];
+			sprintf(own, "own%u_", listener_adder);
+			return (name.compare(0, 6, "shared") == 0) ||
+				(name.compare(0, strlen(own), own) == 0);
+		}
+
+		bool wasNotified(uint16_t id)
+		{
+			return (id < UdpValueTable::MAX_PARAMETERS) && Atomic::loadAcquire(&notified[id]);
+		}
+
+		uint32_t getBadCount(void)	{ return Atomic::loadAcquire(&bad_count); }
+
+	private:
+		uint32_t listener_adder;
+		volatile uint32_t notified[UdpValueTable::MAX_PARAMETERS];
+		volatile uint32_t bad_count;
+};
+
+/*******************************************************************************
+ *
+ * Adds the shared parameters and its own, and subscribes to them.
+ *
+ ******************************************************************************/
+class Adder : public Thread
+{
+	public:
+		Adder(UdpValueTable *table, uint32_t adder)
+			: Thread("TableStressTest adder"), listener(adder)
+		{
+			adder_table = table;
+			adder_index = adder;
+		}
+
+		AdderListener listener;
+
+	protected:
+		void run(void)
+		{
+			char name[32];
+			for (uint32_t i = 0; i < SHARED_COUNT + OWN_COUNT; i++)
+			{
+				if (i < SHARED_COUNT)
+				{
+					sprintf(name, "shared%u", i);
+				}
+				else
+				{
+					sprintf(name, "own%u_%u", adder_index, i - SHARED_COUNT);
+				}
+
+				// half subscribe by name before the parameter may exist
+				if ((i + adder_index) & 1)
+				{
+					adder_table->subscribe(name, &listener);
+					adder_table->put<int32_t>(name, 0, false);
+				}
+				else
+				{
+					adder_table->put<int32_t>(name, 0, false);
+					adder_table->subscribe(name, &listener);
+				}
+			}
+		}
+
+	private:
+		UdpValueTable *adder_table;
+		uint32_t adder_index;
+};
+
+/*******************************************************************************
+ *
+ * Have the peer table send a new value of every parameter the adders
+ * added, then wait for every listener to be told about each one it
+ * subscribed to.
+ *
+ * @return	the number of missed or wrong notifications
+ *
+ ******************************************************************************/
+static uint32_t checkAdders(UdpValueTable *table, UdpValueTable *peer, Adder **adders)
+{
+	char name[32];
+	std::vector<std::string> names;
+	for (uint32_t i = 0; i < SHARED_COUNT; i++)
+	{
+		sprintf(name, "shared%u", i);
+		names.push_back(name);
+	}
+	for (uint32_t a = 0; a < ADDER_COUNT; a++)
+	{
+		for (uint32_t i = 0; i < OWN_COUNT; i++)
+		{
+			sprintf(name, "own%u_%u", a, i);
+			names.push_back(name);
+		}
+	}
+
+	uint32_t missing = 0;
+	for (uint32_t i = 0; i < names.size(); i++)
+	{
+		if (table->getId(names[i]) == UdpValueTable::INVALID_ID)
+		{
+			printf("FAIL - parameter %s was not added\n", names[i].c_str());
+			missing++;
+		}
+		peer->put<int32_t>(names[i], 1);
+	}
+
+	double give_up = Time::getMonotonicTime() + NOTIFY_TIMEOUT;
+	uint32_t unnotified;
+	do
+	{
+		Thread::sleep(0.01);
+		unnotified = 0;
+		for (uint32_t a = 0; a < ADDER_COUNT; a++)
+		{
+			for (uint32_t i = 0; i < names.size(); i++)
+			{
+				if (adders[a]->listener.isSubscribed(names[i]) &&
+					! adders[a]->listener.wasNotified(table->getId(names[i])))
+				{
+					unnotified++;
+				}
+			}
+		}
+	} while ((unnotified != 0) && (Time::getMonotonicTime() < give_up));
+
+	uint32_t bad = 0;
+	for (uint32_t a = 0; a < ADDER_COUNT; a++)
+	{
+		bad += adders[a]->listener.getBadCount();
+	}
+
+	printf("%u adders added %u parameters, %u notifications missed, %u for parameters not subscribed to\n",
+		ADDER_COUNT, (uint32_t)names.size(), unnotified, bad);
+
+	return missing + unnotified + bad;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+int main(int argc, char **argv)
+{
+	double seconds = 2.0;
+	if (argc > 1)
+	{
+		seconds = atof(argv[1]);
+	}
+
+	tinyxml2::XMLDocument doc;
+	doc.Parse("<table local_host=\"127.0.0.1\" remote_host=\"127.0.0.1\" "
+		"local_port=\"46310\" remote_port=\"46311\" period=\"0.02\"/>");
+	UdpValueTable *table = new UdpValueTable("stress", doc.FirstChildElement());
+
+	// sends the adders' parameters back to the table so listeners are told
+	tinyxml2::XMLDocument peer_doc;
+	peer_doc.Parse("<table local_host=\"127.0.0.1\" remote_host=\"127.0.0.1\" "
+		"local_port=\"46311\" remote_port=\"46310\" period=\"0.02\" coalesce=\"true\"/>");
+	UdpValueTable *peer = new UdpValueTable("stress_peer", peer_doc.FirstChildElement());
+
+	table->put<float>("value", FLOAT_A, false);
+	table->put<std::string>("text", STRING_A, false);
+	uint16_t value_id = table->getId("value");
+	uint16_t text_id = table->getId("text");
+
+	Reader *readers[READER_COUNT];
+	for (uint32_t i = 0; i < READER_COUNT; i++)
+	{
+		readers[i] = new Reader(table);
+		readers[i]->start();
+	}
+
+	Adder *adders[ADDER_COUNT];
+	for (uint32_t i = 0; i < ADDER_COUNT; i++)
+	{
+		adders[i] = new Adder(table, i);
+		adders[i]->start();
+	}
+
+	uint32_t write_count = (uint32_t)(seconds / WRITE_PERIOD);
+	double max_late = 0.0;
+	char name[32];
+
+	double start = Time::getMonotonicTime();
+	for (uint32_t i = 0; i < write_count; i++)
+	{
+		double due = start + i * WRITE_PERIOD;
+		Thread::sleepUntil(due);
+
+		double late = Time::getMonotonicTime() - due;
+		if (late > max_late)
+		{
+			max_late = late;
+		}
+
+		table->put<float>(value_id, (i & 1) ? FLOAT_B : FLOAT_A, false);
+		table->put<std::string>(text_id, (i & 1) ? STRING_B : STRING_A, false);
+
+		if (i < ADDED_COUNT)
+		{
+			sprintf(name, "added%u", i);
+			table->put<int32_t>(name, (int32_t)i, false);
+		}
+	}
+
+	for (uint32_t i = 0; i < ADDER_COUNT; i++)
+	{
+		while (adders[i]->isRunning())
+		{
+			Thread::sleep(0.001);
+		}
+	}
+
+	uint32_t reads = 0;
+	uint32_t bad = 0;
+	for (uint32_t i = 0; i < READER_COUNT; i++)
+	{
+		readers[i]->requestStop();
+		while (readers[i]->isRunning())
+		{
+			Thread::sleep(0.001);
+		}
+
+		reads += readers[i]->getReadCount();
+		bad += readers[i]->getBadCount();
+		delete readers[i];
+	}
+
+	printf("%u writes, %u reads by %u readers, %u bad, writer at most %.3f ms late\n",
+		write_count, reads, READER_COUNT, bad, max_late * 1000.0);
+
+	int status = 0;
+	if (bad != 0)
+	{
+		printf("FAIL - a reader saw a torn or wrong value\n");
+		status = 1;
+	}
+
+	uint32_t added = (write_count < ADDED_COUNT) ? write_count : ADDED_COUNT;
+	for (uint32_t i = 0; i < added; i++)
+	{
+		sprintf(name, "added%u", i);
+		if (table->get<int32_t>(name, -1) != (int32_t)i)
+		{
+			printf("FAIL - parameter %s was lost\n", name);
+			status = 1;
+		}
+	}
+
+	if (checkAdders(table, peer, adders) != 0)
+	{
+		printf("FAIL - a parameter or a subscription was lost while adding\n");
+		status = 1;
+	}
+
+	// the tables' threads are stopped but they are not deleted, their
+	// receivers may still be blocked on the socket, and the listeners stay
+	// subscribed
+	table->requestStop();
+	peer->requestStop();
+	while (table->isRunning() || peer->isRunning())
+	{
+		Thread::sleep(0.001);
+	}
+
+	return status;
+}
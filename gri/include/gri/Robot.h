@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "gsi/PeriodicThread.h"
+#include "gsi/TaskPool.h"
 #include "gri/tinyxml2.h"
 
 
@@ -36,6 +37,9 @@ else\
 //Defualts
 #define DEFUALT_MAIN_THREAD_PERIOD 0.05
 #define DEFUALT_MAIN_THREAD_PRIORITY 0
+#define DEFUALT_MAIN_THREAD_CPU gsi::Thread::CPU_ANY
+#define DEFUALT_MAIN_THREAD_STACK_SIZE gsi::Thread::STACK_SIZE_DEFAULT
+#define DEFUALT_MAIN_THREAD_WORKERS 0
 
 
 namespace gri
@@ -57,9 +61,14 @@ class Robot: public gsi::PeriodicThread
 		
 		enum Mode {DISABLED = 0, TELEOP, AUTONOMOUS, EMERGANCY_STOP};
 	protected:
+		void initialize();
 		void doPeriodic();
+		void finalize();
+		gsi::TaskPool* getTaskPool();
 		XMLDocument* settings_file;
 	private:
+		gsi::TaskPool* task_pool;
+		int worker_count;
 		Mode mode;
 		bool reinit;
 		bool settings_file_exists;
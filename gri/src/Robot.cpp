@@ -8,6 +8,8 @@ Robot::Robot(): gsi::PeriodicThread("MainRobotThread",0.01)
 	//printf("Robot\n");
 	reinit = true;
 	mode = DISABLED;
+	task_pool = NULL;
+	worker_count = DEFUALT_MAIN_THREAD_WORKERS;
 	FILE* s_file = fopen("RobotSettings.xml","r");
 	if(s_file == NULL)
 	{
@@ -39,6 +41,13 @@ void Robot::loadSettings(XMLDocument* doc)
 	XMLElement* robot = doc->FirstChildElement("Robot");
 	if(robot != NULL)
 	{
+		XMLElement* lock_memory = robot->FirstChildElement("LockMemory");
+		if(lock_memory != NULL && lock_memory->GetText() != NULL
+			&& std::string(lock_memory->GetText()).compare("true") == 0)
+		{
+			gsi::Thread::lockMemory();
+		}
+
 		XMLElement* main_thread = robot->FirstChildElement("MainThread");
 		if(main_thread != NULL)
 		{
@@ -48,6 +57,21 @@ void Robot::loadSettings(XMLDocument* doc)
 			setPeriod(period);
 			GET_XML_FLOAT(main_thread,Priority,priority,DEFUALT_MAIN_THREAD_PRIORITY);
 			setPriority(static_cast<gsi::Thread::ThreadPriority>(priority));
+
+			// real-time policy, CPU, and stack size are used when the thread starts
+			XMLElement* sched_policy = main_thread->FirstChildElement("SchedPolicy");
+			if(sched_policy != NULL && sched_policy->GetText() != NULL)
+			{
+				addOptions(gsi::Thread::getSchedulingOptions(sched_policy->GetText()));
+			}
+			int cpu = 0;
+			GET_XML_INT(main_thread,Cpu,cpu,DEFUALT_MAIN_THREAD_CPU);
+			setAffinity(cpu);
+			int stack_size = 0;
+			GET_XML_INT(main_thread,StackSize,stack_size,DEFUALT_MAIN_THREAD_STACK_SIZE);
+			setStackSize(stack_size);
+			// worker threads for the subsystem updates spawned from the periodic methods
+			GET_XML_INT(main_thread,Workers,worker_count,DEFUALT_MAIN_THREAD_WORKERS);
 			//printf("Period is: %.3f\n",period);
 			//printf("Values: %s\n",main_thread->FirstChildElement("Period")->GetText());
 			//setPeriod()
@@ -65,6 +89,43 @@ void Robot::loadSettings(XMLDocument* doc)
 	}
 }
 
+void Robot::initialize()
+{
+	// the workers run at the main thread's priority so a join is not held
+	// up by lower priority threads
+	if(worker_count > 0)
+	{
+		task_pool = new gsi::TaskPool("RobotTaskPool",worker_count,getPriority(),getOptions(),getStackSize());
+		task_pool->start();
+	}
+}
+
+void Robot::finalize()
+{
+	if(task_pool != NULL)
+	{
+		delete task_pool;
+		task_pool = NULL;
+	}
+}
+
+/*
+ * Independent subsystem updates can be run in parallel from the periodic
+ * methods, they are all done when wait() returns:
+ *
+ *	gsi::TaskGroup group(getTaskPool());
+ *	group.spawn(&drive);
+ *	group.spawn(&arm);
+ *	group.wait();
+ *
+ * This is NULL if no Workers are configured, a TaskGroup then runs the
+ * tasks as they are spawned.
+ */
+gsi::TaskPool* Robot::getTaskPool()
+{
+	return task_pool;
+}
+
 void Robot::doPeriodic()
 {
 	switch(mode)
@@ -0,0 +1,136 @@
+/*******************************************************************************
+ *
+ * File: Atomic.h
+ *	Generic System Interface atomic operations wrapper
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#pragma once
+
+#if defined(PTHREADS)
+#include <stdint.h>
+
+#elif defined(VXWORKS) || defined(_WRS_KERNEL)
+#include <stdint.h>
+
+#elif defined(_WINDOWS)
+#include <stdint.h>
+#include <windows.h>
+
+#else
+#pragma warning("Supported platform is not defined")
+
+#endif
+
+namespace gsi
+{
+
+/*******************************************************************************
+ *
+ * This class provides a platform independent interface to the small set of
+ * atomic operations needed to pass data between threads without a Mutex.
+ *
+ * Loads use acquire ordering and stores use release ordering, so a value
+ * written before a storeRelease() is visible to any thread that observes
+ * the stored value with loadAcquire().  acquireFence() keeps earlier
+ * loads from moving after later ones, as needed by seqlock readers.
+ *
+ ******************************************************************************/
+class Atomic
+{
+	public:
+		// Variables that are written by one thread and read by another
+		// should be padded to this size so they do not share a cache line
+		static const uint32_t CACHE_LINE_SIZE = 64;
+
+		static inline uint32_t loadAcquire(volatile uint32_t *src);
+		static inline void storeRelease(volatile uint32_t *dest, uint32_t val);
+		static inline uint32_t fetchAdd(volatile uint32_t *dest, uint32_t val);
+		static inline bool compareExchange(volatile uint32_t *dest,
+			uint32_t expected, uint32_t desired);
+		static inline void fence(void);
+		static inline void acquireFence(void);
+};
+
+#if defined(PTHREADS) || defined(VXWORKS) || defined(_WRS_KERNEL)
+// GCC and Clang provide these builtins on all supported targets
+
+inline uint32_t Atomic::loadAcquire(volatile uint32_t *src)
+{
+	return __atomic_load_n(src, __ATOMIC_ACQUIRE);
+}
+
+inline void Atomic::storeRelease(volatile uint32_t *dest, uint32_t val)
+{
+	__atomic_store_n(dest, val, __ATOMIC_RELEASE);
+}
+
+inline uint32_t Atomic::fetchAdd(volatile uint32_t *dest, uint32_t val)
+{
+	return __atomic_fetch_add(dest, val, __ATOMIC_ACQ_REL);
+}
+
+inline bool Atomic::compareExchange(volatile uint32_t *dest, uint32_t expected,
+	uint32_t desired)
+{
+	return __atomic_compare_exchange_n(dest, &expected, desired, false,
+		__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+inline void Atomic::fence(void)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+inline void Atomic::acquireFence(void)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+}
+
+#elif defined(_WINDOWS)
+// On x86 aligned 32-bit loads and stores are atomic, the barriers keep the
+// compiler from reordering around them
+
+inline uint32_t Atomic::loadAcquire(volatile uint32_t *src)
+{
+	uint32_t val = *src;
+	_ReadWriteBarrier();
+	return val;
+}
+
+inline void Atomic::storeRelease(volatile uint32_t *dest, uint32_t val)
+{
+	_ReadWriteBarrier();
+	*dest = val;
+}
+
+inline uint32_t Atomic::fetchAdd(volatile uint32_t *dest, uint32_t val)
+{
+	return (uint32_t)InterlockedExchangeAdd((volatile LONG *)dest, (LONG)val);
+}
+
+inline bool Atomic::compareExchange(volatile uint32_t *dest, uint32_t expected,
+	uint32_t desired)
+{
+	return ((uint32_t)InterlockedCompareExchange((volatile LONG *)dest,
+		(LONG)desired, (LONG)expected) == expected);
+}
+
+inline void Atomic::fence(void)
+{
+	MemoryBarrier();
+}
+
+inline void Atomic::acquireFence(void)
+{
+	_ReadWriteBarrier();
+}
+
+#endif
+
+} // namespace gsi
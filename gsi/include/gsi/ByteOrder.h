@@ -0,0 +1,51 @@
+/*******************************************************************************
+ *
+ * File: ByteOrder.h
+ *	Generic System Interface batch byte order conversion
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <stdint.h>
+
+#if defined(__BIG_ENDIAN__) || defined(_BIG_ENDIAN) || \
+	(defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__))
+#define GSI_BIG_ENDIAN
+#endif
+
+namespace gsi
+{
+
+/*******************************************************************************
+ *
+ * This class converts arrays of 16 and 32 bit values between host and
+ * network byte order, for code that sends or receives many values at a
+ * time.
+ *
+ * On little endian hosts the bytes of each value are reversed, with AVX2
+ * or SSSE3 byte shuffles when the compiler targets them (-mavx2, -mssse3,
+ * or a -march that has them) and one value at a time otherwise.  On big
+ * endian hosts the values are copied.  The source and destination may be
+ * the same array but may not otherwise overlap, and neither has to be
+ * aligned.  Floats are converted as 32 bit values.
+ *
+ ******************************************************************************/
+class ByteOrder
+{
+	public:
+		static void toNet16(const void *src, void *dest, uint32_t count);
+		static void toNet32(const void *src, void *dest, uint32_t count);
+		static void fromNet16(const void *src, void *dest, uint32_t count);
+		static void fromNet32(const void *src, void *dest, uint32_t count);
+
+		static void swap16(const void *src, void *dest, uint32_t count);
+		static void swap32(const void *src, void *dest, uint32_t count);
+};
+
+} // namespace gsi
@@ -0,0 +1,152 @@
+/*******************************************************************************
+ *
+ * File: FlightRecorder.h
+ *	Generic System Interface crash-safe ring of recent records
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace gsi
+{
+
+/*******************************************************************************
+ *
+ * This class keeps the most recent log lines, value table updates, and
+ * periodic thread timing samples of the whole program in a fixed size ring
+ * that is mapped from a file.
+ *
+ * Recording a record takes one atomic add and copies into the mapped memory,
+ * there are no system calls and no locks, and when the recorder is not open
+ * a record call returns right away.  Because the ring is the file's memory,
+ * whatever was recorded is in the file even if the program dies without
+ * running any more code.  When a gsi::Exception is made, when a Thread's run()
+ * throws, or on a fatal signal (SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT),
+ * the recorder records why, and then asks for the file to be written to
+ * disk, so the dump also survives losing power.  After a fatal signal the
+ * signal's default action still happens.
+ *
+ * The file has a header followed by RECORD_SIZE byte slots.  A record longer
+ * than DATA_LENGTH bytes takes several slots in a row, each slot has the part
+ * of the record it holds.  Each slot's sequence is 0 while it is written and
+ * one more than the number of slots handed out before it once it is done, so
+ * the FlightReader tool can put the slots in order and skip any that were
+ * torn by a crash.  The numbers are in the byte order of the computer that
+ * recorded them, the header says which.
+ *
+ * When open() finds a dump left by an earlier run it renames it to the same
+ * name with ".1" added so it is not lost.
+ *
+ * open() must be called before other threads record and close() after they
+ * stop.  On platforms without mmap the ring is in memory and is written to
+ * the file only when flushed.
+ *
+ ******************************************************************************/
+class FlightRecorder
+{
+	public:
+		static const uint32_t RECORD_SIZE = 64;
+		static const uint32_t DATA_LENGTH = 48;
+		static const uint32_t NAME_LENGTH = 16;
+		static const uint32_t REASON_LENGTH = 128;
+		static const uint32_t DEFAULT_RECORD_COUNT = 8192;
+		static const uint32_t VERSION = 1;
+		static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+		enum RecordKind
+		{
+			RECORD_LOG = 1,
+			RECORD_VALUE,
+			RECORD_TIMING,
+			RECORD_EXCEPTION,
+			RECORD_THREAD_EXCEPTION,
+			RECORD_SIGNAL,
+			RECORD_NOTE
+		};
+
+		typedef struct
+		{
+			char magic[8];				// "GSIFDR\0\0"
+			uint32_t byte_order;		// BYTE_ORDER_MARK
+			uint32_t version;
+			uint32_t header_size;
+			uint32_t record_size;
+			uint32_t record_count;
+			volatile uint32_t next;		// slots handed out
+			volatile uint32_t trigger_count;
+			int32_t trigger_code;
+			double start_time;
+			double start_monotonic;
+			double trigger_time;
+			char trigger_reason[REASON_LENGTH];
+			char pad[64];
+		} Header;
+
+		typedef struct
+		{
+			volatile uint32_t sequence;
+			uint8_t kind;
+			uint8_t part;
+			uint8_t parts;
+			uint8_t length;				// bytes of data used
+			double time;				// monotonic
+			uint8_t data[DATA_LENGTH];
+		} Record;
+
+		// the data of a RECORD_VALUE record, for a UdpValueTable the type is
+		// the parameter's type and the value is in network byte order
+		typedef struct
+		{
+			uint16_t id;
+			uint8_t type;
+			uint8_t length;
+			uint8_t value[DATA_LENGTH - 4];
+		} ValueSample;
+
+		// the data of a RECORD_TIMING record
+		typedef struct
+		{
+			double execution;
+			double latency;
+			uint32_t cycle;
+			uint32_t overruns;
+			char name[NAME_LENGTH];
+		} TimingSample;
+
+		static bool open(const char *file_name,
+			uint32_t record_count = DEFAULT_RECORD_COUNT, bool catch_signals = true);
+		static void close(void);
+		static bool isOpen(void)			{ return recorder_header != NULL; }
+
+		static void record(RecordKind kind, const void *data, uint32_t length,
+			double time = 0.0);
+		static void recordText(RecordKind kind, const char *text, double time = 0.0);
+		static void recordValue(uint16_t id, uint8_t type, const void *value,
+			uint32_t length);
+		static void recordTiming(const char *name, uint32_t cycle,
+			double execution, double latency, uint32_t overruns);
+
+		static void trigger(RecordKind kind, const char *reason, int32_t code);
+		static void flush(bool wait);
+
+	private:
+		static void catchSignals(bool on);
+		static void handleSignal(int sig);
+
+		static Header *recorder_header;
+		static Record *recorder_records;
+		static uint32_t recorder_mask;
+		static uint32_t recorder_bytes;
+		static int recorder_file;
+		static char *recorder_file_name;
+};
+
+} // namespace gsi
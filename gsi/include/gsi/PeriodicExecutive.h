@@ -0,0 +1,82 @@
+/*******************************************************************************
+ *
+ * File: PeriodicExecutive.h
+ * 	Generic System Interface Periodic Executive class
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <vector>
+
+#include "gsi/Thread.h"
+#include "gsi/PeriodicThread.h"
+#include "gsi/Mutex.h"
+
+namespace gsi
+{
+
+/*******************************************************************************
+ *
+ * This class runs the doPeriodic() method of many PeriodicThread objects
+ * from one thread, so periodic tasks do not each need a thread of their own.
+ *
+ * A PeriodicThread is added with addTask() instead of being started.  Each
+ * task keeps its own period and overrun policy.  Whenever more than one
+ * task is due, the task with the shortest period runs first (rate monotonic
+ * order), a task is never interrupted by another task of the same
+ * executive.  A task that ends after its next cycle should have started
+ * has missed its deadline, this is counted in the task's overrun count and
+ * in the executive's deadline miss count.
+ *
+ * The task's initialize() method is called from the executive's thread
+ * before its first cycle and finalize() after it is removed or stop is
+ * requested for it.  A task must not add or remove tasks from doPeriodic(),
+ * it may call its own requestStop() to be removed.
+ *
+ * Use more than one executive to spread tasks across threads or CPUs.
+ *
+ ******************************************************************************/
+class PeriodicExecutive : public Thread
+{
+	public:
+		static const double MAX_IDLE_TIME;
+
+		PeriodicExecutive(std::string name,
+			ThreadPriority priority = PRIORITY_DEFAULT,
+			uint32_t options = OPTIONS_DEFAULT,
+			uint32_t stack_size = STACK_SIZE_DEFAULT);
+
+		virtual ~PeriodicExecutive();
+
+		void addTask(PeriodicThread *task);
+		void removeTask(PeriodicThread *task);
+
+		uint32_t getTaskCount(void);
+		uint32_t getDeadlineMissCount(void);
+
+	protected:
+		virtual void run(void);
+
+	private:
+		typedef struct
+		{
+			PeriodicThread *task;
+			bool initialized;
+		} TaskEntry;
+
+		PeriodicThread *getReadyTask(double now, double *next_time);
+		void finalizeTask(TaskEntry &entry);
+
+		std::vector<TaskEntry> task_list;
+		Mutex task_lock;
+
+		uint32_t deadline_miss_count;
+};
+
+} // namespace gsi
@@ -13,11 +13,15 @@
 #pragma once
 
 #include "gsi/Thread.h"
+#include "gsi/TimingHistogram.h"
+#include "gsi/FlightRecorder.h"
 #include <stdio.h>
 
 namespace gsi
 {
 
+class PeriodicExecutive;
+
 /*******************************************************************************
  *
  * This class extands the Thread class with an implementation of the 
@@ -32,10 +36,46 @@ namespace gsi
  * when the init() method was called, how many times doPeriodic() has been called
  * since init() and the period.
  *
+ * Times come from the monotonic clock and the thread sleeps until an absolute
+ * time, so setting the system clock does not disturb the schedule and the
+ * time spent deciding how long to sleep does not add up as drift.
+ *
+ * When doPeriodic() runs past the start of the next cycle the overrun policy
+ * decides what happens:
+ *	OVERRUN_CATCH_UP	call doPeriodic() back to back until the missed
+ *						cycles are made up, then continue on the original
+ *						schedule (the default)
+ *	OVERRUN_SKIP		drop the missed cycles and wait for the next cycle
+ *						on the original schedule
+ *	OVERRUN_RESET		call doPeriodic() right away and start a new
+ *						schedule from that time
+ *
+ * Cycle, overrun, and skipped cycle counts and the wakeup jitter (how late
+ * the thread started a cycle it slept for) are kept for each thread.  Each
+ * thread also keeps histograms of how long doPeriodic() takes, the wakeup
+ * latency, and the period error (how far the time between the start of one
+ * cycle and the next is from the period, either way).  Other threads may
+ * read the histograms while this thread runs.  When the FlightRecorder is
+ * open each cycle's execution time and latency are also recorded there.
+ *
+ * Instead of starting its own thread, a PeriodicThread can be added to a
+ * PeriodicExecutive that calls doPeriodic() from a thread shared with other
+ * periodic tasks.  The period, overrun policy, and statistics work the same
+ * way, an overrun is a missed deadline.
+ *
  ******************************************************************************/
 class PeriodicThread : public Thread
 {
+	friend class PeriodicExecutive;
+
 	public:
+		enum OverrunPolicy
+		{
+			OVERRUN_CATCH_UP = 0,
+			OVERRUN_SKIP,
+			OVERRUN_RESET
+		};
+
 		PeriodicThread(std::string name, double period = 0.01, 
 			ThreadPriority priority = PRIORITY_DEFAULT,
 			uint32_t options = OPTIONS_DEFAULT, 
@@ -45,14 +85,50 @@ class PeriodicThread : public Thread
 
 		double getPeriod();
 		void setPeriod(double period);
+
+		OverrunPolicy getOverrunPolicy(void);
+		void setOverrunPolicy(OverrunPolicy policy);
+
+		uint32_t getCycleCount(void);
+		uint32_t getOverrunCount(void);
+		uint32_t getSkippedCount(void);
+		double getLastJitter(void);
+		double getMaxJitter(void);
+		double getAverageJitter(void);
+		void resetStatistics(void);
+
+		TimingHistogram &getExecutionHistogram(void);
+		TimingHistogram &getLatencyHistogram(void);
+		TimingHistogram &getPeriodErrorHistogram(void);
 		
 	protected:
 		virtual void run(void);
 		virtual void doPeriodic(void) = 0;
 
 	private:
+		void startCycles(double now);
+		void beginCycle(double now);
+		bool endCycle(double now);
+
 		double thread_next_time;
+		double thread_last_start;
+		bool thread_waited;
 		double thread_period;
+		OverrunPolicy thread_overrun_policy;
+
+		uint32_t cycle_count;
+		uint32_t overrun_count;
+		uint32_t skipped_count;
+		uint32_t jitter_count;
+		double last_jitter;
+		double max_jitter;
+		double total_jitter;
+
+		TimingHistogram execution_histogram;
+		TimingHistogram latency_histogram;
+		TimingHistogram period_error_histogram;
+
+		char recorder_name[FlightRecorder::NAME_LENGTH];
 };
 
 } // namespace gsi
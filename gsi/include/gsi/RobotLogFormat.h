@@ -0,0 +1,120 @@
+/*******************************************************************************
+ *
+ * File: RobotLogFormat.h
+ *	Generic System Interface printf argument packing and binary log records
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace gsi
+{
+
+/*******************************************************************************
+ *
+ * This class holds what RobotLogger and the LogDecoder tool share about
+ * formats and their arguments.
+ *
+ * A packed line is the tag, the format, and the arguments one after the
+ * other.  The tag and the format end with a null.  The arguments are in
+ * the order printf uses them, each * first, copied with memcpy in the
+ * host's size and byte order.  Strings are copied with their null.
+ *
+ * encodeArgs() rewrites the arguments of a packed line in a form that does
+ * not depend on the host and that is smaller: integers, pointers, and *
+ * as varints (signed ones zigzag encoded first, so small negative numbers
+ * stay small), every float as a little endian double, and strings with
+ * their null.  formatLine() makes the text of a line from encoded
+ * arguments, so a log written on the robot can be decoded on any computer.
+ *
+ * A varint is 7 bits of the number in each byte, lowest first, with the
+ * top bit set on every byte but the last.
+ *
+ * A binary log is a list of records, each starting with its kind byte:
+ *
+ *	RECORD_START	the magic "GLOG", uint16 version, double time, and
+ *					double monotonic time when the log was started, all
+ *					little endian
+ *	RECORD_SITE		varint ID, varint length, then the tag and format with
+ *					their nulls
+ *	RECORD_LINE		varint site ID, signed varint microseconds since the
+ *					time of the record before it, varint length, then the
+ *					encoded arguments
+ *	RECORD_TEXT		signed varint microseconds since the time of the
+ *					record before it, varint length, then the text of a
+ *					line that was formatted by the caller, without a null
+ *
+ * The time of the first line is from the monotonic time of RECORD_START.
+ * A site is written once, before the first line that uses it.  Site IDs
+ * start over after each RECORD_START, so logs may be appended to each other.
+ * A log has at most MAX_SITES sites, lines from any more are written as
+ * RECORD_TEXT.
+ *
+ ******************************************************************************/
+class RobotLogFormat
+{
+	public:
+		// how the argument of one conversion is passed
+		enum ArgKind
+		{
+			ARG_NONE,
+			ARG_INT,
+			ARG_LONG,
+			ARG_LONG_LONG,
+			ARG_SIZE,
+			ARG_DOUBLE,
+			ARG_LONG_DOUBLE,
+			ARG_STRING,
+			ARG_POINTER,
+			ARG_UNSUPPORTED
+		};
+
+		enum RecordKind
+		{
+			RECORD_START = 1,
+			RECORD_SITE = 2,
+			RECORD_LINE = 3,
+			RECORD_TEXT = 4
+		};
+
+		static const uint32_t MAGIC = 0x474F4C47;	// "GLOG" when written
+		static const uint16_t VERSION = 1;
+
+		static const uint32_t START_LENGTH = 23;
+		static const uint32_t MAX_SITES = 65536;
+		static const uint32_t MAX_HEADER_LENGTH = 31;	// kind and three varints
+
+		static const char *parseConversion(const char *p, ArgKind *kind, int *stars);
+		static uint32_t getArgSize(ArgKind kind);
+		static uint32_t getEncodedSize(ArgKind kind);
+
+		static uint32_t encodeArgs(const char *format, const char *args,
+			uint32_t length, uint8_t *dest, uint32_t size);
+		static uint32_t formatLine(const char *tag, const char *format,
+			const uint8_t *args, uint32_t length, char *text, uint32_t size);
+		static void keepNewline(char *text, uint32_t length, uint32_t size,
+			const char *format);
+
+		static void put16(uint8_t *dest, uint16_t v);
+		static void put32(uint8_t *dest, uint32_t v);
+		static void put64(uint8_t *dest, uint64_t v);
+		static void putDouble(uint8_t *dest, double v);
+		static uint32_t putVarint(uint8_t *dest, uint64_t v);
+		static uint32_t putSignedVarint(uint8_t *dest, int64_t v);
+		static uint16_t get16(const uint8_t *src);
+		static uint32_t get32(const uint8_t *src);
+		static uint64_t get64(const uint8_t *src);
+		static double getDouble(const uint8_t *src);
+		static uint32_t getVarint(const uint8_t *src, const uint8_t *end, uint64_t *v);
+		static uint32_t getSignedVarint(const uint8_t *src, const uint8_t *end, int64_t *v);
+};
+
+} // namespace gsi
@@ -2,9 +2,31 @@
  *
  * File: RobotLogger.h
  *  For detailed logging to both file and console simultaneously
- * 
+ *
  * Written by Joseph P. Foster
  *
+ * By default each line is formatted and written on the caller's thread.
+ * After startAsync() each thread that logs gets its own ring of lines.
+ * The caller only copies the tag, the format, and the arguments into its
+ * ring, a low priority writer thread formats the lines and writes them to
+ * the console and the log files.  Strings are copied, so any format and
+ * %s argument may be changed once the call returns.  Formats with %n or
+ * wide characters, or that do not fit in a line, are formatted by the
+ * caller.  Lines that do not fit in a full ring are counted by
+ * getDropCount().  Lines from different threads may be written out of
+ * order, lines from one thread stay in order.  Lines are cut off at
+ * LINE_LENGTH - 1 chars.
+ *
+ * After startBinary() the writer does not format the lines at all.  Each
+ * line goes to one binary log file as the ID of its tag and format, the
+ * monotonic time it was logged at, and its arguments, see RobotLogFormat.
+ * The tag and format are written once, the first time they are used.  The
+ * LogDecoder tool makes the text of the lines from the file later.  In
+ * binary mode nothing queued is written to the console or the text log
+ * files.
+ *
+ * When the FlightRecorder is open every line is also recorded there, by
+ * the writer when running asynchronously.
  *
  ***************************************************************************/
 #pragma once
@@ -12,21 +34,74 @@
 #include <stdarg.h>
 #include <string.h>
 
+#include "gsi/Thread.h"
+#include "gsi/Mutex.h"
+
 namespace gsi
 {
+class RobotLogWriter;
+
 class RobotLogger
 {
+	friend class RobotLogWriter;
+
 	public:
+		static const uint32_t LINE_LENGTH = 256;	// including the null
+		static const uint32_t RING_SIZE = 128;		// lines per thread, a power of 2
+		static const uint32_t MAX_THREADS = 32;		// more threads log synchronously
+		static const double WRITE_PERIOD;
+
 		RobotLogger(const char* name, const char* file_name = "\0");
 		~RobotLogger();
 		void robotPrintf(const char* format, ...);
 		static void initialize();
+		static void startAsync(Thread::ThreadPriority priority = Thread::PRIORITY_LOWEST);
+		static bool startBinary(const char* file_name,
+			Thread::ThreadPriority priority = Thread::PRIORITY_LOWEST);
 		static void anonymousPrintf(const char* format, ...);
+		static uint32_t getDropCount();
 		static void terminate();
 	private:
+		// data is the tag, the format, and the arguments, or when
+		// formatted is set the finished line
+		typedef struct
+		{
+			FILE* file;
+			double time;
+			uint16_t length;
+			uint8_t formatted;
+			char data[LINE_LENGTH];
+		} LogLine;
+
+		// written by one thread, read by the writer
+		typedef struct
+		{
+			volatile uint32_t head;
+			char pad[60];
+			volatile uint32_t tail;
+			LogLine lines[RING_SIZE];
+		} LogRing;
+
+		static bool queueLine(FILE* file, const char* tag, const char* format, va_list ap);
+		static bool packLine(LogLine* line, const char* tag, const char* format, va_list ap);
+		static void formatLine(LogLine* line, char* text);
+		static LogRing* getRing();
+		static uint32_t drain();
+		static void writeBinary(LogLine* line);
+
 		static FILE* def_log;
+		static FILE* binary_log;
+
+		static RobotLogWriter* writer;
+		static LogRing* rings[MAX_THREADS];
+		static int64_t ring_owners[MAX_THREADS];
+		static volatile uint32_t ring_ready[MAX_THREADS];
+		static volatile uint32_t ring_count;
+		static volatile uint32_t drop_count;
+		static Mutex drain_lock;
+
 		FILE* log;
+		bool owns_log;
 		char name[64];
 };
 }
-
@@ -0,0 +1,102 @@
+/*******************************************************************************
+ *
+ * File: SeqLock.h
+ *	Generic System Interface sequence lock
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#pragma once
+
+#include "gsi/Atomic.h"
+
+namespace gsi
+{
+
+/*******************************************************************************
+ *
+ * A sequence lock lets writers change data while readers copy it without
+ * either waiting on a Mutex.  The sequence is odd while a writer is changing
+ * the data, a reader copies the data between beginRead() and endRead() and
+ * copies it again if endRead() returns false.
+ *
+ *	uint32_t seq;
+ *	do
+ *	{
+ *		seq = lock.beginRead();
+ *		copy = data;
+ *	} while (! lock.endRead(seq));
+ *
+ * Writers wait for each other so more than one thread may write.  A reader
+ * must not keep pointers it read, the writer may free what they point to.
+ *
+ ******************************************************************************/
+class SeqLock
+{
+	public:
+		SeqLock(void)	{ sequence = 0; }
+
+		inline void beginWrite(void);
+		inline void endWrite(void);
+		inline uint32_t beginRead(void);
+		inline bool endRead(uint32_t seq);
+
+	private:
+		volatile uint32_t sequence;	// odd while a writer is changing the data
+};
+
+/*******************************************************************************
+ *
+ * Wait for other writers to finish then make the sequence odd.
+ *
+ ******************************************************************************/
+inline void SeqLock::beginWrite(void)
+{
+	uint32_t seq;
+	do
+	{
+		seq = Atomic::loadAcquire(&sequence);
+	} while ((seq & 1) || (! Atomic::compareExchange(&sequence, seq, seq + 1)));
+}
+
+/*******************************************************************************
+ *
+ * Make the sequence even again, publishing the new data.
+ *
+ ******************************************************************************/
+inline void SeqLock::endWrite(void)
+{
+	Atomic::storeRelease(&sequence, sequence + 1);
+}
+
+/*******************************************************************************
+ *
+ * @return	the sequence once no writer is changing the data
+ *
+ ******************************************************************************/
+inline uint32_t SeqLock::beginRead(void)
+{
+	uint32_t seq;
+	while ((seq = Atomic::loadAcquire(&sequence)) & 1)
+	{
+	}
+	return seq;
+}
+
+/*******************************************************************************
+ *
+ * @return	true if the data read since beginRead() returned seq is
+ *			consistent, false if it must be read again
+ *
+ ******************************************************************************/
+inline bool SeqLock::endRead(uint32_t seq)
+{
+	Atomic::acquireFence();
+	return (Atomic::loadAcquire(&sequence) == seq);
+}
+
+} // namespace gsi
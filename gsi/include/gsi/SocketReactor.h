@@ -0,0 +1,96 @@
+/*******************************************************************************
+ *
+ * File: SocketReactor.h
+ * 	Generic System Interface socket event reactor
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <map>
+
+#include "gsi/Thread.h"
+#include "gsi/Mutex.h"
+#include "gsi/UdpSocket.h"
+
+namespace gsi
+{
+
+/*******************************************************************************
+ *
+ * Implemented by classes that want to be told when a socket added to a
+ * SocketReactor has datagrams to receive.
+ *
+ * socketReadable() is called from the reactor's thread.  It must receive
+ * until the socket returns an error (EAGAIN once it is empty), the reactor
+ * is not told again about datagrams that were already queued.  It must not
+ * add or remove sockets.
+ *
+ ******************************************************************************/
+class SocketReactorHandler
+{
+	public:
+		virtual ~SocketReactorHandler() {}
+		virtual void socketReadable(UdpSocket *socket) = 0;
+};
+
+/*******************************************************************************
+ *
+ * This class waits for datagrams on any number of sockets from one thread,
+ * instead of using a thread that blocks in a receive for each socket.
+ *
+ * On Linux the reactor uses edge triggered epoll, so the thread only wakes
+ * when a datagram arrives, and an eventfd so requestStop() wakes it right
+ * away.  Other platforms wait with select() for up to POLL_PERIOD at a
+ * time.
+ *
+ * Sockets added to a reactor are made non-blocking.  A socket may be added
+ * and removed from any thread other than the reactor's, removeSocket()
+ * waits for a handler that is running to return.
+ *
+ ******************************************************************************/
+class SocketReactor : public Thread
+{
+	public:
+		static const uint32_t MAX_EVENTS = 16;
+		static const double POLL_PERIOD;
+
+		SocketReactor(std::string name,
+			ThreadPriority priority = PRIORITY_DEFAULT,
+			uint32_t options = OPTIONS_DEFAULT,
+			uint32_t stack_size = STACK_SIZE_DEFAULT);
+
+		virtual ~SocketReactor(void);
+
+		bool addSocket(UdpSocket *socket, SocketReactorHandler *handler);
+		void removeSocket(UdpSocket *socket);
+
+		virtual void requestStop(void);
+
+	protected:
+		virtual void run(void);
+
+	private:
+		typedef struct
+		{
+			UdpSocket *socket;
+			SocketReactorHandler *handler;
+		} SocketEntry;
+
+		void dispatch(int32_t descriptor);
+
+		std::map<int32_t, SocketEntry> socket_map;
+		Mutex socket_lock;
+
+#if defined(LINUX)
+		int epoll_desc;
+		int wake_desc;
+#endif
+};
+
+} // namespace gsi
@@ -0,0 +1,178 @@
+/*******************************************************************************
+ *
+ * File: TaskPool.h
+ * 	Generic System Interface work stealing task pool
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "gsi/Atomic.h"
+#include "gsi/Mutex.h"
+#include "gsi/Semaphore.h"
+#include "gsi/Thread.h"
+
+namespace gsi
+{
+
+class TaskPool;
+class TaskPoolWorker;
+
+/*******************************************************************************
+ *
+ * A piece of work that can be run by a TaskPool.  Subclasses implement
+ * execute(), which may spawn more tasks with a TaskGroup of its own.
+ *
+ ******************************************************************************/
+class Task
+{
+	public:
+		virtual ~Task(void) {}
+		virtual void execute(void) = 0;
+};
+
+/*******************************************************************************
+ *
+ * This class forks tasks to a TaskPool and joins them.
+ *
+ *	TaskGroup group(pool);
+ *	group.spawn(&drive_update);
+ *	group.spawn(&arm_update);
+ *	intake_update.execute();
+ *	group.wait();
+ *
+ * wait() does not just block, the waiting thread runs tasks from the pool
+ * until every task spawned by this group is done.  This keeps nested groups
+ * from running out of workers and lets the thread that forks the work do
+ * its share.
+ *
+ * A group belongs to the thread that created it, only that thread may call
+ * spawn() and wait().  The tasks must stay valid until wait() returns, the
+ * group does not delete them.  If the pool is NULL or has no workers,
+ * spawn() runs the task right away so code that uses groups also works
+ * without a pool.
+ *
+ ******************************************************************************/
+class TaskGroup
+{
+	public:
+		TaskGroup(TaskPool *pool);
+		~TaskGroup(void);
+
+		void spawn(Task *task);
+		void wait(void);
+
+	private:
+		friend class TaskPool;
+
+		void taskDone(void);
+
+		TaskPool *group_pool;
+		volatile uint32_t pending_count;
+		uint32_t spawn_count;
+		Semaphore done_sem;
+};
+
+/*******************************************************************************
+ *
+ * This class runs tasks on a fixed number of worker threads.
+ *
+ * Each worker has its own queue of tasks.  A worker runs the newest task of
+ * its own queue first, so work forked by a task stays on the CPU that has
+ * its data in cache.  A worker whose queue is empty steals the oldest task
+ * from another worker's queue, old tasks are usually the biggest pieces of
+ * work left.  Tasks spawned from outside of the pool are spread across the
+ * workers' queues.  Idle workers wait on a Semaphore instead of spinning and
+ * are woken when a task is added.
+ *
+ * The workers use the priority and options given to the constructor.  When
+ * the pool is used by a real-time thread the workers should get the same
+ * priority and scheduling options, otherwise the thread waiting on a
+ * TaskGroup can be held up by lower priority work.
+ *
+ ******************************************************************************/
+class TaskPool
+{
+	public:
+		TaskPool(std::string name, uint32_t worker_count,
+			Thread::ThreadPriority priority = Thread::PRIORITY_DEFAULT,
+			uint32_t options = Thread::OPTIONS_DEFAULT,
+			uint32_t stack_size = Thread::STACK_SIZE_DEFAULT);
+
+		~TaskPool(void);
+
+		void start(void);
+		void stop(void);
+
+		bool isRunning(void);
+		uint32_t getWorkerCount(void);
+		uint32_t getStealCount(void);
+
+	private:
+		friend class TaskGroup;
+		friend class TaskPoolWorker;
+
+		typedef struct
+		{
+			Task *task;
+			TaskGroup *group;
+		} TaskEntry;
+
+		void submit(Task *task, TaskGroup *group);
+		bool runTask(int32_t worker);
+		bool takeTask(int32_t worker, TaskEntry &entry);
+		bool hasTask(void);
+		void runEntry(TaskEntry &entry);
+
+		int32_t getCurrentWorker(void);
+		void waitForTask(void);
+		void wakeWorker(void);
+		bool claimIdle(void);
+
+		std::string pool_name;
+		std::vector<TaskPoolWorker *> worker_list;
+		Semaphore start_sem;
+		Semaphore wake_sem;
+
+		volatile uint32_t idle_count;
+		volatile uint32_t steal_count;
+		volatile uint32_t next_worker;
+		volatile uint32_t is_running;
+};
+
+/*******************************************************************************
+ *
+ * One of the threads of a TaskPool, only the TaskPool uses this class.
+ *
+ ******************************************************************************/
+class TaskPoolWorker : public Thread
+{
+	public:
+		TaskPoolWorker(std::string name, TaskPool *pool, ThreadPriority priority,
+			uint32_t options, uint32_t stack_size);
+
+	protected:
+		virtual void initialize(void);
+		virtual void run(void);
+
+	private:
+		friend class TaskPool;
+
+		TaskPool *worker_pool;
+		int32_t worker_index;
+		int64_t worker_thread_id;
+
+		std::deque<TaskPool::TaskEntry> task_queue;
+		Mutex queue_lock;
+};
+
+} // namespace gsi
@@ -20,6 +20,7 @@
 #include <time.h>
 #include <errno.h>
 #include <pthread.h>
+#include <sched.h>
 
 #elif defined(VXWORKS) || defined(_WRS_KERNEL)
 #include <taskLib.h>
@@ -51,6 +52,14 @@ namespace gsi
  * Subclasses should call isStopRequested() periodically, if stop is requested
  * the subclass should clean up and return from the run() method.
  *
+ * With PThreads the priority is a nice value unless OPTION_SCHED_FIFO or
+ * OPTION_SCHED_RR is set, then the thread gets a real-time priority of
+ * RT_PRIORITY_DEFAULT - RT_PRIORITY_STEP * priority, so PRIORITY_HIGHEST is
+ * the highest of them.  A stack size of 0 uses the system default.  If the
+ * process is not allowed to use real-time scheduling the thread is started
+ * with the normal scheduler and a message is printed.  The options are 0 on
+ * the other platforms so they can be used in portable code.
+ *
  ******************************************************************************/
 class Thread
 {
@@ -68,9 +77,14 @@ class Thread
 		};
 
 		static const uint32_t OPTIONS_DEFAULT		= 0;
-		static const uint32_t STACK_SIZE_DEFAULT	= 32768;
+		static const uint32_t OPTION_SCHED_FIFO		= 0x0001;
+		static const uint32_t OPTION_SCHED_RR		= 0x0002;
+		static const uint32_t STACK_SIZE_DEFAULT	= 0; // 0 means use the default
         static const int32_t THREAD_ID_ERROR		= -1;
 
+		static const int32_t RT_PRIORITY_DEFAULT	= 50;
+		static const int32_t RT_PRIORITY_STEP		= 5;
+
 #elif defined(VXWORKS)|| defined(_WRS_KERNEL)
 		enum ThreadPriority 
 		{ 
@@ -84,6 +98,8 @@ class Thread
 		};
 
 		static const uint32_t OPTIONS_DEFAULT		= VX_FP_TASK;
+		static const uint32_t OPTION_SCHED_FIFO		= 0; // tasks are always real-time
+		static const uint32_t OPTION_SCHED_RR		= 0;
 		static const uint32_t STACK_SIZE_DEFAULT	= 32768;
 
 #elif defined(_WINDOWS)
@@ -99,10 +115,14 @@ class Thread
 		};
 
 		static const uint32_t OPTIONS_DEFAULT		= 0; // on Windows, 0 means use the default
+		static const uint32_t OPTION_SCHED_FIFO		= 0; // not supported
+		static const uint32_t OPTION_SCHED_RR		= 0;
         static const uint32_t STACK_SIZE_DEFAULT	= 0; // on Windows, 0 means use the default
 
 #endif
 
+		static const int32_t CPU_ANY				= -1;
+
 		Thread(std::string name = "_unnamed_thread_", 
 			ThreadPriority priority = PRIORITY_DEFAULT,
 			uint32_t options = OPTIONS_DEFAULT, 
@@ -125,13 +145,21 @@ class Thread
 		void setOptions(uint32_t options);
 		void addOptions(uint32_t options);
 		uint32_t getOptions(void);
+
+		void setAffinity(int32_t cpu);
+		int32_t getAffinity(void);
 		
 		int64_t getId(void);
+		static int64_t getCurrentId(void);
 		std::string getName(void);
 
 		virtual std::string toString(void);
 		
 		static void sleep(double seconds);
+		static void sleepUntil(double monotonic_time);
+
+		static bool lockMemory(void);
+		static uint32_t getSchedulingOptions(std::string policy);
 
 	protected:
 		virtual void initialize(void) {}
@@ -153,11 +181,20 @@ class Thread
 
 		int32_t runHandleImpl(void);
 		void postRunHandle(void);
+		void recordException(const char *stage, const char *what);
+
+#if defined (PTHREADS)
+		bool isRealTime(void);
+		int32_t getRealTimePriority(int policy);
+		void applyPriority(void);
+		int32_t thread_tid;
+#endif
 		
 		std::string thread_name;
 		ThreadPriority thread_priority;
 		uint32_t thread_options;
 		uint32_t thread_size;
+		int32_t thread_cpu;
 		
 		bool is_running;
 		bool is_stop_requested;
@@ -19,6 +19,7 @@
 #elif defined(LINUX)
 #include <stdint.h>
 #include <sys/time.h>
+#include <time.h>
 #include <stdio.h>
 
 #elif defined(VXWORKS) 
@@ -39,11 +40,16 @@ namespace gsi
  *
  * This class provides an object oriented way to interact with Time and clocks.
  *
+ * getTime() is the wall clock time, it can jump when the clock is set.
+ * getMonotonicTime() counts from an arbitrary point but never jumps, use
+ * it for measuring intervals and scheduling.
+ *
  ******************************************************************************/
 class Time
 {
 	public:
 		static double getTime(void);
+		static double getMonotonicTime(void);
 };
 
 } // namespace gsi
@@ -0,0 +1,66 @@
+/*******************************************************************************
+ *
+ * File: TimingHistogram.h
+ *	Generic System Interface timing histogram
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <stdint.h>
+
+#include "gsi/Atomic.h"
+
+namespace gsi
+{
+
+/*******************************************************************************
+ *
+ * This class counts durations in buckets so percentiles can be found
+ * without keeping every sample.
+ *
+ * Durations are kept in microseconds.  Below LINEAR_LIMIT microseconds each
+ * bucket is one microsecond wide, above that each power of two range is
+ * split into SUB_BUCKET_COUNT buckets, so a percentile is within about 3%
+ * of the true value.  Durations longer than about 71 minutes are counted as
+ * the longest duration that fits.
+ *
+ * record() only uses atomic adds and compare and exchange, it may be called
+ * from any number of threads while other threads read percentiles.  A
+ * reset() while samples are being recorded may leave a few of them counted.
+ *
+ ******************************************************************************/
+class TimingHistogram
+{
+	public:
+		static const uint32_t LINEAR_LIMIT		= 64;
+		static const uint32_t SUB_BUCKET_BITS	= 5;
+		static const uint32_t SUB_BUCKET_COUNT	= 1 << SUB_BUCKET_BITS;
+		static const uint32_t BUCKET_COUNT		= LINEAR_LIMIT + (32 - 6) * SUB_BUCKET_COUNT;
+
+		TimingHistogram(void);
+
+		void record(double seconds);
+		void reset(void);
+
+		uint32_t getCount(void);
+		double getMin(void);
+		double getMax(void);
+		double getPercentile(double percent);
+
+	private:
+		static uint32_t bucketOf(uint32_t usec);
+		static uint32_t valueOf(uint32_t bucket);
+
+		volatile uint32_t buckets[BUCKET_COUNT];
+		volatile uint32_t sample_count;
+		volatile uint32_t min_usec;
+		volatile uint32_t max_usec;
+};
+
+} // namespace gsi
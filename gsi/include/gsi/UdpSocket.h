@@ -19,6 +19,7 @@
 #include <stdint.h>
 #include <sys/types.h>       // For data types
 #include <sys/socket.h>      // For socket(), connect(), send(), and recv()
+#include <sys/uio.h>         // For iovec used by recvmmsg()
 #include <netdb.h>           // For gethostbyname()
 #include <arpa/inet.h>       // For inet_addr()
 #include <unistd.h>          // For close()
@@ -68,6 +69,9 @@ static bool g_socket_initialized = false;
 class UdpSocket
 {
 	public:
+		// the most datagrams that will be moved by one batch call
+		static const uint32_t MAX_BATCH_COUNT = 32;
+
 		UdpSocket(uint32_t timeoutmsA = 0) throw (std::exception);
 
 		UdpSocket(uint16_t localPortA, uint32_t timeoutmsA = 0)
@@ -83,6 +87,13 @@ class UdpSocket
 		int32_t sendTo(const void *bufferA, uint32_t buffer_lengthA,
 		    const std::string &foreign_addressA, uint16_t foreign_portA);
 
+		int32_t sendTo(const void *bufferA, uint32_t buffer_lengthA,
+		    const sockaddr_in &foreign_addrA);
+
+		int32_t sendToBatch(const void **buffersA,
+		    const uint32_t *buffer_lengthsA, uint32_t countA,
+		    const sockaddr_in &foreign_addrA);
+
 		int32_t recvFrom(void *bufferA, uint32_t buffer_lengthA,
 		    std::string &source_addressA, uint16_t &source_portA);
 
@@ -90,6 +101,9 @@ class UdpSocket
 		    std::string &source_addressA, uint16_t &source_portA,
 		    uint32_t timeoutA);
 
+		int32_t recvFromBatch(void **buffersA, uint32_t buffer_lengthA,
+		    uint32_t *recv_lengthsA, uint32_t countA);
+
 		int32_t setMulticastTTL(unsigned char multicastTTLA);
 
 		int32_t joinGroup(const std::string &multicast_groupA);
@@ -101,13 +115,17 @@ class UdpSocket
 		int32_t setLocalAddressAndPort(const std::string &localAddress,
 		    uint16_t localPort = 0);
 
+		int32_t setNonBlocking(bool non_blockingA);
+
+		int32_t getDescriptor();
+
+		static int32_t fillAddr(const std::string &addressA, uint16_t portA,
+		    sockaddr_in &addrA);
+
 	private:
 		int32_t setBroadcast();
 		int32_t setTimeout(uint32_t msA);
 
-		int32_t fillAddr(const std::string &addressA, uint16_t portA,
-		    sockaddr_in &addrA);
-
 		char socket_source_name[256];
 		int32_t socket_desc; // Socket descriptor
 };
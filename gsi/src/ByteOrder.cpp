@@ -0,0 +1,165 @@
+/*******************************************************************************
+ *
+ * File: ByteOrder.cpp
+ *	Generic System Interface batch byte order conversion
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include "gsi/ByteOrder.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+namespace gsi
+{
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+// byte shuffles that reverse each 16 and 32 bit value in 16 bytes
+static const int8_t SWAP_16[16] = { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 };
+static const int8_t SWAP_32[16] = { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 };
+
+/*******************************************************************************
+ *
+ * Reverse the bytes of each value in 16 byte blocks using the shuffle,
+ * the bytes past the last whole block are left for the caller.
+ *
+ * @return	the number of bytes that were done
+ *
+ ******************************************************************************/
+static uint32_t shuffle(const uint8_t *src, uint8_t *dest, uint32_t bytes,
+	const int8_t *order)
+{
+	uint32_t done = 0;
+
+#if defined(__AVX2__)
+	__m128i half = _mm_loadu_si128((const __m128i *)order);
+	__m256i mask = _mm256_broadcastsi128_si256(half);
+	for (; done + 32 <= bytes; done += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *)&src[done]);
+		_mm256_storeu_si256((__m256i *)&dest[done], _mm256_shuffle_epi8(v, mask));
+	}
+#endif
+
+	__m128i mask16 = _mm_loadu_si128((const __m128i *)order);
+	for (; done + 16 <= bytes; done += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)&src[done]);
+		_mm_storeu_si128((__m128i *)&dest[done], _mm_shuffle_epi8(v, mask16));
+	}
+
+	return done;
+}
+#endif
+
+/*******************************************************************************
+ *
+ * Reverse the bytes of each 16 bit value.
+ *
+ ******************************************************************************/
+void ByteOrder::swap16(const void *src, void *dest, uint32_t count)
+{
+	uint32_t done = 0;
+#if defined(__AVX2__) || defined(__SSSE3__)
+	done = shuffle((const uint8_t *)src, (uint8_t *)dest, count * 2, SWAP_16) / 2;
+#endif
+
+	const uint8_t *s = (const uint8_t *)src;
+	uint8_t *d = (uint8_t *)dest;
+	for (uint32_t i = done; i < count; i++)
+	{
+		uint16_t v;
+		memcpy(&v, &s[i * 2], sizeof(v));
+		v = (uint16_t)((v >> 8) | (v << 8));
+		memcpy(&d[i * 2], &v, sizeof(v));
+	}
+}
+
+/*******************************************************************************
+ *
+ * Reverse the bytes of each 32 bit value.
+ *
+ ******************************************************************************/
+void ByteOrder::swap32(const void *src, void *dest, uint32_t count)
+{
+	uint32_t done = 0;
+#if defined(__AVX2__) || defined(__SSSE3__)
+	done = shuffle((const uint8_t *)src, (uint8_t *)dest, count * 4, SWAP_32) / 4;
+#endif
+
+	const uint8_t *s = (const uint8_t *)src;
+	uint8_t *d = (uint8_t *)dest;
+	for (uint32_t i = done; i < count; i++)
+	{
+		uint32_t v;
+		memcpy(&v, &s[i * 4], sizeof(v));
+		v = (v >> 24) | ((v >> 8) & 0x0000FF00) | ((v << 8) & 0x00FF0000) | (v << 24);
+		memcpy(&d[i * 4], &v, sizeof(v));
+	}
+}
+
+/*******************************************************************************
+ *
+ * Convert 16 bit values from host to network byte order.
+ *
+ ******************************************************************************/
+void ByteOrder::toNet16(const void *src, void *dest, uint32_t count)
+{
+#if defined(GSI_BIG_ENDIAN)
+	if (src != dest)
+	{
+		memcpy(dest, src, count * 2);
+	}
+#else
+	swap16(src, dest, count);
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Convert 32 bit values from host to network byte order.
+ *
+ ******************************************************************************/
+void ByteOrder::toNet32(const void *src, void *dest, uint32_t count)
+{
+#if defined(GSI_BIG_ENDIAN)
+	if (src != dest)
+	{
+		memcpy(dest, src, count * 4);
+	}
+#else
+	swap32(src, dest, count);
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Convert 16 bit values from network to host byte order.
+ *
+ ******************************************************************************/
+void ByteOrder::fromNet16(const void *src, void *dest, uint32_t count)
+{
+	toNet16(src, dest, count);
+}
+
+/*******************************************************************************
+ *
+ * Convert 32 bit values from network to host byte order.
+ *
+ ******************************************************************************/
+void ByteOrder::fromNet32(const void *src, void *dest, uint32_t count)
+{
+	toNet32(src, dest, count);
+}
+
+} // namespace gsi
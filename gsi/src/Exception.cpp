@@ -11,6 +11,7 @@
  *
  ******************************************************************************/
 #include "gsi/Exception.h"
+#include "gsi/FlightRecorder.h"
 
 #if defined(__APPLE__) || defined (LINUX)
 #include <execinfo.h>
@@ -40,6 +41,11 @@ Exception::Exception(const std::string msg, int32_t code,
 	exception_line = line;
 
 	buildStackTrace();
+
+	if (FlightRecorder::isOpen())
+	{
+		FlightRecorder::trigger(FlightRecorder::RECORD_EXCEPTION, toString().c_str(), code);
+	}
 }
 
 /*******************************************************************************
@@ -54,6 +60,11 @@ Exception::Exception(const std::string msg, int32_t code, Exception &cause,
 	exception_line = line;
 
 	exception_stack = cause.getStack();
+
+	if (FlightRecorder::isOpen())
+	{
+		FlightRecorder::trigger(FlightRecorder::RECORD_EXCEPTION, toString().c_str(), code);
+	}
 }
 
 /*******************************************************************************
@@ -0,0 +1,428 @@
+/*******************************************************************************
+ *
+ * File: FlightRecorder.cpp
+ *	Generic System Interface crash-safe ring of recent records
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include "gsi/FlightRecorder.h"
+#include "gsi/Atomic.h"
+#include "gsi/Time.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#if defined(LINUX) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#define GSI_FLIGHT_RECORDER_MMAP
+#endif
+
+#include <string>
+
+namespace gsi
+{
+
+FlightRecorder::Header *FlightRecorder::recorder_header = NULL;
+FlightRecorder::Record *FlightRecorder::recorder_records = NULL;
+uint32_t FlightRecorder::recorder_mask = 0;
+uint32_t FlightRecorder::recorder_bytes = 0;
+int FlightRecorder::recorder_file = -1;
+char *FlightRecorder::recorder_file_name = NULL;
+
+// the signals that are caught, and what was done with them before
+#if defined(SIGBUS)
+static const int FATAL_SIGNALS[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+static const char *FATAL_SIGNAL_NAMES[] = { "SIGSEGV", "SIGBUS", "SIGFPE", "SIGILL", "SIGABRT" };
+#else
+static const int FATAL_SIGNALS[] = { SIGSEGV, SIGFPE, SIGILL, SIGABRT };
+static const char *FATAL_SIGNAL_NAMES[] = { "SIGSEGV", "SIGFPE", "SIGILL", "SIGABRT" };
+#endif
+static const uint32_t FATAL_SIGNAL_COUNT = sizeof(FATAL_SIGNALS) / sizeof(FATAL_SIGNALS[0]);
+
+#if defined(GSI_FLIGHT_RECORDER_MMAP)
+static struct sigaction old_actions[FATAL_SIGNAL_COUNT];
+#else
+typedef void (*SignalHandler)(int);
+static SignalHandler old_handlers[FATAL_SIGNAL_COUNT];
+#endif
+
+/*******************************************************************************
+ *
+ * Start recording into the file, mapping it into memory.
+ *
+ * @param	file_name		the file to record into, an earlier dump with this
+ *							name is renamed to file_name.1
+ * @param	record_count	the number of slots in the ring, rounded up to a
+ *							power of 2
+ * @param	catch_signals	true to dump on a fatal signal
+ *
+ * @return	true if the recorder is open
+ *
+ ******************************************************************************/
+bool FlightRecorder::open(const char *file_name, uint32_t record_count,
+	bool catch_signals)
+{
+	if (recorder_header != NULL)
+	{
+		return false;
+	}
+
+	uint32_t count = 64;
+	while ((count < record_count) && (count < 0x01000000))
+	{
+		count <<= 1;
+	}
+	uint32_t bytes = sizeof(Header) + count * sizeof(Record);
+
+	std::string old_name = std::string(file_name) + ".1";
+	remove(old_name.c_str());
+	rename(file_name, old_name.c_str());
+
+#if defined(GSI_FLIGHT_RECORDER_MMAP)
+	int fd = ::open(file_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+	{
+		printf("FlightRecorder::open - could not open %s\n", file_name);
+		return false;
+	}
+
+	void *memory = MAP_FAILED;
+	if (ftruncate(fd, bytes) == 0)
+	{
+		memory = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	if (memory == MAP_FAILED)
+	{
+		printf("FlightRecorder::open - could not map %u bytes of %s\n", bytes, file_name);
+		::close(fd);
+		return false;
+	}
+	recorder_file = fd;
+#else
+	void *memory = calloc(1, bytes);
+	if (memory == NULL)
+	{
+		printf("FlightRecorder::open - could not allocate %u bytes\n", bytes);
+		return false;
+	}
+#endif
+
+	Header *header = (Header *)memory;
+	memset(header, 0, sizeof(Header));
+	memcpy(header->magic, "GSIFDR\0", sizeof(header->magic));
+	header->byte_order = BYTE_ORDER_MARK;
+	header->version = VERSION;
+	header->header_size = sizeof(Header);
+	header->record_size = sizeof(Record);
+	header->record_count = count;
+	header->start_time = Time::getTime();
+	header->start_monotonic = Time::getMonotonicTime();
+
+	recorder_records = (Record *)((uint8_t *)memory + sizeof(Header));
+	recorder_mask = count - 1;
+	recorder_bytes = bytes;
+	recorder_file_name = strdup(file_name);
+	recorder_header = header;
+
+	if (catch_signals)
+	{
+		catchSignals(true);
+	}
+
+	return true;
+}
+
+/*******************************************************************************
+ *
+ * Write the ring to the file and stop recording.
+ *
+ ******************************************************************************/
+void FlightRecorder::close(void)
+{
+	if (recorder_header == NULL)
+	{
+		return;
+	}
+
+	catchSignals(false);
+	flush(true);
+
+	Header *header = recorder_header;
+	recorder_header = NULL;
+
+#if defined(GSI_FLIGHT_RECORDER_MMAP)
+	munmap(header, recorder_bytes);
+	::close(recorder_file);
+	recorder_file = -1;
+#else
+	free(header);
+#endif
+
+	free(recorder_file_name);
+	recorder_file_name = NULL;
+	recorder_records = NULL;
+}
+
+/*******************************************************************************
+ *
+ * Record data of the kind, in as many slots as it takes.
+ *
+ * Each slot is marked as being written, filled, then marked done.  Only a
+ * dump is ever read, after the threads that wrote it stopped, so the slot
+ * only has to be right as of any point the writer could stop at.
+ *
+ * @param	time	the monotonic time of the record, 0.0 for now
+ *
+ ******************************************************************************/
+void FlightRecorder::record(RecordKind kind, const void *data, uint32_t length,
+	double time)
+{
+	if (recorder_header == NULL)
+	{
+		return;
+	}
+
+	uint32_t max_parts = (recorder_mask + 1) / 2;
+	if (max_parts > 255)
+	{
+		max_parts = 255;
+	}
+	if (length > max_parts * DATA_LENGTH)
+	{
+		length = max_parts * DATA_LENGTH;
+	}
+
+	uint32_t parts = (length + DATA_LENGTH - 1) / DATA_LENGTH;
+	if (parts == 0)
+	{
+		parts = 1;
+	}
+
+	if (time == 0.0)
+	{
+		time = Time::getMonotonicTime();
+	}
+
+	uint32_t first = Atomic::fetchAdd(&recorder_header->next, parts);
+	const uint8_t *src = (const uint8_t *)data;
+	for (uint32_t part = 0; part < parts; part++)
+	{
+		Record *r = &recorder_records[(first + part) & recorder_mask];
+		r->sequence = 0;
+
+		uint32_t n = (length < DATA_LENGTH) ? length : DATA_LENGTH;
+		r->kind = (uint8_t)kind;
+		r->part = (uint8_t)part;
+		r->parts = (uint8_t)parts;
+		r->length = (uint8_t)n;
+		r->time = time;
+		memcpy(r->data, src, n);
+		src += n;
+		length -= n;
+
+		Atomic::storeRelease(&r->sequence, first + part + 1);
+	}
+}
+
+/*******************************************************************************
+ *
+ * Record a string without its null.
+ *
+ ******************************************************************************/
+void FlightRecorder::recordText(RecordKind kind, const char *text, double time)
+{
+	if (recorder_header == NULL)
+	{
+		return;
+	}
+
+	record(kind, text, strlen(text), time);
+}
+
+/*******************************************************************************
+ *
+ * Record a new value of a parameter, values longer than fit in one slot are
+ * cut off.
+ *
+ ******************************************************************************/
+void FlightRecorder::recordValue(uint16_t id, uint8_t type, const void *value,
+	uint32_t length)
+{
+	if (recorder_header == NULL)
+	{
+		return;
+	}
+
+	ValueSample sample;
+	if (length > sizeof(sample.value))
+	{
+		length = sizeof(sample.value);
+	}
+
+	sample.id = id;
+	sample.type = type;
+	sample.length = (uint8_t)length;
+	memcpy(sample.value, value, length);
+
+	record(RECORD_VALUE, &sample, sizeof(sample) - sizeof(sample.value) + length);
+}
+
+/*******************************************************************************
+ *
+ * Record the timing of one cycle of a periodic thread.
+ *
+ ******************************************************************************/
+void FlightRecorder::recordTiming(const char *name, uint32_t cycle,
+	double execution, double latency, uint32_t overruns)
+{
+	if (recorder_header == NULL)
+	{
+		return;
+	}
+
+	TimingSample sample;
+	sample.execution = execution;
+	sample.latency = latency;
+	sample.cycle = cycle;
+	sample.overruns = overruns;
+	strncpy(sample.name, name, NAME_LENGTH - 1);
+	sample.name[NAME_LENGTH - 1] = 0;
+
+	record(RECORD_TIMING, &sample, sizeof(sample));
+}
+
+/*******************************************************************************
+ *
+ * Record why the dump is wanted, remember it in the header, and write the
+ * ring to the file.  This is safe to call from a signal handler.
+ *
+ * @param	kind	the kind of record the reason is
+ * @param	reason	the text of the record
+ * @param	code	the error code or signal number
+ *
+ ******************************************************************************/
+void FlightRecorder::trigger(RecordKind kind, const char *reason, int32_t code)
+{
+	Header *header = recorder_header;
+	if (header == NULL)
+	{
+		return;
+	}
+
+	recordText(kind, reason);
+
+	Atomic::fetchAdd(&header->trigger_count, 1);
+	header->trigger_code = code;
+	header->trigger_time = Time::getMonotonicTime();
+
+	uint32_t i = 0;
+	for (; (i < REASON_LENGTH - 1) && (reason[i] != 0); i++)
+	{
+		header->trigger_reason[i] = reason[i];
+	}
+	header->trigger_reason[i] = 0;
+
+	flush(kind == RECORD_SIGNAL);
+}
+
+/*******************************************************************************
+ *
+ * Write the ring to the file.
+ *
+ * @param	wait	true to return only once the file is on disk, false to
+ *					only start writing it (the data is already safe if just
+ *					the program dies)
+ *
+ ******************************************************************************/
+void FlightRecorder::flush(bool wait)
+{
+	if (recorder_header == NULL)
+	{
+		return;
+	}
+
+#if defined(GSI_FLIGHT_RECORDER_MMAP)
+	msync(recorder_header, recorder_bytes, wait ? MS_SYNC : MS_ASYNC);
+#else
+	FILE *file = fopen(recorder_file_name, "wb");
+	if (file != NULL)
+	{
+		fwrite(recorder_header, 1, recorder_bytes, file);
+		fclose(file);
+	}
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Start or stop catching the fatal signals, putting back what was done with
+ * them before when stopping.
+ *
+ ******************************************************************************/
+void FlightRecorder::catchSignals(bool on)
+{
+	for (uint32_t i = 0; i < FATAL_SIGNAL_COUNT; i++)
+	{
+#if defined(GSI_FLIGHT_RECORDER_MMAP)
+		if (on)
+		{
+			struct sigaction action;
+			memset(&action, 0, sizeof(action));
+			action.sa_handler = handleSignal;
+			sigemptyset(&action.sa_mask);
+			action.sa_flags = SA_RESETHAND;
+			sigaction(FATAL_SIGNALS[i], &action, &old_actions[i]);
+		}
+		else
+		{
+			sigaction(FATAL_SIGNALS[i], &old_actions[i], NULL);
+		}
+#else
+		if (on)
+		{
+			old_handlers[i] = signal(FATAL_SIGNALS[i], handleSignal);
+		}
+		else
+		{
+			signal(FATAL_SIGNALS[i], old_handlers[i]);
+		}
+#endif
+	}
+}
+
+/*******************************************************************************
+ *
+ * Dump on a fatal signal, then let the signal do what it would have done.
+ *
+ ******************************************************************************/
+void FlightRecorder::handleSignal(int sig)
+{
+	const char *name = "fatal signal";
+	for (uint32_t i = 0; i < FATAL_SIGNAL_COUNT; i++)
+	{
+		if (FATAL_SIGNALS[i] == sig)
+		{
+			name = FATAL_SIGNAL_NAMES[i];
+		}
+	}
+
+	trigger(RECORD_SIGNAL, name, sig);
+
+	// the handler was reset when this one was called, so this gets the
+	// default action as soon as this returns
+#if ! defined(GSI_FLIGHT_RECORDER_MMAP)
+	signal(sig, SIG_DFL);
+#endif
+	raise(sig);
+}
+
+} // namespace gsi
@@ -0,0 +1,236 @@
+/*******************************************************************************
+ *
+ * File: PeriodicExecutive.cpp
+ * 	Generic System Interface class for running many periodic tasks
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include "gsi/PeriodicExecutive.h"
+#include "gsi/Time.h"
+
+#include <exception>
+
+namespace gsi
+{
+
+// the longest the executive sleeps, so tasks added while it is idle start
+// without waiting for the other tasks
+const double PeriodicExecutive::MAX_IDLE_TIME = 0.1;
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+PeriodicExecutive::PeriodicExecutive(std::string name, ThreadPriority priority,
+	uint32_t options, uint32_t stack_size) : Thread(name, priority, options, stack_size)
+{
+	deadline_miss_count = 0;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+PeriodicExecutive::~PeriodicExecutive()
+{
+}
+
+/*******************************************************************************
+ *
+ * Add a task that has not been started, its first cycle starts as soon as
+ * the executive gets to it.
+ *
+ ******************************************************************************/
+void PeriodicExecutive::addTask(PeriodicThread *task)
+{
+	MutexScopeLock lock(task_lock);
+
+	for (uint32_t i = 0; i < task_list.size(); i++)
+	{
+		if (task_list[i].task == task)
+		{
+			return;
+		}
+	}
+
+	TaskEntry entry = { task, false };
+	task_list.push_back(entry);
+}
+
+/*******************************************************************************
+ *
+ * Stop running a task, this waits for the task's current cycle to finish.
+ *
+ ******************************************************************************/
+void PeriodicExecutive::removeTask(PeriodicThread *task)
+{
+	MutexScopeLock lock(task_lock);
+
+	for (uint32_t i = 0; i < task_list.size(); i++)
+	{
+		if (task_list[i].task == task)
+		{
+			finalizeTask(task_list[i]);
+			task_list.erase(task_list.begin() + i);
+			return;
+		}
+	}
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+uint32_t PeriodicExecutive::getTaskCount(void)
+{
+	MutexScopeLock lock(task_lock);
+	return task_list.size();
+}
+
+/*******************************************************************************
+ *
+ * @return	the number of task cycles that ended after the task's next
+ *			cycle should have started
+ *
+ ******************************************************************************/
+uint32_t PeriodicExecutive::getDeadlineMissCount(void)
+{
+	return deadline_miss_count;
+}
+
+/*******************************************************************************
+ *
+ * Run the task that is due with the shortest period, or sleep until the
+ * next task is due.
+ *
+ ******************************************************************************/
+void PeriodicExecutive::run(void)
+{
+	while ( ! isStopRequested() )
+	{
+		double next_time;
+
+		task_lock.lock();
+		PeriodicThread *task = getReadyTask(Time::getMonotonicTime(), &next_time);
+		if (task != NULL)
+		{
+			uint32_t overruns = task->overrun_count;
+
+			task->beginCycle(Time::getMonotonicTime());
+			try
+			{
+				task->doPeriodic();
+			}
+			catch (std::exception& ex)
+			{
+				printf("PeriodicExecutive::run - unhandled exception in %s -- %s\n",
+					task->getName().c_str(), ex.what());
+			}
+			catch (...)
+			{
+				printf("PeriodicExecutive::run - unhandled exception in %s\n",
+					task->getName().c_str());
+			}
+			task->endCycle(Time::getMonotonicTime());
+
+			deadline_miss_count += task->overrun_count - overruns;
+		}
+		task_lock.unlock();
+
+		if (task == NULL)
+		{
+			sleepUntil(next_time);
+		}
+	}
+
+	MutexScopeLock lock(task_lock);
+	for (uint32_t i = 0; i < task_list.size(); i++)
+	{
+		finalizeTask(task_list[i]);
+	}
+	task_list.clear();
+}
+
+/*******************************************************************************
+ *
+ * Remove tasks that were asked to stop, initialize new tasks, and find the
+ * task to run.  The caller must hold task_lock.
+ *
+ * @param	now			the current monotonic time
+ * @param	next_time	set to when the next task is due if none are due now
+ *
+ * @return	the due task with the shortest period, or NULL if none are due
+ *
+ ******************************************************************************/
+PeriodicThread *PeriodicExecutive::getReadyTask(double now, double *next_time)
+{
+	PeriodicThread *ready = NULL;
+	*next_time = now + MAX_IDLE_TIME;
+
+	for (uint32_t i = 0; i < task_list.size(); )
+	{
+		PeriodicThread *task = task_list[i].task;
+
+		if (task->isStopRequested())
+		{
+			finalizeTask(task_list[i]);
+			task_list.erase(task_list.begin() + i);
+			continue;
+		}
+
+		if (! task_list[i].initialized)
+		{
+			task_list[i].initialized = true;
+			task->startCycles(now);
+			try
+			{
+				task->initialize();
+			}
+			catch (...)
+			{
+				printf("PeriodicExecutive::run - unhandled exception initializing %s\n",
+					task->getName().c_str());
+			}
+		}
+
+		if (task->thread_next_time <= now)
+		{
+			if ((ready == NULL) || (task->thread_period < ready->thread_period))
+			{
+				ready = task;
+			}
+		}
+		else if (task->thread_next_time < *next_time)
+		{
+			*next_time = task->thread_next_time;
+		}
+
+		i++;
+	}
+
+	return ready;
+}
+
+/*******************************************************************************
+ *
+ * Let a task that was run release its resources.
+ *
+ ******************************************************************************/
+void PeriodicExecutive::finalizeTask(TaskEntry &entry)
+{
+	if (entry.initialized)
+	{
+		try
+		{
+			entry.task->finalize();
+		}
+		catch (...)
+		{
+		}
+		entry.initialized = false;
+	}
+}
+
+} // namespace gsi
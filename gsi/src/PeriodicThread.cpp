@@ -13,7 +13,7 @@
 #include "gsi/PeriodicThread.h"
 #include "gsi/Time.h"
 
-static const double MIN_SLEEP_TIME = 0.001;
+#include <string.h>
 
 namespace gsi
 {
@@ -30,6 +30,14 @@ PeriodicThread::PeriodicThread(std::string name, double period, ThreadPriority p
 {
 	thread_period = period;
 	thread_next_time = 0.0;
+	thread_last_start = 0.0;
+	thread_waited = false;
+	thread_overrun_policy = OVERRUN_CATCH_UP;
+
+	strncpy(recorder_name, name.c_str(), sizeof(recorder_name) - 1);
+	recorder_name[sizeof(recorder_name) - 1] = 0;
+
+	resetStatistics();
 }
 
 /*******************************************************************************
@@ -64,6 +72,137 @@ void PeriodicThread::setPeriod(double period)
 	thread_period = period;
 }
 
+/*******************************************************************************
+ *
+ ******************************************************************************/
+PeriodicThread::OverrunPolicy PeriodicThread::getOverrunPolicy(void)
+{
+	return thread_overrun_policy;
+}
+
+/*******************************************************************************
+ *
+ * Set what happens when doPeriodic() runs past the start of the next cycle.
+ *
+ ******************************************************************************/
+void PeriodicThread::setOverrunPolicy(OverrunPolicy policy)
+{
+	thread_overrun_policy = policy;
+}
+
+/*******************************************************************************
+ *
+ * @return	the number of times doPeriodic() has been called
+ *
+ ******************************************************************************/
+uint32_t PeriodicThread::getCycleCount(void)
+{
+	return cycle_count;
+}
+
+/*******************************************************************************
+ *
+ * @return	the number of times doPeriodic() ran past the start of the next
+ *			cycle
+ *
+ ******************************************************************************/
+uint32_t PeriodicThread::getOverrunCount(void)
+{
+	return overrun_count;
+}
+
+/*******************************************************************************
+ *
+ * @return	the number of cycles dropped by OVERRUN_SKIP and OVERRUN_RESET
+ *
+ ******************************************************************************/
+uint32_t PeriodicThread::getSkippedCount(void)
+{
+	return skipped_count;
+}
+
+/*******************************************************************************
+ *
+ * @return	how late, in seconds, the thread woke for the most recent cycle
+ *
+ ******************************************************************************/
+double PeriodicThread::getLastJitter(void)
+{
+	return last_jitter;
+}
+
+/*******************************************************************************
+ *
+ * @return	the latest, in seconds, the thread has woken for a cycle
+ *
+ ******************************************************************************/
+double PeriodicThread::getMaxJitter(void)
+{
+	return max_jitter;
+}
+
+/*******************************************************************************
+ *
+ * @return	the average of how late, in seconds, the thread woke for cycles
+ *
+ ******************************************************************************/
+double PeriodicThread::getAverageJitter(void)
+{
+	return (jitter_count == 0) ? 0.0 : total_jitter / jitter_count;
+}
+
+/*******************************************************************************
+ *
+ * Clear the counts and jitter, they are not protected so values read while
+ * this is called from another thread may be a mix of old and new.
+ *
+ ******************************************************************************/
+void PeriodicThread::resetStatistics(void)
+{
+	cycle_count = 0;
+	overrun_count = 0;
+	skipped_count = 0;
+	jitter_count = 0;
+	last_jitter = 0.0;
+	max_jitter = 0.0;
+	total_jitter = 0.0;
+
+	execution_histogram.reset();
+	latency_histogram.reset();
+	period_error_histogram.reset();
+}
+
+/*******************************************************************************
+ *
+ * @return	the histogram of how long each call to doPeriodic() took
+ *
+ ******************************************************************************/
+TimingHistogram &PeriodicThread::getExecutionHistogram(void)
+{
+	return execution_histogram;
+}
+
+/*******************************************************************************
+ *
+ * @return	the histogram of how late the thread woke for each cycle
+ *
+ ******************************************************************************/
+TimingHistogram &PeriodicThread::getLatencyHistogram(void)
+{
+	return latency_histogram;
+}
+
+/*******************************************************************************
+ *
+ * @return	the histogram of how far the time from one cycle's start to the
+ *			next was from the period
+ *
+ ******************************************************************************/
+TimingHistogram &PeriodicThread::getPeriodErrorHistogram(void)
+{
+	return period_error_histogram;
+}
+
 /*******************************************************************************
  *
  * This method implements the base classes run method to periodically call
@@ -72,30 +211,108 @@ void PeriodicThread::setPeriod(double period)
  ******************************************************************************/
 void PeriodicThread::run(void)
 {
-	//printf("PeriodicThread:%s,  %s:%d\n", getName().c_str(), __FUNCTION__, __LINE__);
-	thread_next_time = Time::getTime();
+	startCycles(Time::getMonotonicTime());
 	
 	while( ! isStopRequested() )
 	{
-		//printf("PeriodicThread:%s,  %s:%d\n", getName().c_str(), __FUNCTION__, __LINE__);
+		beginCycle(Time::getMonotonicTime());
 		doPeriodic();
-		//printf("PeriodicThread:%s,  %s:%d\n", getName().c_str(), __FUNCTION__, __LINE__);
-		
-		thread_next_time += thread_period;
-		double wait_time = thread_next_time - Time::getTime();
+		if (endCycle(Time::getMonotonicTime()))
+		{
+			sleepUntil(thread_next_time);
+		}
+	}
+}
 
-		if (wait_time >= MIN_SLEEP_TIME)
+/*******************************************************************************
+ *
+ * Make the first cycle start at the time.
+ *
+ ******************************************************************************/
+void PeriodicThread::startCycles(double now)
+{
+	thread_next_time = now;
+	thread_last_start = now;
+	thread_waited = false;
+}
+
+/*******************************************************************************
+ *
+ * Record the start of a cycle, called right before doPeriodic().
+ *
+ ******************************************************************************/
+void PeriodicThread::beginCycle(double now)
+{
+	if (cycle_count > 0)
+	{
+		double error = (now - thread_last_start) - thread_period;
+		period_error_histogram.record((error < 0.0) ? -error : error);
+	}
+	thread_last_start = now;
+
+	// only cycles that waited to start have a meaningful latency, the
+	// others started as soon as the previous cycle ended
+	if (thread_waited)
+	{
+		last_jitter = now - thread_next_time;
+		latency_histogram.record(last_jitter);
+		total_jitter += last_jitter;
+		jitter_count++;
+		if (last_jitter > max_jitter)
 		{
-			//printf("PeriodicThread:%s,  %s:%d\n", getName().c_str(), __FUNCTION__, __LINE__);
-			sleep(wait_time);
+			max_jitter = last_jitter;
 		}
-		else
+	}
+}
+
+/*******************************************************************************
+ *
+ * Record the end of a cycle and move to the start time of the next one,
+ * following the overrun policy if the next cycle should already have
+ * started.
+ *
+ * @return	true if the caller should wait until thread_next_time before
+ *			starting the next cycle, false if it should start right away
+ *
+ ******************************************************************************/
+bool PeriodicThread::endCycle(double now)
+{
+	cycle_count++;
+	execution_histogram.record(now - thread_last_start);
+	FlightRecorder::recordTiming(recorder_name, cycle_count, now - thread_last_start,
+		thread_waited ? last_jitter : 0.0, overrun_count);
+	
+	thread_next_time += thread_period;
+
+	thread_waited = (now < thread_next_time);
+	if (! thread_waited)
+	{
+		overrun_count++;
+
+		switch (thread_overrun_policy)
 		{
-			printf("Value: %.5f   %.5f\n", wait_time, Time::getTime());
-			//printf("PeriodicThread:%s,  %s:%d\n", getName().c_str(), __FUNCTION__, __LINE__);
-			sleep(MIN_SLEEP_TIME);
+			case OVERRUN_SKIP:
+			{
+				// move to the first cycle on the schedule that has not started
+				uint32_t missed = (uint32_t)((now - thread_next_time) / thread_period) + 1;
+				thread_next_time += missed * thread_period;
+				skipped_count += missed;
+				thread_waited = true;
+			} break;
+
+			case OVERRUN_RESET:
+			{
+				skipped_count += (uint32_t)((now - thread_next_time) / thread_period);
+				thread_next_time = now;
+			} break;
+
+			case OVERRUN_CATCH_UP:
+			default:
+				break;
 		}
 	}
+
+	return thread_waited;
 }
 
 } // namespace gsi
@@ -0,0 +1,629 @@
+/*******************************************************************************
+ *
+ * File: RobotLogFormat.cpp
+ *	Generic System Interface printf argument packing and binary log records
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include "gsi/RobotLogFormat.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WINDOWS) && defined(_MSC_VER) && (_MSC_VER < 1900)
+#define snprintf _snprintf
+#endif
+
+namespace gsi
+{
+
+/*******************************************************************************
+ *
+ * Copy one argument of a packed line out of the host's bytes.
+ *
+ * @return	false if the line ends before the argument does
+ *
+ ******************************************************************************/
+template <class T>
+static bool readArg(const char **args, const char *args_end, T *v)
+{
+	if (*args + sizeof(*v) > args_end)
+	{
+		return false;
+	}
+
+	memcpy(v, *args, sizeof(*v));
+	*args += sizeof(*v);
+	return true;
+}
+
+/*******************************************************************************
+ *
+ * Parse the conversion that starts at the %, setting the kind of its
+ * argument and how many * it has.
+ *
+ * @return	the char after the conversion
+ *
+ ******************************************************************************/
+const char *RobotLogFormat::parseConversion(const char *p, ArgKind *kind, int *stars)
+{
+	*stars = 0;
+	p++;
+
+	while ((*p == '-') || (*p == '+') || (*p == ' ') || (*p == '#') || (*p == '0'))
+	{
+		p++;
+	}
+
+	if (*p == '*')
+	{
+		(*stars)++;
+		p++;
+	}
+	while ((*p >= '0') && (*p <= '9'))
+	{
+		p++;
+	}
+
+	if (*p == '.')
+	{
+		p++;
+		if (*p == '*')
+		{
+			(*stars)++;
+			p++;
+		}
+		while ((*p >= '0') && (*p <= '9'))
+		{
+			p++;
+		}
+	}
+
+	char size = 0;
+	if ((*p == 'h') || (*p == 'l'))
+	{
+		size = *p++;
+		if (*p == size)
+		{
+			size = (size == 'l') ? 'q' : 'h';
+			p++;
+		}
+	}
+	else if ((*p == 'L') || (*p == 'q') || (*p == 'j') || (*p == 'z') || (*p == 't'))
+	{
+		size = *p++;
+	}
+
+	switch (*p)
+	{
+		case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+			switch (size)
+			{
+				case 'l':			*kind = ARG_LONG;		break;
+				case 'q': case 'j':	*kind = ARG_LONG_LONG;	break;
+				case 'z': case 't':	*kind = ARG_SIZE;		break;
+				default:			*kind = ARG_INT;		break;
+			}
+			break;
+
+		case 'c':
+			*kind = (size == 0) ? ARG_INT : ARG_UNSUPPORTED;
+			break;
+
+		case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+			*kind = (size == 'L') ? ARG_LONG_DOUBLE : ARG_DOUBLE;
+			break;
+
+		case 's':
+			*kind = (size == 0) ? ARG_STRING : ARG_UNSUPPORTED;
+			break;
+
+		case 'p':
+			*kind = ARG_POINTER;
+			break;
+
+		case '%':
+			*kind = ARG_NONE;
+			break;
+
+		default:
+			*kind = ARG_UNSUPPORTED;
+			return p;
+	}
+
+	return p + 1;
+}
+
+/*******************************************************************************
+ *
+ * The bytes the argument of a conversion is packed in on this host,
+ * strings count only their null.
+ *
+ ******************************************************************************/
+uint32_t RobotLogFormat::getArgSize(ArgKind kind)
+{
+	switch (kind)
+	{
+		case ARG_INT:			return sizeof(int);
+		case ARG_LONG:			return sizeof(long);
+		case ARG_LONG_LONG:		return sizeof(int64_t);
+		case ARG_SIZE:			return sizeof(size_t);
+		case ARG_DOUBLE:		return sizeof(double);
+		case ARG_LONG_DOUBLE:	return sizeof(long double);
+		case ARG_POINTER:		return sizeof(void *);
+		case ARG_STRING:		return 1;
+		default:				return 0;
+	}
+}
+
+/*******************************************************************************
+ *
+ * The most bytes the argument of a conversion is encoded in, strings count
+ * only their null.
+ *
+ ******************************************************************************/
+uint32_t RobotLogFormat::getEncodedSize(ArgKind kind)
+{
+	switch (kind)
+	{
+		case ARG_INT:			return 5;
+		case ARG_DOUBLE:
+		case ARG_LONG_DOUBLE:	return 8;
+		case ARG_STRING:		return 1;
+		case ARG_NONE:
+		case ARG_UNSUPPORTED:	return 0;
+		default:				return 10;
+	}
+}
+
+/*******************************************************************************
+ *
+ * Rewrite the packed arguments of a line in the host independent form.
+ * Arguments that are missing from the line, or that do not fit in dest,
+ * are left out along with all the ones after them.
+ *
+ * @param	format	the line's format
+ * @param	args	the packed arguments
+ * @param	length	the bytes in args
+ * @param	dest	where to put the encoded arguments
+ * @param	size	the bytes in dest, twice length is always enough
+ *
+ * @return	the bytes put in dest
+ *
+ ******************************************************************************/
+uint32_t RobotLogFormat::encodeArgs(const char *format, const char *args,
+	uint32_t length, uint8_t *dest, uint32_t size)
+{
+	const char *args_end = &args[length];
+	uint32_t used = 0;
+
+	const char *p = format;
+	while ((p = strchr(p, '%')) != NULL)
+	{
+		ArgKind kind;
+		int stars;
+		p = parseConversion(p, &kind, &stars);
+		if (kind == ARG_UNSUPPORTED)
+		{
+			break;
+		}
+
+		bool missing = false;
+		for (int i = 0; (i < stars) && ! missing; i++)
+		{
+			int star;
+			missing = (used + 5 > size) || ! readArg(&args, args_end, &star);
+			if (! missing)
+			{
+				used += putSignedVarint(&dest[used], star);
+			}
+		}
+
+		if (missing || (used + getEncodedSize(kind) > size))
+		{
+			break;
+		}
+
+		switch (kind)
+		{
+			case ARG_INT:
+			{
+				int v;
+				missing = ! readArg(&args, args_end, &v);
+				if (! missing)
+				{
+					used += putSignedVarint(&dest[used], v);
+				}
+			} break;
+
+			case ARG_LONG:
+			{
+				long v;
+				missing = ! readArg(&args, args_end, &v);
+				if (! missing)
+				{
+					used += putSignedVarint(&dest[used], v);
+				}
+			} break;
+
+			case ARG_LONG_LONG:
+			{
+				int64_t v;
+				missing = ! readArg(&args, args_end, &v);
+				if (! missing)
+				{
+					used += putSignedVarint(&dest[used], v);
+				}
+			} break;
+
+			case ARG_SIZE:
+			{
+				size_t v;
+				missing = ! readArg(&args, args_end, &v);
+				if (! missing)
+				{
+					used += putVarint(&dest[used], v);
+				}
+			} break;
+
+			case ARG_DOUBLE:
+			{
+				double v;
+				missing = ! readArg(&args, args_end, &v);
+				if (! missing)
+				{
+					putDouble(&dest[used], v);
+					used += 8;
+				}
+			} break;
+
+			case ARG_LONG_DOUBLE:
+			{
+				long double v;
+				missing = ! readArg(&args, args_end, &v);
+				if (! missing)
+				{
+					putDouble(&dest[used], (double)v);
+					used += 8;
+				}
+			} break;
+
+			case ARG_POINTER:
+			{
+				void *v;
+				missing = ! readArg(&args, args_end, &v);
+				if (! missing)
+				{
+					used += putVarint(&dest[used], (size_t)v);
+				}
+			} break;
+
+			case ARG_STRING:
+			{
+				const char *end = (args < args_end) ?
+					(const char *)memchr(args, 0, args_end - args) : NULL;
+				if ((end == NULL) || (used + (end - args) + 1 > size))
+				{
+					missing = true;
+					break;
+				}
+				memcpy(&dest[used], args, end - args + 1);
+				used += end - args + 1;
+				args = end + 1;
+			} break;
+
+			default:
+				break;
+		}
+
+		if (missing)
+		{
+			break;
+		}
+	}
+
+	return used;
+}
+
+/*******************************************************************************
+ *
+ * Make the text of a line from its tag, its format, and its encoded
+ * arguments.  Conversions whose arguments are missing are left out along
+ * with the rest of the format.  A line that is cut off still ends with the
+ * newline of its format.
+ *
+ * @param	tag		the logger's name put in front of the line, NULL or
+ *					empty for none
+ * @param	text	where to put the line with its null
+ * @param	size	the chars in text
+ *
+ * @return	the length of the text
+ *
+ ******************************************************************************/
+uint32_t RobotLogFormat::formatLine(const char *tag, const char *format,
+	const uint8_t *args, uint32_t length, char *text, uint32_t size)
+{
+	const uint8_t *args_end = &args[length];
+
+	int used = 0;
+	if ((tag != NULL) && (*tag != 0))
+	{
+		used = snprintf(text, size, "%-18s:", tag);
+		if ((used < 0) || (used >= (int)size))
+		{
+			used = 0;
+		}
+	}
+
+	const char *p = format;
+	while ((*p != 0) && (used < (int)size - 1))
+	{
+		if (*p != '%')
+		{
+			text[used++] = *p++;
+			continue;
+		}
+
+		ArgKind kind;
+		int stars;
+		const char *end = parseConversion(p, &kind, &stars);
+
+		// make the conversion by itself, with the * filled in
+		char spec[64];
+		int spec_length = 0;
+		bool missing = (kind == ARG_UNSUPPORTED);
+		for (const char *c = p; (c < end) && (spec_length < (int)sizeof(spec) - 16); c++)
+		{
+			if (*c == '*')
+			{
+				int64_t star = 0;
+				uint32_t bytes = getSignedVarint(args, args_end, &star);
+				missing = missing || (bytes == 0);
+				args += bytes;
+				spec_length += sprintf(&spec[spec_length], "%d", (int)star);
+			}
+			else
+			{
+				spec[spec_length++] = *c;
+			}
+		}
+		spec[spec_length] = 0;
+		p = end;
+
+		if (missing)
+		{
+			break;
+		}
+
+		char *dest = &text[used];
+		size_t room = size - used;
+		int added = 0;
+		uint32_t bytes = 0;
+		int64_t i = 0;
+		uint64_t u = 0;
+
+		switch (kind)
+		{
+			case ARG_NONE:
+				added = snprintf(dest, room, "%%");
+				break;
+
+			case ARG_INT:
+				bytes = getSignedVarint(args, args_end, &i);
+				added = snprintf(dest, room, spec, (int)i);
+				break;
+
+			case ARG_LONG:
+				bytes = getSignedVarint(args, args_end, &i);
+				added = snprintf(dest, room, spec, (long)i);
+				break;
+
+			case ARG_LONG_LONG:
+				bytes = getSignedVarint(args, args_end, &i);
+				added = snprintf(dest, room, spec, i);
+				break;
+
+			case ARG_SIZE:
+				bytes = getVarint(args, args_end, &u);
+				added = snprintf(dest, room, spec, (size_t)u);
+				break;
+
+			case ARG_DOUBLE:
+			case ARG_LONG_DOUBLE:
+				if (args + 8 <= args_end)
+				{
+					bytes = 8;
+					if (kind == ARG_DOUBLE)
+					{
+						added = snprintf(dest, room, spec, getDouble(args));
+					}
+					else
+					{
+						added = snprintf(dest, room, spec, (long double)getDouble(args));
+					}
+				}
+				break;
+
+			case ARG_POINTER:
+				bytes = getVarint(args, args_end, &u);
+				added = snprintf(dest, room, spec, (void *)(size_t)u);
+				break;
+
+			case ARG_STRING:
+			{
+				const uint8_t *str_end = (args < args_end) ?
+					(const uint8_t *)memchr(args, 0, args_end - args) : NULL;
+				if (str_end != NULL)
+				{
+					bytes = str_end - args + 1;
+					added = snprintf(dest, room, spec, (const char *)args);
+				}
+			} break;
+
+			default:
+				break;
+		}
+
+		if ((bytes == 0) && (kind != ARG_NONE))
+		{
+			// an argument that is cut off may have printed garbage
+			text[used] = 0;
+			break;
+		}
+		args += bytes;
+		if (added > 0)
+		{
+			used += ((size_t)added < room) ? added : room - 1;
+		}
+	}
+
+	text[used] = 0;
+	keepNewline(text, used, size, format);
+	return strlen(text);
+}
+
+/*******************************************************************************
+ *
+ * Put back the newline at the end of the format if the line was cut off
+ * before it.
+ *
+ ******************************************************************************/
+void RobotLogFormat::keepNewline(char *text, uint32_t length, uint32_t size,
+	const char *format)
+{
+	uint32_t format_length = strlen(format);
+	if ((format_length == 0) || (format[format_length - 1] != '\n') ||
+		((length > 0) && (text[length - 1] == '\n')))
+	{
+		return;
+	}
+
+	if (length > size - 2)
+	{
+		length = size - 2;
+	}
+	text[length++] = '\n';
+	text[length] = 0;
+}
+
+/*******************************************************************************
+ *
+ * Put and get little endian numbers that need no alignment.
+ *
+ ******************************************************************************/
+void RobotLogFormat::put16(uint8_t *dest, uint16_t v)
+{
+	dest[0] = (uint8_t)v;
+	dest[1] = (uint8_t)(v >> 8);
+}
+
+void RobotLogFormat::put32(uint8_t *dest, uint32_t v)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		dest[i] = (uint8_t)(v >> (i * 8));
+	}
+}
+
+void RobotLogFormat::put64(uint8_t *dest, uint64_t v)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		dest[i] = (uint8_t)(v >> (i * 8));
+	}
+}
+
+void RobotLogFormat::putDouble(uint8_t *dest, double v)
+{
+	uint64_t bits;
+	memcpy(&bits, &v, sizeof(bits));
+	put64(dest, bits);
+}
+
+uint32_t RobotLogFormat::putVarint(uint8_t *dest, uint64_t v)
+{
+	uint32_t used = 0;
+	while (v >= 0x80)
+	{
+		dest[used++] = (uint8_t)(v | 0x80);
+		v >>= 7;
+	}
+	dest[used++] = (uint8_t)v;
+	return used;
+}
+
+uint32_t RobotLogFormat::putSignedVarint(uint8_t *dest, int64_t v)
+{
+	return putVarint(dest, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+uint16_t RobotLogFormat::get16(const uint8_t *src)
+{
+	return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+uint32_t RobotLogFormat::get32(const uint8_t *src)
+{
+	uint32_t v = 0;
+	for (int i = 3; i >= 0; i--)
+	{
+		v = (v << 8) | src[i];
+	}
+	return v;
+}
+
+uint64_t RobotLogFormat::get64(const uint8_t *src)
+{
+	uint64_t v = 0;
+	for (int i = 7; i >= 0; i--)
+	{
+		v = (v << 8) | src[i];
+	}
+	return v;
+}
+
+double RobotLogFormat::getDouble(const uint8_t *src)
+{
+	uint64_t bits = get64(src);
+	double v;
+	memcpy(&v, &bits, sizeof(v));
+	return v;
+}
+
+/*******************************************************************************
+ *
+ * Get a varint that ends before end.
+ *
+ * @return	the bytes used, 0 if the varint does not end before end
+ *
+ ******************************************************************************/
+uint32_t RobotLogFormat::getVarint(const uint8_t *src, const uint8_t *end, uint64_t *v)
+{
+	*v = 0;
+	for (uint32_t i = 0; (i < 10) && (&src[i] < end); i++)
+	{
+		*v |= (uint64_t)(src[i] & 0x7F) << (i * 7);
+		if ((src[i] & 0x80) == 0)
+		{
+			return i + 1;
+		}
+	}
+
+	*v = 0;
+	return 0;
+}
+
+uint32_t RobotLogFormat::getSignedVarint(const uint8_t *src, const uint8_t *end, int64_t *v)
+{
+	uint64_t u;
+	uint32_t used = getVarint(src, end, &u);
+	*v = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+	return used;
+}
+
+} // namespace gsi
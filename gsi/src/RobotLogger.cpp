@@ -2,7 +2,7 @@
  *
  * File: RobotLogger.h
  *  For detailed logging to both file and console simultaneously
- * 
+ *
  * Written by Joseph P. Foster
  *
  *
@@ -10,35 +10,177 @@
 
 #include "gsi/RobotLogger.h"
 
+#include "gsi/Atomic.h"
+#include "gsi/FlightRecorder.h"
+#include "gsi/RobotLogFormat.h"
+#include "gsi/Time.h"
+
+#include <map>
+#include <string>
+
+#if defined(_WINDOWS) && defined(_MSC_VER) && (_MSC_VER < 1900)
+#define snprintf _snprintf
+#define vsnprintf _vsnprintf
+#endif
+
 namespace gsi
 {
+	// writes the lines queued by the loggers when running asynchronously
+	class RobotLogWriter : public Thread
+	{
+		public:
+			RobotLogWriter(ThreadPriority priority)
+				: Thread("RobotLogWriter", priority)
+			{
+			}
+
+		protected:
+			void run()
+			{
+				while (! isStopRequested())
+				{
+					if (RobotLogger::drain() == 0)
+					{
+						sleep(RobotLogger::WRITE_PERIOD);
+					}
+				}
+			}
+	};
+
+	const double RobotLogger::WRITE_PERIOD = 0.02;
+
 	FILE* RobotLogger::def_log = NULL;
+	FILE* RobotLogger::binary_log = NULL;
+
+	// the ID of each tag and format written to the binary log, and the
+	// time in microseconds of the last record, only used by the writer
+	static std::map<std::string, uint32_t> log_sites;
+	static int64_t log_time = 0;
+
+	RobotLogWriter* RobotLogger::writer = NULL;
+	RobotLogger::LogRing* RobotLogger::rings[RobotLogger::MAX_THREADS];
+	int64_t RobotLogger::ring_owners[RobotLogger::MAX_THREADS];
+	volatile uint32_t RobotLogger::ring_ready[RobotLogger::MAX_THREADS];
+	volatile uint32_t RobotLogger::ring_count = 0;
+	volatile uint32_t RobotLogger::drop_count = 0;
+	Mutex RobotLogger::drain_lock;
+
 	void RobotLogger::initialize()
 	{
 		def_log = fopen("RobotLog.txt", "a");
 	}
-	
-	
+
+	// log from a writer thread from now on
+	void RobotLogger::startAsync(Thread::ThreadPriority priority)
+	{
+		if (writer != NULL)
+		{
+			return;
+		}
+
+		RobotLogWriter* w = new RobotLogWriter(priority);
+		w->start();
+		writer = w;
+	}
+
+	// log to a binary file from a writer thread from now on, false if the
+	// file could not be opened
+	bool RobotLogger::startBinary(const char* file_name, Thread::ThreadPriority priority)
+	{
+		if (writer != NULL)
+		{
+			return false;
+		}
+
+		FILE* file = fopen(file_name, "ab");
+		if (file == NULL)
+		{
+			printf("RobotLogger: could not open %s\n", file_name);
+			return false;
+		}
+
+		uint8_t record[RobotLogFormat::START_LENGTH];
+		record[0] = RobotLogFormat::RECORD_START;
+		RobotLogFormat::put32(&record[1], RobotLogFormat::MAGIC);
+		RobotLogFormat::put16(&record[5], RobotLogFormat::VERSION);
+		double start = Time::getMonotonicTime();
+		RobotLogFormat::putDouble(&record[7], Time::getTime());
+		RobotLogFormat::putDouble(&record[15], start);
+		fwrite(record, 1, sizeof(record), file);
+
+		log_sites.clear();
+		log_time = (int64_t)(start * 1000000.0);
+		binary_log = file;
+		startAsync(priority);
+		return true;
+	}
+
 	void RobotLogger::anonymousPrintf(const char* format, ...)
 	{
 		va_list ap;
 		va_start(ap,format);
-		vprintf(format,ap);
+		bool queued = queueLine(def_log, NULL, format, ap);
 		va_end(ap);
+		if (queued)
+		{
+			return;
+		}
+
 		va_start(ap,format);
-		vfprintf(def_log,format,ap);
+		vprintf(format,ap);
 		va_end(ap);
+		if (FlightRecorder::isOpen())
+		{
+			char text[LINE_LENGTH];
+			va_start(ap,format);
+			vsnprintf(text,sizeof(text),format,ap);
+			va_end(ap);
+			FlightRecorder::recordText(FlightRecorder::RECORD_LOG, text);
+		}
+		if (def_log != NULL)
+		{
+			va_start(ap,format);
+			vfprintf(def_log,format,ap);
+			va_end(ap);
+		}
 	}
-	
+
+	// the number of lines lost because a thread's ring was full
+	uint32_t RobotLogger::getDropCount()
+	{
+		return Atomic::loadAcquire(&drop_count);
+	}
+
 	void RobotLogger::terminate()
 	{
-		if(def_log == NULL)
+		if (writer != NULL)
+		{
+			RobotLogWriter* w = writer;
+			writer = NULL;
+
+			w->requestStop();
+			while (w->isRunning())
+			{
+				Thread::sleep(WRITE_PERIOD);
+			}
+			delete w;
+
+			drain();
+		}
+
+		if (binary_log != NULL)
+		{
+			fclose(binary_log);
+			binary_log = NULL;
+		}
+
+		if(def_log != NULL)
 		{
 			fclose(def_log);
 			def_log = NULL;
 		}
 	}
-	
+
 	RobotLogger::RobotLogger(const char* tag_name, const char* file_name)
 	{
 		if(strcmp(file_name,"\0") == 0)
@@ -49,35 +191,430 @@ namespace gsi
 		{
 			log = fopen(file_name, "a");
 		}
-		strcpy(name,tag_name);
+		owns_log = (log != def_log);
+		strncpy(name,tag_name,sizeof(name) - 1);
+		name[sizeof(name) - 1] = 0;
 	}
-	
+
 	void RobotLogger::robotPrintf(const char* format, ...)
 	{
-		char fmt[512];
-		sprintf(fmt,"%-18s:%s",name,format);
-		/*
 		va_list ap;
 		va_start(ap,format);
-		vprintf(fmt,ap);
+		bool queued = queueLine(log, name, format, ap);
 		va_end(ap);
+		if (queued)
+		{
+			return;
+		}
+
+		char fmt[512];
+		snprintf(fmt,sizeof(fmt),"%-18s:%s",name,format);
+
 		va_start(ap,format);
-		vfprintf(log,fmt,ap);
+		vprintf(fmt,ap);
 		va_end(ap);
-		fflush(log);
-		*/
-		
+		if (FlightRecorder::isOpen())
+		{
+			char text[LINE_LENGTH];
+			va_start(ap,format);
+			vsnprintf(text,sizeof(text),fmt,ap);
+			va_end(ap);
+			FlightRecorder::recordText(FlightRecorder::RECORD_LOG, text);
+		}
+		if (log != NULL)
+		{
+			va_start(ap,format);
+			vfprintf(log,fmt,ap);
+			va_end(ap);
+			fflush(log);
+		}
 	}
-	
+
 	RobotLogger::~RobotLogger()
 	{
-		if(def_log == NULL)
+		if(owns_log && (log != NULL))
 		{
+			// write the lines still queued for the file before closing it
+			drain();
 			fclose(log);
 			log = NULL;
 		}
 	}
-	
-	
-}
 
+	// format a line into the calling thread's ring, false if the line
+	// should be written synchronously
+	bool RobotLogger::queueLine(FILE* file, const char* tag, const char* format, va_list ap)
+	{
+		if (writer == NULL)
+		{
+			return false;
+		}
+
+		LogRing* ring = getRing();
+		if (ring == NULL)
+		{
+			return false;
+		}
+
+		uint32_t head = ring->head;
+		if (head - Atomic::loadAcquire(&ring->tail) >= RING_SIZE)
+		{
+			Atomic::fetchAdd(&drop_count, 1);
+			return true;
+		}
+
+		LogLine* line = &ring->lines[head & (RING_SIZE - 1)];
+		line->file = file;
+		line->time = Time::getMonotonicTime();
+
+		if (! packLine(line, tag, format, ap))
+		{
+			int length = 0;
+			if (tag != NULL)
+			{
+				length = snprintf(line->data, LINE_LENGTH, "%-18s:", tag);
+				if ((length < 0) || (length >= (int)LINE_LENGTH))
+				{
+					length = 0;
+				}
+			}
+			vsnprintf(&line->data[length], LINE_LENGTH - length, format, ap);
+			line->data[LINE_LENGTH - 1] = 0;
+			RobotLogFormat::keepNewline(line->data, strlen(line->data), LINE_LENGTH, format);
+			line->formatted = 1;
+		}
+
+		Atomic::storeRelease(&ring->head, head + 1);
+		return true;
+	}
+
+	// copy the tag, the format, and the arguments into the line, false
+	// without using any arguments if the caller has to format the line
+	bool RobotLogger::packLine(LogLine* line, const char* tag, const char* format, va_list ap)
+	{
+		uint32_t tag_length = (tag == NULL) ? 0 : strlen(tag);
+		uint32_t format_length = strlen(format);
+		if (tag_length + format_length + 2 > LINE_LENGTH)
+		{
+			return false;
+		}
+
+		// check every argument can be packed before using any of them,
+		// strings are cut off if they do not fit
+		uint32_t length = tag_length + format_length + 2;
+		const char* p = format;
+		while ((p = strchr(p, '%')) != NULL)
+		{
+			RobotLogFormat::ArgKind kind;
+			int stars;
+			p = RobotLogFormat::parseConversion(p, &kind, &stars);
+			if (kind == RobotLogFormat::ARG_UNSUPPORTED)
+			{
+				return false;
+			}
+			length += stars * sizeof(int) + RobotLogFormat::getArgSize(kind);
+		}
+		if (length > LINE_LENGTH)
+		{
+			return false;
+		}
+
+		char* data = line->data;
+		memcpy(data, (tag == NULL) ? "" : tag, tag_length + 1);
+		memcpy(&data[tag_length + 1], format, format_length + 1);
+
+		// the arguments follow, copied with memcpy so they need no alignment
+		uint32_t reserved = length - (tag_length + format_length + 2);
+		length = tag_length + format_length + 2;
+		p = format;
+		while ((p = strchr(p, '%')) != NULL)
+		{
+			RobotLogFormat::ArgKind kind;
+			int stars;
+			p = RobotLogFormat::parseConversion(p, &kind, &stars);
+			reserved -= stars * sizeof(int);
+
+			for (int i = 0; i < stars; i++)
+			{
+				int star = va_arg(ap, int);
+				memcpy(&data[length], &star, sizeof(star));
+				length += sizeof(star);
+			}
+
+			uint32_t size = RobotLogFormat::getArgSize(kind);
+			if (size == 0)
+			{
+				continue;
+			}
+
+			switch (kind)
+			{
+				case RobotLogFormat::ARG_INT:
+				{
+					int v = va_arg(ap, int);
+					memcpy(&data[length], &v, size);
+				} break;
+
+				case RobotLogFormat::ARG_LONG:
+				{
+					long v = va_arg(ap, long);
+					memcpy(&data[length], &v, size);
+				} break;
+
+				case RobotLogFormat::ARG_LONG_LONG:
+				{
+					int64_t v = va_arg(ap, int64_t);
+					memcpy(&data[length], &v, size);
+				} break;
+
+				case RobotLogFormat::ARG_SIZE:
+				{
+					size_t v = va_arg(ap, size_t);
+					memcpy(&data[length], &v, size);
+				} break;
+
+				case RobotLogFormat::ARG_DOUBLE:
+				{
+					double v = va_arg(ap, double);
+					memcpy(&data[length], &v, size);
+				} break;
+
+				case RobotLogFormat::ARG_LONG_DOUBLE:
+				{
+					long double v = va_arg(ap, long double);
+					memcpy(&data[length], &v, size);
+				} break;
+
+				case RobotLogFormat::ARG_POINTER:
+				{
+					void* v = va_arg(ap, void*);
+					memcpy(&data[length], &v, size);
+				} break;
+
+				case RobotLogFormat::ARG_STRING:
+				{
+					// copy as much of the string as fits with room left for
+					// the arguments after it, always with a null
+					const char* v = va_arg(ap, const char*);
+					if (v == NULL)
+					{
+						v = "(null)";
+					}
+					uint32_t room = LINE_LENGTH - length - (reserved - 1);
+					size = strlen(v) + 1;
+					if (size > room)
+					{
+						size = room;
+					}
+					memcpy(&data[length], v, size - 1);
+					data[length + size - 1] = 0;
+				} break;
+
+				default:
+					break;
+			}
+			length += size;
+			reserved -= RobotLogFormat::getArgSize(kind);
+		}
+
+		line->length = length;
+		line->formatted = 0;
+		return true;
+	}
+
+	// format a packed line, text must hold LINE_LENGTH chars, conversions
+	// whose arguments did not fit are left out
+	void RobotLogger::formatLine(LogLine* line, char* text)
+	{
+		if (line->formatted)
+		{
+			memcpy(text, line->data, LINE_LENGTH);
+			return;
+		}
+
+		const char* tag = line->data;
+		const char* format = &tag[strlen(tag) + 1];
+		const char* args = &format[strlen(format) + 1];
+
+		uint8_t encoded[2 * LINE_LENGTH];
+		uint32_t length = RobotLogFormat::encodeArgs(format, args,
+			&line->data[line->length] - args, encoded, sizeof(encoded));
+		RobotLogFormat::formatLine(tag, format, encoded, length, text, LINE_LENGTH);
+	}
+
+	// write a line to the binary log, with its site the first time the
+	// site is used
+	void RobotLogger::writeBinary(LogLine* line)
+	{
+		uint8_t record[RobotLogFormat::MAX_HEADER_LENGTH + 2 * LINE_LENGTH];
+
+		int64_t time = (int64_t)(line->time * 1000000.0);
+		int64_t delta = time - log_time;
+		log_time = time;
+
+		// once the log has MAX_SITES sites, lines from new ones are written
+		// as text so a decoder can bound the sites it keeps
+		char text[LINE_LENGTH];
+		const char* text_line = line->formatted ? line->data : NULL;
+		if ((text_line == NULL) && (log_sites.size() >= RobotLogFormat::MAX_SITES))
+		{
+			const char* tag = line->data;
+			const char* args = &tag[strlen(tag) + 1];
+			args = &args[strlen(args) + 1];
+			if (log_sites.find(std::string(tag, args - tag)) == log_sites.end())
+			{
+				formatLine(line, text);
+				text_line = text;
+			}
+		}
+
+		if (text_line != NULL)
+		{
+			uint32_t length = strlen(text_line);
+			uint32_t used = 0;
+			record[used++] = RobotLogFormat::RECORD_TEXT;
+			used += RobotLogFormat::putSignedVarint(&record[used], delta);
+			used += RobotLogFormat::putVarint(&record[used], length);
+			memcpy(&record[used], text_line, length);
+			fwrite(record, 1, used + length, binary_log);
+			return;
+		}
+
+		const char* tag = line->data;
+		const char* format = &tag[strlen(tag) + 1];
+		const char* args = &format[strlen(format) + 1];
+
+		std::string site(tag, args - tag);
+		std::map<std::string, uint32_t>::iterator it = log_sites.find(site);
+		uint32_t id;
+		if (it == log_sites.end())
+		{
+			id = log_sites.size();
+			log_sites[site] = id;
+
+			uint32_t used = 0;
+			record[used++] = RobotLogFormat::RECORD_SITE;
+			used += RobotLogFormat::putVarint(&record[used], id);
+			used += RobotLogFormat::putVarint(&record[used], site.size());
+			fwrite(record, 1, used, binary_log);
+			fwrite(site.data(), 1, site.size(), binary_log);
+		}
+		else
+		{
+			id = it->second;
+		}
+
+		// the arguments go after the longest header, then the header is
+		// put right in front of them
+		uint8_t* encoded = &record[RobotLogFormat::MAX_HEADER_LENGTH];
+		uint32_t length = RobotLogFormat::encodeArgs(format, args,
+			&line->data[line->length] - args, encoded, 2 * LINE_LENGTH);
+
+		uint8_t header[RobotLogFormat::MAX_HEADER_LENGTH];
+		uint32_t used = 0;
+		header[used++] = RobotLogFormat::RECORD_LINE;
+		used += RobotLogFormat::putVarint(&header[used], id);
+		used += RobotLogFormat::putSignedVarint(&header[used], delta);
+		used += RobotLogFormat::putVarint(&header[used], length);
+		memcpy(encoded - used, header, used);
+		fwrite(encoded - used, 1, used + length, binary_log);
+	}
+
+	// find the calling thread's ring, making it the first time the thread
+	// logs, NULL if MAX_THREADS threads already have rings
+	RobotLogger::LogRing* RobotLogger::getRing()
+	{
+		int64_t id = Thread::getCurrentId();
+
+		uint32_t count = Atomic::loadAcquire(&ring_count);
+		if (count > MAX_THREADS)
+		{
+			count = MAX_THREADS;
+		}
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (Atomic::loadAcquire(&ring_ready[i]) && (ring_owners[i] == id))
+			{
+				return rings[i];
+			}
+		}
+
+		uint32_t index = Atomic::fetchAdd(&ring_count, 1);
+		if (index >= MAX_THREADS)
+		{
+			return NULL;
+		}
+
+		LogRing* ring = new LogRing;
+		ring->head = 0;
+		ring->tail = 0;
+
+		rings[index] = ring;
+		ring_owners[index] = id;
+		Atomic::storeRelease(&ring_ready[index], 1);
+
+		return ring;
+	}
+
+	// write every queued line, returns the number of lines written
+	uint32_t RobotLogger::drain()
+	{
+		MutexScopeLock lock(drain_lock);
+
+		uint32_t written = 0;
+
+		uint32_t count = Atomic::loadAcquire(&ring_count);
+		if (count > MAX_THREADS)
+		{
+			count = MAX_THREADS;
+		}
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (! Atomic::loadAcquire(&ring_ready[i]))
+			{
+				continue;
+			}
+
+			LogRing* ring = rings[i];
+			uint32_t tail = ring->tail;
+			uint32_t head = Atomic::loadAcquire(&ring->head);
+			while (tail != head)
+			{
+				char text[LINE_LENGTH];
+				LogLine* line = &ring->lines[tail & (RING_SIZE - 1)];
+				if (binary_log != NULL)
+				{
+					writeBinary(line);
+					if (FlightRecorder::isOpen())
+					{
+						formatLine(line, text);
+						FlightRecorder::recordText(FlightRecorder::RECORD_LOG, text, line->time);
+					}
+				}
+				else
+				{
+					formatLine(line, text);
+					fputs(text, stdout);
+					if (line->file != NULL)
+					{
+						fputs(text, line->file);
+					}
+					FlightRecorder::recordText(FlightRecorder::RECORD_LOG, text, line->time);
+				}
+				tail++;
+				written++;
+			}
+			Atomic::storeRelease(&ring->tail, tail);
+		}
+
+		if (written > 0)
+		{
+			fflush(NULL);
+		}
+
+		return written;
+	}
+
+}
@@ -0,0 +1,292 @@
+/*******************************************************************************
+ *
+ * File: SocketReactor.cpp
+ * 	Generic System Interface socket event reactor
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include "gsi/SocketReactor.h"
+
+#include "gsi/Exception.h"
+
+#include <stdio.h>
+
+#if defined(LINUX)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+namespace gsi
+{
+
+const double SocketReactor::POLL_PERIOD = 0.1;
+
+/*******************************************************************************
+ *
+ * @throws Exception if the event descriptors cannot be created
+ *
+ ******************************************************************************/
+SocketReactor::SocketReactor(std::string name, ThreadPriority priority,
+	uint32_t options, uint32_t stack_size)
+	: Thread(name, priority, options, stack_size)
+{
+#if defined(LINUX)
+	epoll_desc = epoll_create(MAX_EVENTS);
+	if (epoll_desc < 0)
+	{
+		throw Exception("Could not create epoll descriptor", errno, __FILE__, __LINE__);
+	}
+
+	wake_desc = eventfd(0, EFD_NONBLOCK);
+	if (wake_desc < 0)
+	{
+		int err = errno;
+		close(epoll_desc);
+		throw Exception("Could not create eventfd", err, __FILE__, __LINE__);
+	}
+
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.fd = wake_desc;
+	if (epoll_ctl(epoll_desc, EPOLL_CTL_ADD, wake_desc, &event) != 0)
+	{
+		int err = errno;
+		close(wake_desc);
+		close(epoll_desc);
+		throw Exception("Could not add eventfd to epoll", err, __FILE__, __LINE__);
+	}
+#endif
+}
+
+/*******************************************************************************
+ *
+ * The reactor should be stopped before it is deleted.
+ *
+ ******************************************************************************/
+SocketReactor::~SocketReactor(void)
+{
+#if defined(LINUX)
+	close(wake_desc);
+	close(epoll_desc);
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Start calling the handler when the socket has datagrams to receive.  If
+ * datagrams are already queued the handler is called right away.
+ *
+ * @return	true if the socket was added
+ *
+ ******************************************************************************/
+bool SocketReactor::addSocket(UdpSocket *socket, SocketReactorHandler *handler)
+{
+	if ((socket == NULL) || (handler == NULL))
+	{
+		return false;
+	}
+
+	if (socket->setNonBlocking(true) != 0)
+	{
+		printf("SocketReactor::addSocket - could not make socket non-blocking for %s\n",
+			getName().c_str());
+		return false;
+	}
+
+	int32_t descriptor = socket->getDescriptor();
+
+	MutexScopeLock lock(socket_lock);
+
+	SocketEntry entry;
+	entry.socket = socket;
+	entry.handler = handler;
+	socket_map[descriptor] = entry;
+
+#if defined(LINUX)
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN | EPOLLET;
+	event.data.fd = descriptor;
+	if (epoll_ctl(epoll_desc, EPOLL_CTL_ADD, descriptor, &event) != 0)
+	{
+		printf("SocketReactor::addSocket - could not add socket to %s, error %d\n",
+			getName().c_str(), errno);
+		socket_map.erase(descriptor);
+		return false;
+	}
+#endif
+
+	return true;
+}
+
+/*******************************************************************************
+ *
+ * Stop calling the socket's handler, the socket is left non-blocking.  This
+ * must not be called from a handler.
+ *
+ ******************************************************************************/
+void SocketReactor::removeSocket(UdpSocket *socket)
+{
+	if (socket == NULL)
+	{
+		return;
+	}
+
+	int32_t descriptor = socket->getDescriptor();
+
+	MutexScopeLock lock(socket_lock);
+
+#if defined(LINUX)
+	epoll_ctl(epoll_desc, EPOLL_CTL_DEL, descriptor, NULL);
+#endif
+
+	socket_map.erase(descriptor);
+}
+
+/*******************************************************************************
+ *
+ * Ask the reactor to stop and wake it if it is waiting.
+ *
+ ******************************************************************************/
+void SocketReactor::requestStop(void)
+{
+	Thread::requestStop();
+
+#if defined(LINUX)
+	uint64_t one = 1;
+	if (write(wake_desc, &one, sizeof(one)) != sizeof(one))
+	{
+		printf("SocketReactor::requestStop - could not wake %s, error %d\n",
+			getName().c_str(), errno);
+	}
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Wait for sockets to have datagrams and call their handlers until a stop
+ * is requested.
+ *
+ ******************************************************************************/
+void SocketReactor::run(void)
+{
+#if defined(LINUX)
+	struct epoll_event events[MAX_EVENTS];
+
+	while (! isStopRequested())
+	{
+		int count = epoll_wait(epoll_desc, events, MAX_EVENTS, -1);
+		if (count < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			printf("SocketReactor::run - epoll_wait failed for %s, error %d\n",
+				getName().c_str(), errno);
+			break;
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			if (events[i].data.fd == wake_desc)
+			{
+				uint64_t value;
+				while (read(wake_desc, &value, sizeof(value)) > 0)
+				{
+				}
+			}
+			else
+			{
+				dispatch(events[i].data.fd);
+			}
+		}
+	}
+
+#else
+	while (! isStopRequested())
+	{
+		fd_set fds;
+		int32_t max_descriptor = -1;
+
+		FD_ZERO(&fds);
+		socket_lock.lock();
+		for (std::map<int32_t, SocketEntry>::iterator it = socket_map.begin();
+			it != socket_map.end(); it++)
+		{
+			FD_SET(it->first, &fds);
+			if (it->first > max_descriptor)
+			{
+				max_descriptor = it->first;
+			}
+		}
+		socket_lock.unlock();
+
+		if (max_descriptor < 0)
+		{
+			sleep(POLL_PERIOD);
+			continue;
+		}
+
+		struct timeval tv;
+		tv.tv_sec = 0;
+		tv.tv_usec = (long)(POLL_PERIOD * 1000000);
+
+		int count = select(max_descriptor + 1, &fds, NULL, NULL, &tv);
+		if (count <= 0)
+		{
+			continue;
+		}
+
+		for (int32_t descriptor = 0; descriptor <= max_descriptor; descriptor++)
+		{
+			if (FD_ISSET(descriptor, &fds))
+			{
+				dispatch(descriptor);
+			}
+		}
+	}
+
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Call the handler of a socket that has datagrams to receive, if it has not
+ * been removed.
+ *
+ ******************************************************************************/
+void SocketReactor::dispatch(int32_t descriptor)
+{
+	MutexScopeLock lock(socket_lock);
+
+	std::map<int32_t, SocketEntry>::iterator it = socket_map.find(descriptor);
+	if (it == socket_map.end())
+	{
+		return;
+	}
+
+	try
+	{
+		it->second.handler->socketReadable(it->second.socket);
+	}
+	catch (std::exception& ex)
+	{
+		printf("SocketReactor::dispatch - unhandled exception in handler of %s -- %s\n",
+			getName().c_str(), ex.what());
+	}
+	catch (...)
+	{
+		printf("SocketReactor::dispatch - unhandled exception in handler of %s\n",
+			getName().c_str());
+	}
+}
+
+} // namespace gsi
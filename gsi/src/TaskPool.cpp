@@ -0,0 +1,507 @@
+/*******************************************************************************
+ *
+ * File: TaskPool.cpp
+ * 	Generic System Interface work stealing task pool
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include "gsi/TaskPool.h"
+
+#include <stdio.h>
+#include <sstream>
+
+namespace gsi
+{
+
+// a value larger than the number of times any of the semaphores can be given
+static const int TASK_POOL_SEM_MAX = 0x7FFFFFFF;
+
+// how long wait() blocks before looking for tasks it can help with again,
+// the group's semaphore wakes it right away when its last task is done
+static const int TASK_GROUP_POLL_MSEC = 1;
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+TaskGroup::TaskGroup(TaskPool *pool)
+	: done_sem(0, TASK_POOL_SEM_MAX)
+{
+	group_pool = pool;
+	pending_count = 0;
+	spawn_count = 0;
+}
+
+/*******************************************************************************
+ *
+ * Wait for any tasks that are still running, a group must not go away while
+ * its tasks can still tell it they are done.
+ *
+ ******************************************************************************/
+TaskGroup::~TaskGroup(void)
+{
+	wait();
+}
+
+/*******************************************************************************
+ *
+ * Give a task to the pool to be run by one of its workers, or by the
+ * thread that calls wait().
+ *
+ ******************************************************************************/
+void TaskGroup::spawn(Task *task)
+{
+	if ((group_pool == NULL) || (! group_pool->isRunning()))
+	{
+		task->execute();
+		return;
+	}
+
+	spawn_count++;
+	Atomic::fetchAdd(&pending_count, 1);
+	group_pool->submit(task, this);
+}
+
+/*******************************************************************************
+ *
+ * Run tasks from the pool until every task spawned by this group is done.
+ *
+ ******************************************************************************/
+void TaskGroup::wait(void)
+{
+	if (spawn_count == 0)
+	{
+		return;
+	}
+
+	// the last task to finish gives the semaphore once, so it must be taken
+	// before returning or the next wait() would return too soon
+	int32_t worker = group_pool->getCurrentWorker();
+	bool done = false;
+	while (! done)
+	{
+		if ((Atomic::loadAcquire(&pending_count) == 0)
+			|| (! group_pool->runTask(worker)))
+		{
+			done = done_sem.take(TASK_GROUP_POLL_MSEC);
+		}
+	}
+
+	spawn_count = 0;
+}
+
+/*******************************************************************************
+ *
+ * Called by the pool after each of this group's tasks has run.
+ *
+ ******************************************************************************/
+void TaskGroup::taskDone(void)
+{
+	if (Atomic::fetchAdd(&pending_count, (uint32_t)-1) == 1)
+	{
+		done_sem.give();
+	}
+}
+
+/*******************************************************************************
+ *
+ * Create a pool, the workers are not created until start() is called.
+ *
+ * @param	name			used to name the worker threads
+ * @param	worker_count	the number of worker threads, usually one less
+ *							than the number of CPUs since the thread that
+ *							waits on a TaskGroup also runs tasks
+ *
+ ******************************************************************************/
+TaskPool::TaskPool(std::string name, uint32_t worker_count,
+	Thread::ThreadPriority priority, uint32_t options, uint32_t stack_size)
+	: start_sem(0, TASK_POOL_SEM_MAX)
+	, wake_sem(0, TASK_POOL_SEM_MAX)
+{
+	pool_name = name;
+	idle_count = 0;
+	steal_count = 0;
+	next_worker = 0;
+	is_running = 0;
+
+	for (uint32_t i = 0; i < worker_count; i++)
+	{
+		std::ostringstream worker_name;
+		worker_name << name << "_" << i;
+
+		TaskPoolWorker *worker = new TaskPoolWorker(worker_name.str(), this,
+			priority, options, stack_size);
+		worker->worker_index = i;
+		worker_list.push_back(worker);
+	}
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+TaskPool::~TaskPool(void)
+{
+	stop();
+
+	for (uint32_t i = 0; i < worker_list.size(); i++)
+	{
+		delete worker_list[i];
+	}
+	worker_list.clear();
+}
+
+/*******************************************************************************
+ *
+ * Start the workers, this returns after all of them are ready for tasks.
+ *
+ ******************************************************************************/
+void TaskPool::start(void)
+{
+	if (isRunning() || (worker_list.size() == 0))
+	{
+		return;
+	}
+
+	for (uint32_t i = 0; i < worker_list.size(); i++)
+	{
+		worker_list[i]->start();
+	}
+
+	for (uint32_t i = 0; i < worker_list.size(); i++)
+	{
+		start_sem.take();
+	}
+
+	Atomic::storeRelease(&is_running, 1);
+}
+
+/*******************************************************************************
+ *
+ * Stop the workers and wait for them to finish.  Tasks still in the queues
+ * are run by the calling thread so no TaskGroup is left waiting.
+ *
+ ******************************************************************************/
+void TaskPool::stop(void)
+{
+	if (! isRunning())
+	{
+		return;
+	}
+
+	Atomic::storeRelease(&is_running, 0);
+
+	for (uint32_t i = 0; i < worker_list.size(); i++)
+	{
+		worker_list[i]->requestStop();
+	}
+
+	for (uint32_t i = 0; i < worker_list.size(); i++)
+	{
+		wake_sem.give();
+	}
+
+	for (uint32_t i = 0; i < worker_list.size(); i++)
+	{
+		while (worker_list[i]->isRunning())
+		{
+			Thread::sleep(0.001);
+		}
+		worker_list[i]->worker_thread_id = Thread::THREAD_ID_ERROR;
+	}
+
+	while (runTask(-1))
+	{
+	}
+}
+
+/*******************************************************************************
+ *
+ * @return	true if tasks are being given to the workers, false if spawned
+ *			tasks are run by the thread that spawns them
+ *
+ ******************************************************************************/
+bool TaskPool::isRunning(void)
+{
+	return (Atomic::loadAcquire(&is_running) != 0);
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+uint32_t TaskPool::getWorkerCount(void)
+{
+	return worker_list.size();
+}
+
+/*******************************************************************************
+ *
+ * @return	the number of tasks that were run by a thread other than the
+ *			worker whose queue they were put in
+ *
+ ******************************************************************************/
+uint32_t TaskPool::getStealCount(void)
+{
+	return Atomic::loadAcquire(&steal_count);
+}
+
+/*******************************************************************************
+ *
+ * Put a task in the calling worker's queue, or in the next worker's queue
+ * if the caller is not one of the workers, then wake an idle worker.
+ *
+ ******************************************************************************/
+void TaskPool::submit(Task *task, TaskGroup *group)
+{
+	int32_t worker = getCurrentWorker();
+	if (worker < 0)
+	{
+		worker = Atomic::fetchAdd(&next_worker, 1) % worker_list.size();
+	}
+
+	TaskEntry entry;
+	entry.task = task;
+	entry.group = group;
+
+	TaskPoolWorker *owner = worker_list[worker];
+	owner->queue_lock.lock();
+	owner->task_queue.push_back(entry);
+	owner->queue_lock.unlock();
+
+	wakeWorker();
+}
+
+/*******************************************************************************
+ *
+ * Run one task if one can be found.
+ *
+ * @param	worker	the index of the calling worker, or -1 if the caller is
+ *					not one of the workers
+ *
+ * @return	true if a task was run
+ *
+ ******************************************************************************/
+bool TaskPool::runTask(int32_t worker)
+{
+	TaskEntry entry;
+	if (! takeTask(worker, entry))
+	{
+		return false;
+	}
+
+	runEntry(entry);
+	return true;
+}
+
+/*******************************************************************************
+ *
+ * Take the newest task from the worker's own queue, or the oldest task from
+ * another worker's queue.
+ *
+ ******************************************************************************/
+bool TaskPool::takeTask(int32_t worker, TaskEntry &entry)
+{
+	uint32_t count = worker_list.size();
+	if (count == 0)
+	{
+		return false;
+	}
+
+	if (worker >= 0)
+	{
+		TaskPoolWorker *own = worker_list[worker];
+		MutexScopeLock lock(own->queue_lock);
+		if (! own->task_queue.empty())
+		{
+			entry = own->task_queue.back();
+			own->task_queue.pop_back();
+			return true;
+		}
+	}
+
+	// start with a different victim each time so thieves spread out
+	uint32_t first = Atomic::fetchAdd(&next_worker, 1);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		int32_t victim = (first + i) % count;
+		if (victim == worker)
+		{
+			continue;
+		}
+
+		TaskPoolWorker *other = worker_list[victim];
+		MutexScopeLock lock(other->queue_lock);
+		if (! other->task_queue.empty())
+		{
+			entry = other->task_queue.front();
+			other->task_queue.pop_front();
+			Atomic::fetchAdd(&steal_count, 1);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*******************************************************************************
+ *
+ * @return	true if any worker has a task in its queue
+ *
+ ******************************************************************************/
+bool TaskPool::hasTask(void)
+{
+	for (uint32_t i = 0; i < worker_list.size(); i++)
+	{
+		MutexScopeLock lock(worker_list[i]->queue_lock);
+		if (! worker_list[i]->task_queue.empty())
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*******************************************************************************
+ *
+ * Run a task and tell its group it is done, even if it throws.
+ *
+ ******************************************************************************/
+void TaskPool::runEntry(TaskEntry &entry)
+{
+	try
+	{
+		entry.task->execute();
+	}
+	catch (std::exception& ex)
+	{
+		printf("TaskPool::runEntry - unhandled exception in task of %s -- %s\n",
+			pool_name.c_str(), ex.what());
+	}
+	catch (...)
+	{
+		printf("TaskPool::runEntry - unhandled exception in task of %s\n",
+			pool_name.c_str());
+	}
+
+	entry.group->taskDone();
+}
+
+/*******************************************************************************
+ *
+ * @return	the index of the worker that is calling this method, or -1 if it
+ *			is not called from one of the workers
+ *
+ ******************************************************************************/
+int32_t TaskPool::getCurrentWorker(void)
+{
+	int64_t id = Thread::getCurrentId();
+	for (uint32_t i = 0; i < worker_list.size(); i++)
+	{
+		if (worker_list[i]->worker_thread_id == id)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/*******************************************************************************
+ *
+ * Block an idle worker until a task is added or the pool is stopped.
+ *
+ * The worker counts itself as idle before it looks at the queues one last
+ * time, so a task added after that look will see it and wake it.  If it does
+ * find a task it takes itself off the idle count, unless a waker already
+ * did and gave the semaphore for it.
+ *
+ ******************************************************************************/
+void TaskPool::waitForTask(void)
+{
+	Atomic::fetchAdd(&idle_count, 1);
+
+	if ((hasTask() || (! isRunning())) && claimIdle())
+	{
+		return;
+	}
+
+	wake_sem.take();
+}
+
+/*******************************************************************************
+ *
+ * Wake one idle worker, if there are any.
+ *
+ ******************************************************************************/
+void TaskPool::wakeWorker(void)
+{
+	if (claimIdle())
+	{
+		wake_sem.give();
+	}
+}
+
+/*******************************************************************************
+ *
+ * @return	true if the idle count was taken down by one, false if it was
+ *			already 0
+ *
+ ******************************************************************************/
+bool TaskPool::claimIdle(void)
+{
+	uint32_t idle = Atomic::loadAcquire(&idle_count);
+	while (idle > 0)
+	{
+		if (Atomic::compareExchange(&idle_count, idle, idle - 1))
+		{
+			return true;
+		}
+		idle = Atomic::loadAcquire(&idle_count);
+	}
+
+	return false;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+TaskPoolWorker::TaskPoolWorker(std::string name, TaskPool *pool,
+	ThreadPriority priority, uint32_t options, uint32_t stack_size)
+	: Thread(name, priority, options, stack_size)
+{
+	worker_pool = pool;
+	worker_index = -1;
+	worker_thread_id = THREAD_ID_ERROR;
+}
+
+/*******************************************************************************
+ *
+ * Remember which thread this worker is so the pool can tell when tasks are
+ * spawned from it, then let start() know this worker is ready.
+ *
+ ******************************************************************************/
+void TaskPoolWorker::initialize(void)
+{
+	worker_thread_id = Thread::getCurrentId();
+	worker_pool->start_sem.give();
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+void TaskPoolWorker::run(void)
+{
+	while (! isStopRequested())
+	{
+		if (! worker_pool->runTask(worker_index))
+		{
+			worker_pool->waitForTask();
+		}
+	}
+}
+
+} // namespace gsi
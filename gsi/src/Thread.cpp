@@ -11,8 +11,20 @@
  *
  ******************************************************************************/
 #include "gsi/Thread.h"
+#include "gsi/Time.h"
+#include "gsi/FlightRecorder.h"
 #include <stdio.h>
 
+#if defined (PTHREADS)
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#if defined (LINUX)
+#include <sys/syscall.h>
+#endif
+#endif
+
 #include <sstream>
 
 namespace gsi
@@ -33,7 +45,9 @@ namespace gsi
  *						specified this defaults to VX_FP_TASK.
  *
  * @param	stack_size	The size of the stack for this thread in bytes. If not
- *						specified this defaults to 32768.
+ *						specified this defaults to STACK_SIZE_DEFAULT, which
+ *						is 0 (the system default) with PThreads and 32768
+ *						with VxWorks.
  *
  ******************************************************************************/
 Thread::Thread(std::string name, Thread::ThreadPriority priority, 
@@ -43,6 +57,7 @@ Thread::Thread(std::string name, Thread::ThreadPriority priority,
 	thread_priority = priority;
 	thread_options = options;
 	thread_size = stack_size & 0xFFFFFFFE; // make sure it's even
+	thread_cpu = CPU_ANY;
 	
 	is_running = false;
 	is_stop_requested = false;
@@ -51,6 +66,8 @@ Thread::Thread(std::string name, Thread::ThreadPriority priority,
 
 #if defined(_WINDOWS)
 	thread_handle = NULL;
+#elif defined(PTHREADS)
+	thread_tid = 0;
 #endif
 }
 
@@ -83,7 +100,52 @@ void Thread::start(void)
 	{
 		is_stop_requested = false;
 #if defined (PTHREADS)
-		pthread_create((pthread_t *)(&thread_id),NULL,Thread::runHandle,this);
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+
+		if (thread_size > 0)
+		{
+			pthread_attr_setstacksize(&attr,
+				(thread_size < PTHREAD_STACK_MIN) ? PTHREAD_STACK_MIN : thread_size);
+		}
+
+		if (isRealTime())
+		{
+			int policy = (thread_options & OPTION_SCHED_FIFO) ? SCHED_FIFO : SCHED_RR;
+			struct sched_param param;
+			param.sched_priority = getRealTimePriority(policy);
+
+			pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+			pthread_attr_setschedpolicy(&attr, policy);
+			pthread_attr_setschedparam(&attr, &param);
+		}
+
+#if defined (LINUX)
+		if (thread_cpu != CPU_ANY)
+		{
+			cpu_set_t cpus;
+			CPU_ZERO(&cpus);
+			CPU_SET(thread_cpu, &cpus);
+			pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+		}
+#endif
+
+		int result = pthread_create((pthread_t *)(&thread_id), &attr, Thread::runHandle, this);
+		if ((result == EPERM) && isRealTime())
+		{
+			printf("Thread::start - not permitted to use real-time scheduling for %s, "
+				"using the default scheduler\n", thread_name.c_str());
+			pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+			result = pthread_create((pthread_t *)(&thread_id), &attr, Thread::runHandle, this);
+		}
+
+		if (result != 0)
+		{
+			printf("Thread::start - could not create thread %s, error %d\n",
+				thread_name.c_str(), result);
+		}
+
+		pthread_attr_destroy(&attr);
 
 #elif defined(VXWORKS)
 		thread_id = (int64_t)(taskSpawn((char *)(thread_name.c_str()), thread_priority, 
@@ -133,6 +195,40 @@ void Thread::sleep(double time)
 	}
 }
 
+/*******************************************************************************
+ *
+ * Delay the calling thread until an absolute time.  Sleeping until a time
+ * instead of for a time keeps periodic threads from drifting by the time
+ * it takes to compute how long to sleep.
+ *
+ * @param	monotonic_time	the time, from Time::getMonotonicTime(), at
+ *							which the thread should continue, if it has
+ *							already passed this returns right away
+ *
+ ******************************************************************************/
+void Thread::sleepUntil(double monotonic_time)
+{
+#if defined (PTHREADS)
+	struct timespec req;
+	req.tv_sec = (time_t)monotonic_time;
+	req.tv_nsec = (long)((monotonic_time - req.tv_sec) * 1000000000);
+	if (req.tv_nsec >= 1000000000)
+	{
+		req.tv_sec++;
+		req.tv_nsec -= 1000000000;
+	}
+
+	// restart if a signal interrupts, the deadline does not move
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &req, NULL) == EINTR)
+	{
+	}
+
+#else
+	sleep(monotonic_time - Time::getMonotonicTime());
+
+#endif
+}
+
 /*******************************************************************************
  *
  * Set the priority that this thread should have when it is run.
@@ -148,7 +244,10 @@ void Thread::setPriority(Thread::ThreadPriority priority)
 	thread_priority = priority;
 
 #if defined (PTHREADS)
-	// @TODO:
+	if (is_running)
+	{
+		applyPriority();
+	}
 
 #elif defined(VXWORKS)
 	if (is_running)
@@ -175,7 +274,7 @@ void Thread::setPriority(Thread::ThreadPriority priority)
 Thread::ThreadPriority Thread::getPriority(void)
 {
 #if defined (PTHREADS)
-	// @TODO:
+	// the priority is only changed through setPriority()
 
 #elif defined(VXWORKS)
 	if (is_running)
@@ -263,6 +362,151 @@ uint32_t Thread::getOptions(void)
 	return thread_options;
 }
 
+/*******************************************************************************
+ *
+ * Set the CPU this thread should run on.
+ *
+ * NOTE: This does not move a running thread, it is the value that will be
+ *		used when the thread starts.  It is only supported on Linux.
+ *
+ * @param	cpu	the CPU number starting at 0, or CPU_ANY
+ *
+ ******************************************************************************/
+void Thread::setAffinity(int32_t cpu)
+{
+	thread_cpu = cpu;
+}
+
+/*******************************************************************************
+ *
+ * @returns	the CPU the thread will run on or CPU_ANY
+ *
+ ******************************************************************************/
+int32_t Thread::getAffinity(void)
+{
+	return thread_cpu;
+}
+
+/*******************************************************************************
+ *
+ * Lock all current and future memory of the process into RAM so real-time
+ * threads do not wait for pages to be read back in.  This should be called
+ * once at startup.
+ *
+ * @return	true if the memory was locked
+ *
+ ******************************************************************************/
+bool Thread::lockMemory(void)
+{
+#if defined (PTHREADS)
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+	{
+		printf("Thread::lockMemory - could not lock memory, error %d\n", errno);
+		return false;
+	}
+	return true;
+
+#elif defined(VXWORKS) || defined(_WRS_KERNEL)
+	return true; // memory is not paged
+
+#else
+	return false;
+
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Convert the name of a scheduling policy, as used in settings files, to
+ * thread options.
+ *
+ * @param	policy	"fifo", "rr", or anything else for the default scheduler
+ *
+ * @return	the options to add to a thread for the policy
+ *
+ ******************************************************************************/
+uint32_t Thread::getSchedulingOptions(std::string policy)
+{
+	if ((policy.compare("fifo") == 0) || (policy.compare("FIFO") == 0))
+	{
+		return OPTION_SCHED_FIFO;
+	}
+	else if ((policy.compare("rr") == 0) || (policy.compare("RR") == 0))
+	{
+		return OPTION_SCHED_RR;
+	}
+
+	return 0;
+}
+
+#if defined (PTHREADS)
+/*******************************************************************************
+ *
+ * @return	true if the thread should use a real-time scheduling policy
+ *
+ ******************************************************************************/
+bool Thread::isRealTime(void)
+{
+	return ((thread_options & (OPTION_SCHED_FIFO | OPTION_SCHED_RR)) != 0);
+}
+
+/*******************************************************************************
+ *
+ * @return	the real-time priority for the thread priority, limited to the
+ *			range of the policy
+ *
+ ******************************************************************************/
+int32_t Thread::getRealTimePriority(int policy)
+{
+	int32_t priority = RT_PRIORITY_DEFAULT - (RT_PRIORITY_STEP * (int32_t)thread_priority);
+
+	if (priority < sched_get_priority_min(policy))
+	{
+		priority = sched_get_priority_min(policy);
+	}
+	else if (priority > sched_get_priority_max(policy))
+	{
+		priority = sched_get_priority_max(policy);
+	}
+
+	return priority;
+}
+
+/*******************************************************************************
+ *
+ * Apply the thread priority to the running thread, as a real-time priority
+ * or as the thread's nice value.
+ *
+ ******************************************************************************/
+void Thread::applyPriority(void)
+{
+	if (isRealTime())
+	{
+		int policy = (thread_options & OPTION_SCHED_FIFO) ? SCHED_FIFO : SCHED_RR;
+		struct sched_param param;
+		param.sched_priority = getRealTimePriority(policy);
+
+		int result = pthread_setschedparam((pthread_t)thread_id, policy, &param);
+		if (result != 0)
+		{
+			printf("Thread::setPriority - could not set priority of %s, error %d\n",
+				thread_name.c_str(), result);
+		}
+	}
+#if defined (LINUX)
+	else if (thread_tid != 0)
+	{
+		// on Linux the nice value is per thread
+		if (setpriority(PRIO_PROCESS, thread_tid, (int)thread_priority) != 0)
+		{
+			printf("Thread::setPriority - could not set priority of %s, error %d\n",
+				thread_name.c_str(), errno);
+		}
+	}
+#endif
+}
+#endif
+
 /*******************************************************************************
  *
  * @return true if there is currently a thread running for this class
@@ -306,6 +550,26 @@ int64_t Thread::getId()
 	return thread_id;
 }
 
+/*******************************************************************************
+ *
+ * @return	the ID of the thread that calls this method, in the same form as
+ *			getId() so the two can be compared
+ *
+ ******************************************************************************/
+int64_t Thread::getCurrentId(void)
+{
+#if defined (PTHREADS)
+	return (int64_t)pthread_self();
+
+#elif defined(VXWORKS)
+	return (int64_t)taskIdSelf();
+
+#elif defined(_WINDOWS)
+	return (int64_t)GetCurrentThreadId();
+
+#endif
+}
+
 /*******************************************************************************
  *
  * @return the name of this thread.
@@ -382,6 +646,16 @@ DWORD WINAPI Thread::runHandle( LPVOID obj )
 int32_t Thread::runHandleImpl(void)
 {
 	is_running = true;
+
+#if defined (PTHREADS) && defined (LINUX)
+	// the nice value is set from inside the thread since it needs the
+	// kernel's ID for the thread
+	thread_tid = (int32_t)syscall(SYS_gettid);
+	if ((! isRealTime()) && (thread_priority != PRIORITY_DEFAULT))
+	{
+		applyPriority();
+	}
+#endif
 	try
 	{
 		initialize();
@@ -394,28 +668,35 @@ int32_t Thread::runHandleImpl(void)
 		{
 			printf("Thread::runHandle - unhandled exception during running of thread %s -- %s\n",
 				getName().c_str(), ex.what());
+			recordException("running", ex.what());
 		}
 		catch (...)
 		{
 			printf("Thread::runHandle - unhandled exception during running of thread %s\n",
 				getName().c_str());
+			recordException("running", "unknown exception");
 		}
 	}
 	catch (std::exception& ex)
 	{
 		printf("Thread::runHandle - unhandled exception during initialization of thread %s -- %s\n",
 			getName().c_str(), ex.what());
+		recordException("initialization", ex.what());
 	}
 	catch (...)
 	{
 		printf("Thread::runHandle - unhandled exception during initialization of thread %s\n",
 			getName().c_str());
+		recordException("initialization", "unknown exception");
 	}
 		
 	try
 	{
 		is_running = false;
 		thread_id = THREAD_ID_ERROR;
+#if defined (PTHREADS)
+		thread_tid = 0;
+#endif
 
 #if defined (PTHREADS)
 		// pthread_cancel((thread_t)thread_id); // is this something that should be done?
@@ -448,6 +729,27 @@ int32_t Thread::runHandleImpl(void)
 	return 0;
 }
 
+/*******************************************************************************
+ *
+ * Dump the flight recorder for an exception that ended this thread.
+ *
+ * @param	stage	what the thread was doing
+ * @param	what	the exception's message
+ *
+ ******************************************************************************/
+void Thread::recordException(const char *stage, const char *what)
+{
+	if (! FlightRecorder::isOpen())
+	{
+		return;
+	}
+
+	char reason[FlightRecorder::REASON_LENGTH];
+	snprintf(reason, sizeof(reason), "thread %s exception during %s -- %s",
+		thread_name.c_str(), stage, what);
+	FlightRecorder::trigger(FlightRecorder::RECORD_THREAD_EXCEPTION, reason, 0);
+}
+
 /*******************************************************************************
  *
  * @return a string representation of this thread
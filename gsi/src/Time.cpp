@@ -44,4 +44,30 @@ double Time::getTime(void)
 
 }
 
+/*******************************************************************************
+ *
+ * @return	seconds since an arbitrary point in the past, this clock is not
+ *			changed when the system time is set so it only moves forward
+ *
+ ******************************************************************************/
+double Time::getMonotonicTime(void)
+{
+#if defined (LINUX) || defined(_WRS_KERNEL)
+	struct timespec tp;
+	clock_gettime(CLOCK_MONOTONIC, &tp);
+	return( (double)tp.tv_sec + (double)((double)tp.tv_nsec*1e-9));
+
+#elif defined(VXWORKS)
+	return System::getTime();
+
+#elif defined(_WINDOWS)
+	LARGE_INTEGER count;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return (double)count.QuadPart / (double)frequency.QuadPart;
+
+#endif
+}
+
 } // namespace gsi
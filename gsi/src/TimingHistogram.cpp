@@ -0,0 +1,212 @@
+/*******************************************************************************
+ *
+ * File: TimingHistogram.cpp
+ *	Generic System Interface timing histogram
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include "gsi/TimingHistogram.h"
+
+namespace gsi
+{
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+TimingHistogram::TimingHistogram(void)
+{
+	reset();
+}
+
+/*******************************************************************************
+ *
+ * Count one duration, negative durations are counted as 0.
+ *
+ ******************************************************************************/
+void TimingHistogram::record(double seconds)
+{
+	uint32_t usec;
+	if (seconds <= 0.0)
+	{
+		usec = 0;
+	}
+	else if (seconds >= 4294.0)
+	{
+		usec = 0xFFFFFFFF;
+	}
+	else
+	{
+		usec = (uint32_t)(seconds * 1000000.0 + 0.5);
+	}
+
+	Atomic::fetchAdd(&buckets[bucketOf(usec)], 1);
+	Atomic::fetchAdd(&sample_count, 1);
+
+	uint32_t old = Atomic::loadAcquire(&min_usec);
+	while ((usec < old) && (! Atomic::compareExchange(&min_usec, old, usec)))
+	{
+		old = Atomic::loadAcquire(&min_usec);
+	}
+
+	old = Atomic::loadAcquire(&max_usec);
+	while ((usec > old) && (! Atomic::compareExchange(&max_usec, old, usec)))
+	{
+		old = Atomic::loadAcquire(&max_usec);
+	}
+}
+
+/*******************************************************************************
+ *
+ * Forget all recorded durations.
+ *
+ ******************************************************************************/
+void TimingHistogram::reset(void)
+{
+	for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+	{
+		Atomic::storeRelease(&buckets[i], 0);
+	}
+
+	Atomic::storeRelease(&sample_count, 0);
+	Atomic::storeRelease(&min_usec, 0xFFFFFFFF);
+	Atomic::storeRelease(&max_usec, 0);
+}
+
+/*******************************************************************************
+ *
+ * @return	the number of durations recorded since the last reset
+ *
+ ******************************************************************************/
+uint32_t TimingHistogram::getCount(void)
+{
+	return Atomic::loadAcquire(&sample_count);
+}
+
+/*******************************************************************************
+ *
+ * @return	the shortest duration in seconds, 0 if none have been recorded
+ *
+ ******************************************************************************/
+double TimingHistogram::getMin(void)
+{
+	uint32_t usec = Atomic::loadAcquire(&min_usec);
+	return (usec == 0xFFFFFFFF) ? 0.0 : usec / 1000000.0;
+}
+
+/*******************************************************************************
+ *
+ * @return	the longest duration in seconds, 0 if none have been recorded
+ *
+ ******************************************************************************/
+double TimingHistogram::getMax(void)
+{
+	return Atomic::loadAcquire(&max_usec) / 1000000.0;
+}
+
+/*******************************************************************************
+ *
+ * Find the duration that the percent of recorded durations are at or below.
+ *
+ * @param	percent	from 0.0 to 100.0, like 50.0 for the median or 99.9
+ *
+ * @return	the duration in seconds, 0 if none have been recorded
+ *
+ ******************************************************************************/
+double TimingHistogram::getPercentile(double percent)
+{
+	// count the buckets instead of using sample_count so the total matches
+	// the buckets even while durations are being recorded
+	uint32_t counts[BUCKET_COUNT];
+	uint64_t total = 0;
+	for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+	{
+		counts[i] = Atomic::loadAcquire(&buckets[i]);
+		total += counts[i];
+	}
+
+	if (total == 0)
+	{
+		return 0.0;
+	}
+
+	uint64_t target = (uint64_t)(percent / 100.0 * total + 0.5);
+	if (target < 1)
+	{
+		target = 1;
+	}
+
+	uint64_t below = 0;
+	uint32_t bucket = 0;
+	for (bucket = 0; bucket < BUCKET_COUNT - 1; bucket++)
+	{
+		below += counts[bucket];
+		if (below >= target)
+		{
+			break;
+		}
+	}
+
+	// the middle of a bucket can be outside of what was recorded
+	uint32_t usec = valueOf(bucket);
+	uint32_t min = Atomic::loadAcquire(&min_usec);
+	uint32_t max = Atomic::loadAcquire(&max_usec);
+	if (usec < min)
+	{
+		usec = min;
+	}
+	if (usec > max)
+	{
+		usec = max;
+	}
+
+	return usec / 1000000.0;
+}
+
+/*******************************************************************************
+ *
+ * @return	the bucket a duration in microseconds is counted in
+ *
+ ******************************************************************************/
+uint32_t TimingHistogram::bucketOf(uint32_t usec)
+{
+	if (usec < LINEAR_LIMIT)
+	{
+		return usec;
+	}
+
+	// find the power of two range, at least 6 since usec >= 64
+	uint32_t power = 31;
+	while ((usec & (1u << power)) == 0)
+	{
+		power--;
+	}
+
+	uint32_t sub = (usec >> (power - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+	return LINEAR_LIMIT + (power - 6) * SUB_BUCKET_COUNT + sub;
+}
+
+/*******************************************************************************
+ *
+ * @return	the duration in microseconds in the middle of a bucket
+ *
+ ******************************************************************************/
+uint32_t TimingHistogram::valueOf(uint32_t bucket)
+{
+	if (bucket < LINEAR_LIMIT)
+	{
+		return bucket;
+	}
+
+	uint32_t power = 6 + (bucket - LINEAR_LIMIT) / SUB_BUCKET_COUNT;
+	uint32_t sub = (bucket - LINEAR_LIMIT) % SUB_BUCKET_COUNT;
+	uint32_t width = 1u << (power - SUB_BUCKET_BITS);
+
+	return ((SUB_BUCKET_COUNT + sub) * width) + (width / 2);
+}
+
+} // namespace gsi
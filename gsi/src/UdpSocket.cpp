@@ -12,6 +12,10 @@
  ******************************************************************************/
 #include <gsi/UdpSocket.h>
 
+#if defined (PTHREADS)
+#include <fcntl.h>
+#endif
+
 // @TODO: create a network class to hold byte swap info
 
 bool do_byte_swap = (1 != ntohs(1));
@@ -210,19 +214,107 @@ int32_t UdpSocket::disconnect()
 int32_t UdpSocket::sendTo(const void *buffer, uint32_t bufferLen,
     const std::string &foreignAddress, uint16_t foreignPort)
 {
-	int32_t err = 0;
 	sockaddr_in destAddr;
 	fillAddr(foreignAddress, foreignPort, destAddr);
 
+	return sendTo(buffer, bufferLen, destAddr);
+}
+
+/*******************************************************************************
+ *
+ *  Send the given buffer as a UDP datagram to an address that has already
+ *  been resolved with fillAddr(), this avoids parsing the address string
+ *  on every send
+ *  @param buffer buffer to be written
+ *  @param bufferLen number of bytes to write
+ *  @param foreignAddr address and port to send to
+ *  @return 0 on success
+ *
+ *******************************************************************************/
+int32_t UdpSocket::sendTo(const void *buffer, uint32_t bufferLen,
+    const sockaddr_in &foreignAddr)
+{
+	int32_t err = 0;
+
 	// Write out the whole buffer as a single message.
 	if (sendto(socket_desc, (raw_type *) buffer, bufferLen, 0,
-	    (sockaddr *) &destAddr, sizeof(destAddr)) != (int) bufferLen)
+	    (sockaddr *) &foreignAddr, sizeof(foreignAddr)) != (int) bufferLen)
 	{
 		err = -1;
 	}
 	return (err);
 }
 
+/*******************************************************************************
+ *
+ *  Send each of the given buffers as a separate UDP datagram to an address
+ *  that has already been resolved with fillAddr(), using as few system
+ *  calls as possible
+ *  @param buffersA an array of countA buffers to be written
+ *  @param buffer_lengthsA the number of bytes to write from each buffer
+ *  @param countA the number of buffers, at most MAX_BATCH_COUNT are sent
+ *  @param foreign_addrA address and port to send to
+ *  @return number of datagrams sent and -1 for error
+ *
+ *******************************************************************************/
+int32_t UdpSocket::sendToBatch(const void **buffersA,
+    const uint32_t *buffer_lengthsA, uint32_t countA,
+    const sockaddr_in &foreign_addrA)
+{
+	if (countA > MAX_BATCH_COUNT)
+	{
+		countA = MAX_BATCH_COUNT;
+	}
+
+#if defined (LINUX)
+	struct mmsghdr msgs[MAX_BATCH_COUNT];
+	struct iovec iovecs[MAX_BATCH_COUNT];
+
+	memset(msgs, 0, sizeof(struct mmsghdr) * countA);
+	for (uint32_t i = 0; i < countA; i++)
+	{
+		iovecs[i].iov_base = (void *)buffersA[i];
+		iovecs[i].iov_len = buffer_lengthsA[i];
+		msgs[i].msg_hdr.msg_name = (void *)&foreign_addrA;
+		msgs[i].msg_hdr.msg_namelen = sizeof(foreign_addrA);
+		msgs[i].msg_hdr.msg_iov = &iovecs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	uint32_t sent = 0;
+	while (sent < countA)
+	{
+		// sendmmsg stops early if it is interrupted or the socket
+		// buffer fills, keep going with the rest
+		int rtn = sendmmsg(socket_desc, &msgs[sent], countA - sent, 0);
+		if (rtn <= 0)
+		{
+			if (sent == 0)
+			{
+				return (-1);
+			}
+			break;
+		}
+		sent += rtn;
+	}
+
+	return (sent);
+
+#else
+	// no batch send on this platform, fall back to one datagram at a time
+	for (uint32_t i = 0; i < countA; i++)
+	{
+		if (sendTo(buffersA[i], buffer_lengthsA[i], foreign_addrA) != 0)
+		{
+			return ((i == 0) ? -1 : (int32_t)i);
+		}
+	}
+
+	return (countA);
+
+#endif
+}
+
 /*******************************************************************************
  *
  *  Read read up to bufferLen bytes data from this socket.  The given buffer
@@ -254,8 +346,9 @@ int32_t UdpSocket::recvFrom(void *bufferA, uint32_t buffer_lengthA,
 	tv.tv_sec = timeoutA;
 	tv.tv_usec = 0;
 
-	// Wait until timeout or data received.
-	n = select(socket_desc, &fds, NULL, NULL, &tv);
+	// Wait until timeout or data received, select() wants one more than
+	// the highest descriptor in the set
+	n = select(socket_desc + 1, &fds, NULL, NULL, &tv);
 	if (n == 0)
 	{
 		err = -1;
@@ -360,6 +453,89 @@ int32_t UdpSocket::recvFrom(void *bufferA, uint32_t buffer_lengthA,
 	return rtn;
 }
 
+/*******************************************************************************
+ *
+ *  Read up to countA datagrams from this socket with as few system calls as
+ *  possible.  This blocks until at least one datagram is available (or the
+ *  socket timeout expires) then returns whatever else is already queued
+ *  without waiting for more.
+ *
+ *  @param buffersA an array of countA buffers to receive the datagrams
+ *  @param buffer_lengthA the size of each buffer, longer datagrams are
+ *         truncated
+ *  @param recv_lengthsA an array of countA values that will be set to the
+ *         number of bytes put in the buffer with the same index
+ *  @param countA the number of buffers, at most MAX_BATCH_COUNT are used
+ *  @return number of datagrams received and -1 for error
+ *
+ ******************************************************************************/
+int32_t UdpSocket::recvFromBatch(void **buffersA, uint32_t buffer_lengthA,
+    uint32_t *recv_lengthsA, uint32_t countA)
+{
+	if (countA > MAX_BATCH_COUNT)
+	{
+		countA = MAX_BATCH_COUNT;
+	}
+
+	if (countA == 0)
+	{
+		return (0);
+	}
+
+#if defined (LINUX)
+	struct mmsghdr msgs[MAX_BATCH_COUNT];
+	struct iovec iovecs[MAX_BATCH_COUNT];
+
+	memset(msgs, 0, sizeof(struct mmsghdr) * countA);
+	for (uint32_t i = 0; i < countA; i++)
+	{
+		iovecs[i].iov_base = buffersA[i];
+		iovecs[i].iov_len = buffer_lengthA;
+		msgs[i].msg_hdr.msg_iov = &iovecs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	int rtn = recvmmsg(socket_desc, msgs, countA, MSG_WAITFORONE, NULL);
+	if (rtn < 0)
+	{
+		int err = errno;
+		switch (err)
+		{
+			case 0:
+			case EAGAIN:
+			case ETIMEDOUT:
+			case EINTR:
+				return (-1);
+			default:
+				fprintf(stderr, "Socket Error : %s\n", strerror(err));
+				return (-1);
+		}
+	}
+
+	for (int i = 0; i < rtn; i++)
+	{
+		recv_lengthsA[i] = msgs[i].msg_len;
+	}
+
+	return (rtn);
+
+#else
+	// no batch receive on this platform, fall back to a single datagram
+	std::string source_address;
+	uint16_t source_port;
+	int32_t rtn = recvFrom(buffersA[0], buffer_lengthA, source_address,
+		source_port);
+	if (rtn < 0)
+	{
+		return (-1);
+	}
+
+	recv_lengthsA[0] = rtn;
+	return (1);
+
+#endif
+}
+
 /*******************************************************************************
  *
  *   Set the multicast TTL
@@ -425,6 +601,59 @@ int32_t UdpSocket::leaveGroup(const std::string &multicastGroup)
 	return (err);
 }
 
+/*******************************************************************************
+ *
+ *  Make receives return right away with an error of EAGAIN instead of
+ *  waiting when no datagram is queued, as needed when the socket is
+ *  serviced by a SocketReactor
+ *  @param non_blockingA true to stop waiting, false to wait again
+ *  @return 0 on success, -1 on error
+ *
+ *******************************************************************************/
+int32_t UdpSocket::setNonBlocking(bool non_blockingA)
+{
+	int32_t err = 0;
+#ifdef WIN32
+	u_long mode = non_blockingA ? 1 : 0;
+	if (ioctlsocket(socket_desc, FIONBIO, &mode) != 0)
+	{
+		err = -1;
+	}
+#elif defined(VXWORKS) || defined(_WRS_KERNEL)
+	int mode = non_blockingA ? 1 : 0;
+	if (ioctl(socket_desc, FIONBIO, (int)&mode) != 0)
+	{
+		err = -1;
+	}
+#else
+	int flags = fcntl(socket_desc, F_GETFL, 0);
+	if (flags < 0)
+	{
+		err = -1;
+	}
+	else
+	{
+		flags = non_blockingA ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+		if (fcntl(socket_desc, F_SETFL, flags) < 0)
+		{
+			err = -1;
+		}
+	}
+#endif
+	return (err);
+}
+
+/*******************************************************************************
+ *
+ *  @return the descriptor of this socket, so it can be waited on along
+ *          with other descriptors
+ *
+ *******************************************************************************/
+int32_t UdpSocket::getDescriptor()
+{
+	return (socket_desc);
+}
+
 /*******************************************************************************
  *
  * Function to fill in address structure given an address and port
@@ -0,0 +1,168 @@
+/*******************************************************************************
+ *
+ * File: TelemetryColumn.h
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace gsu
+{
+
+/*******************************************************************************
+ *
+ * The layout of a telemetry file, written by TelemetryRecorder and read by
+ * TelemetryReader.  All numbers are little endian.
+ *
+ *	header		MAGIC, uint32 VERSION, uint32 0, double time and double
+ *				monotonic time when recording started
+ *	blocks		one parameter's samples each, see TelemetryColumnWriter
+ *	footer		a block header with ID INDEX_ID and type 0 whose sample
+ *				count is the number of blocks and whose values are an index
+ *				entry for each block
+ *	trailer		uint64 offset of the footer and INDEX_MAGIC
+ *
+ * Before a parameter's first samples there is a block with no samples whose
+ * values are the parameter's name.  An index entry is uint16 ID, uint32
+ * sample count, int64 first and last time, and uint64 offset of the block,
+ * so a reader finds the blocks of one parameter, and the blocks in a time
+ * range, without reading any other block.  A file that was not closed has
+ * no footer, its blocks can still be found by walking them from the header
+ * up to the first one that is cut off or is the start of the footer.
+ *
+ ******************************************************************************/
+class TelemetryFormat
+{
+	public:
+		static const uint32_t VERSION = 1;
+		static const uint32_t HEADER_LENGTH = 32;
+		static const uint32_t TRAILER_LENGTH = 16;
+		static const uint32_t BLOCK_HEADER_LENGTH = 24;
+		static const uint32_t INDEX_ENTRY_LENGTH = 30;
+		static const uint16_t INDEX_ID = 0xFFFF;
+
+		static const char MAGIC[8];
+		static const char INDEX_MAGIC[8];
+
+		static uint32_t getFixedLength(uint8_t type);
+
+		static void put16(uint8_t *dest, uint16_t v);
+		static void put32(uint8_t *dest, uint32_t v);
+		static void put64(uint8_t *dest, uint64_t v);
+		static uint16_t get16(const uint8_t *src);
+		static uint32_t get32(const uint8_t *src);
+		static uint64_t get64(const uint8_t *src);
+};
+
+/*******************************************************************************
+ *
+ * Collects the samples of one parameter and makes them into a block.
+ *
+ * A block is a header, uint16 ID, uint8 type, uint8 0, uint32 sample count,
+ * int64 first time, uint32 bytes of times, uint32 bytes of values, followed
+ * by the two columns.  Times are microseconds.
+ *
+ * The time column has the delta of the delta of each time after the first,
+ * '0' for 0, then '10' and 7 bits, '110' and 9 bits, '1110' and 12 bits, or
+ * '1111' and 64 bits.  Samples that come at a steady rate take one bit.
+ *
+ * Numbers (every type but strings and BLOBs) are the value's network bytes
+ * as a 32 bit number.  The value column has the first one in 32 bits, then
+ * each one XORed with the one before it, as in Gorilla: '0' if it is the
+ * same, '10' and the meaningful bits if they fit in the previous window of
+ * meaningful bits, or '11', 5 bits of leading zeros, 5 bits of meaningful
+ * bit count - 1, and the meaningful bits.  A float that does not change
+ * takes one bit and one that changes a little takes a few.  Strings and
+ * BLOBs are 16 bits of length and the bytes.
+ *
+ ******************************************************************************/
+class TelemetryColumnWriter
+{
+	public:
+		TelemetryColumnWriter(uint16_t id, uint8_t type);
+
+		void add(int64_t time, const uint8_t *bytes, uint16_t length);
+
+		uint16_t getId(void)			{ return column_id; }
+		uint8_t getType(void)			{ return column_type; }
+		uint32_t getCount(void)			{ return sample_count; }
+		int64_t getFirstTime(void)		{ return first_time; }
+		int64_t getLastTime(void)		{ return last_time; }
+		uint32_t getBlockLength(void);
+
+		void getBlock(std::vector<uint8_t> &block);
+		void reset(void);
+
+	private:
+		void putBits(std::vector<uint8_t> &bits, uint32_t &bit_count,
+			uint64_t v, uint32_t n);
+
+		uint16_t column_id;
+		uint8_t column_type;
+
+		uint32_t sample_count;
+		int64_t first_time;
+		int64_t last_time;
+		int64_t last_delta;
+
+		uint32_t last_value;
+		uint32_t last_leading;
+		uint32_t last_meaningful;
+
+		std::vector<uint8_t> time_bits;
+		uint32_t time_bit_count;
+		std::vector<uint8_t> value_bits;
+		uint32_t value_bit_count;
+};
+
+/*******************************************************************************
+ *
+ * Gets the samples out of a block made by TelemetryColumnWriter.
+ *
+ ******************************************************************************/
+class TelemetryColumnReader
+{
+	public:
+		TelemetryColumnReader(const uint8_t *block, uint32_t length);
+
+		bool isValid(void)				{ return block_valid; }
+		uint16_t getId(void)			{ return column_id; }
+		uint8_t getType(void)			{ return column_type; }
+		uint32_t getCount(void)			{ return sample_count; }
+
+		bool next(int64_t *time, uint8_t *bytes, uint16_t *length);
+
+	private:
+		bool getBits(const uint8_t *bits, uint32_t bit_length, uint32_t &bit_pos,
+			uint32_t n, uint64_t *v);
+
+		bool block_valid;
+		uint16_t column_id;
+		uint8_t column_type;
+		uint32_t sample_count;
+		uint32_t sample_index;
+
+		const uint8_t *time_data;
+		uint32_t time_bit_length;
+		uint32_t time_pos;
+		int64_t last_time;
+		int64_t last_delta;
+
+		const uint8_t *value_data;
+		uint32_t value_bit_length;
+		uint32_t value_pos;
+		uint32_t last_value;
+		uint32_t last_leading;
+		uint32_t last_meaningful;
+};
+
+} // namespace gsu
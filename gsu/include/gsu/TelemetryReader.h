@@ -0,0 +1,140 @@
+/*******************************************************************************
+ *
+ * File: TelemetryReader.h
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "gsu/TelemetryColumn.h"
+#include "gsu/UdpValueTableParameter.h"
+
+namespace gsu
+{
+
+/*******************************************************************************
+ *
+ * This class reads a file written by TelemetryRecorder.
+ *
+ * The file is mapped into memory, or read into memory on platforms without
+ * mmap.  open() reads only the index at the end of the file and the name
+ * blocks, scanning a parameter then decodes only that parameter's blocks
+ * that overlap the times asked for, the pages of every other block are
+ * never touched.  A file whose recorder did not close it has no index, its
+ * blocks are found by walking them instead, and a block that was cut off
+ * is left out.
+ *
+ * Times are seconds since the recorder was opened.
+ *
+ ******************************************************************************/
+class TelemetryReader
+{
+	public:
+		TelemetryReader(void);
+		~TelemetryReader(void);
+
+		bool open(const char *file_name);
+		void close(void);
+
+		double getStartTime(void)		{ return start_time; }
+		bool hasIndex(void)				{ return file_indexed; }
+
+		void getIds(std::vector<uint16_t> &ids);
+		uint16_t getId(std::string name);
+		std::string getName(uint16_t id);
+		UdpValueTableParameter::DataType getType(uint16_t id);
+		uint32_t getSampleCount(uint16_t id);
+
+		template <class T> uint32_t scan(uint16_t id, std::vector<double> &times,
+			std::vector<T> &values, double start = 0.0, double end = 1.0e300);
+		uint32_t scanBytes(uint16_t id, std::vector<double> &times,
+			std::vector<std::string> &values, double start = 0.0, double end = 1.0e300);
+
+	private:
+		// a block of samples in the file, last_time is the largest time
+		// when it is not known
+		typedef struct
+		{
+			uint64_t offset;
+			uint32_t count;
+			int64_t first_time;
+			int64_t last_time;
+		} Block;
+
+		typedef struct
+		{
+			bool known;
+			uint8_t type;
+			std::string name;
+			uint32_t sample_count;
+			std::vector<Block> blocks;
+		} Parameter;
+
+		// mapping or copying a file is not copied
+		TelemetryReader(const TelemetryReader &);
+		TelemetryReader &operator=(const TelemetryReader &);
+
+		bool readIndex(void);
+		void walkBlocks(void);
+		void addBlock(uint16_t id, uint32_t count, int64_t first_time,
+			int64_t last_time, uint64_t offset);
+		Parameter *getParameter(uint16_t id);
+		uint32_t scanBlocks(uint16_t id, double start, double end,
+			std::vector<double> &times, std::vector<std::string> *byte_values,
+			std::vector<uint8_t> *number_bytes);
+
+		const uint8_t *file_data;
+		uint64_t file_length;
+		bool file_indexed;
+		double start_time;
+
+		// indexed by ID
+		std::vector<Parameter> parameters;
+};
+
+/*******************************************************************************
+ *
+ * Get the samples of a numeric parameter that are between two times.
+ *
+ * @param	times	the time of each sample is added to the end of this
+ * @param	values	the value of each sample is added to the end of this
+ *
+ * @return	the number of samples added, 0 if the parameter is not of type T
+ *
+ ******************************************************************************/
+template <class T>
+uint32_t TelemetryReader::scan(uint16_t id, std::vector<double> &times,
+	std::vector<T> &values, double start, double end)
+{
+	if (getType(id) != UdpValueTableParameter::typeOf<T>(T()))
+	{
+		printf("TelemetryReader::scan: type mismatch, for parameter %d\n", id);
+		return 0;
+	}
+
+	// the values come back in network byte order, one after the other
+	std::vector<uint8_t> bytes;
+	uint32_t count = scanBlocks(id, start, end, times, NULL, &bytes);
+	uint32_t length = TelemetryFormat::getFixedLength(getType(id));
+
+	values.reserve(values.size() + count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		values.push_back(UdpValueTableParameter::fromNetBytes<T>(&bytes[i * length]));
+	}
+
+	return count;
+}
+
+} // namespace gsu
@@ -0,0 +1,144 @@
+/*******************************************************************************
+ *
+ * File: TelemetryRecorder.h
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "gsi/Atomic.h"
+#include "gsi/Mutex.h"
+#include "gsi/Thread.h"
+
+#include "gsu/TelemetryColumn.h"
+#include "gsu/UdpValueTableParameter.h"
+
+namespace gsu
+{
+
+class UdpValueTable;
+class TelemetryWriter;
+
+/*******************************************************************************
+ *
+ * This class records every value a UdpValueTable sets, sends, or receives
+ * into a telemetry file, one column of samples per parameter.
+ *
+ * record() only copies the sample, with the time it was taken, into a ring
+ * that belongs to the calling thread, the way RobotLogger queues lines.  It
+ * takes no lock and does no I/O, only the first sample from a thread
+ * allocates the thread's ring.  A low priority writer thread started by
+ * open() takes the samples from the rings in time order and compresses each
+ * parameter's samples in a TelemetryColumnWriter.  When a column has
+ * CHUNK_SAMPLES samples or CHUNK_BYTES bytes it is written to the file as a
+ * block and started over, so the file is a run of blocks that each hold one
+ * parameter for a span of time.  The first time a parameter is seen a block
+ * with its name is written.  close() writes what is left and an index of
+ * the blocks, see TelemetryFormat, so TelemetryReader can read one
+ * parameter by reading only its blocks.
+ *
+ * Times are microseconds of gsi::Time::getMonotonicTime() since open().
+ *
+ * When a thread's ring is full, or more than MAX_THREADS threads record,
+ * samples are dropped and counted by getDropCount().  If the program dies
+ * the samples that were not written in a block yet are lost, the rest can
+ * still be read.  The recorder must not be deleted while a table it was
+ * opened with is still used.
+ *
+ ******************************************************************************/
+class TelemetryRecorder
+{
+	friend class TelemetryWriter;
+
+	public:
+		static const uint32_t CHUNK_SAMPLES = 4096;
+		static const uint32_t CHUNK_BYTES = 16384;
+		static const uint32_t RING_SIZE = 2048;		// samples per thread, a power of 2
+		static const uint32_t MAX_THREADS = 32;
+		static const double WRITE_PERIOD;
+
+		TelemetryRecorder(void);
+		~TelemetryRecorder(void);
+
+		bool open(const char *file_name, UdpValueTable *table = NULL,
+			gsi::Thread::ThreadPriority priority = gsi::Thread::PRIORITY_LOWEST);
+		void close(void);
+		bool isOpen(void)					{ return recorder_file != NULL; }
+
+		void record(uint16_t id, uint8_t type, const uint8_t *bytes,
+			uint16_t length);
+
+		uint32_t getDropCount(void);
+
+	private:
+		typedef struct
+		{
+			int64_t time;
+			uint16_t id;
+			uint16_t length;
+			uint8_t type;
+			uint8_t bytes[UdpValueTableParameter::VALUE_CAPACITY];
+		} Sample;
+
+		// written by one thread, read by the writer
+		typedef struct
+		{
+			volatile uint32_t head;
+			char pad[gsi::Atomic::CACHE_LINE_SIZE - sizeof(uint32_t)];
+			volatile uint32_t tail;
+			Sample samples[RING_SIZE];
+		} SampleRing;
+
+		SampleRing *getRing(void);
+		uint32_t drain(void);
+		void freeRings(void);
+
+		void writeSample(const Sample *sample);
+		TelemetryColumnWriter *getColumn(uint16_t id, uint8_t type);
+		void writeName(uint16_t id, uint8_t type, const std::string &name);
+		void writeColumn(TelemetryColumnWriter *column);
+		void writeBlock(uint16_t id, uint32_t count, int64_t first_time,
+			int64_t last_time);
+
+		FILE *recorder_file;
+		UdpValueTable *recorder_table;
+		double start_time;
+		uint64_t file_offset;
+
+		// record() only queues samples while is_recording is set, close()
+		// waits for active_count to be 0 before it frees the rings
+		volatile uint32_t is_recording;
+		volatile uint32_t active_count;
+		volatile uint32_t drop_count;
+
+		SampleRing *rings[MAX_THREADS];
+		int64_t ring_owners[MAX_THREADS];
+		volatile uint32_t ring_ready[MAX_THREADS];
+		volatile uint32_t ring_count;
+
+		TelemetryWriter *writer;
+
+		// only used by the writer thread, and by close() once it stopped
+		// indexed by ID, NULL for parameters not recorded yet
+		std::vector<TelemetryColumnWriter *> columns;
+
+		std::vector<uint8_t> block_buffer;
+		std::vector<uint8_t> index_buffer;
+		uint32_t block_count;
+
+		// held by open() and close()
+		gsi::Mutex recorder_lock;
+};
+
+} // namespace gsu
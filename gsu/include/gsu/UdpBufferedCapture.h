@@ -0,0 +1,74 @@
+/*******************************************************************************
+ *
+ * File: UdpBufferedCapture.h
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "gsi/Mutex.h"
+
+namespace gsi
+{
+
+/*******************************************************************************
+ *
+ * A file of the packets a UdpBufferedReceiver took from its socket, each
+ * exactly as it came off the network, so they can be fed back through the
+ * same decoding by UdpBufferedReceiver::injectPacket().
+ *
+ * The file is MAGIC, uint32 VERSION, uint32 0, and the double time when the
+ * capture started, followed by a record for each packet: the double seconds
+ * since the capture started (from Time::getMonotonicTime()), uint32 length,
+ * and the packet's bytes.  Numbers are little endian.  A capture that was
+ * cut off ends at the last whole record that was flushed.
+ *
+ * write() may be called by one thread while another opens and closes the
+ * capture.
+ *
+ ******************************************************************************/
+class UdpBufferedCapture
+{
+	public:
+		static const uint32_t VERSION = 1;
+		static const uint32_t HEADER_LENGTH = 24;
+		static const uint32_t RECORD_HEADER_LENGTH = 12;
+
+		static const char MAGIC[8];
+
+		UdpBufferedCapture(void);
+		~UdpBufferedCapture(void);
+
+		bool openWrite(const char *file_name);
+		bool openRead(const char *file_name);
+		void close(void);
+		bool isOpen(void)				{ return capture_file != NULL; }
+
+		double getStartTime(void)		{ return start_time; }
+
+		void write(double monotonic_time, const void *packet, uint32_t length);
+		void flush(void);
+		bool read(double *time, void *packet, uint32_t *length, uint32_t max_length);
+
+	private:
+		// the file is not copied
+		UdpBufferedCapture(const UdpBufferedCapture &);
+		UdpBufferedCapture &operator=(const UdpBufferedCapture &);
+
+		FILE *capture_file;
+		bool capture_writing;
+		double start_time;
+		double start_monotonic;
+
+		Mutex capture_lock;
+};
+
+} // namespace gsi
@@ -23,6 +23,19 @@ static const uint16_t UDP_BUFFERED_HEADER_SIZE = 8;
 // just change to a new sync pattern
 static const uint16_t UDP_BUFFERED_SYNC_0 =	0x7AC0;
 
+// A packet with this sync pattern is a coalesced frame, its data is a
+// sequence of records that are each a complete SYNC_0 packet (header and
+// data, in network byte order) padded to UDP_BUFFERED_RECORD_ALIGN bytes.
+// The type of the frame is the number of records it holds.
+static const uint16_t UDP_BUFFERED_SYNC_1 =	0x7AC1;
+static const uint16_t UDP_BUFFERED_RECORD_ALIGN = 4;
+
+// The largest frame that fits in one Ethernet frame without IP
+// fragmentation (1500 - 20 byte IP header - 8 byte UDP header)
+static const uint16_t UDP_BUFFERED_MAX_DATAGRAM = 1472;
+static const uint16_t UDP_BUFFERED_MAX_FRAME_LENGTH =
+	UDP_BUFFERED_MAX_DATAGRAM - UDP_BUFFERED_HEADER_SIZE;
+
 struct UdpBufferedPacket
 {
 	uint16_t sync;
@@ -16,54 +16,124 @@
 
 #include <string>
 
+#include "gsi/Mutex.h"
 #include "gsi/UdpSocket.h"
 #include "gsi/Thread.h"
-#include "gsi/Mutex.h"
+#include "gsi/SocketReactor.h"
 
 #include "gsu/UdpBufferedDefs.h"
+#include "gsu/UdpBufferedRing.h"
+#include "gsu/UdpBufferedCapture.h"
 
 namespace gsi
 {
 
+class UdpBufferedCaptureWriter;
+
 /**********************************************************************
+ *
+ * The receiver either runs its own thread that blocks on the socket, when
+ * start() is called, or is serviced by a SocketReactor that is shared with
+ * other sockets, when attach() is called.  Only one of them should be used.
+ *
+ * startCapture() saves every packet taken from the socket, as it was
+ * received and with the time it was received, into a UdpBufferedCapture
+ * file until stopCapture().  The receive thread only copies the packets
+ * into a buffer of CAPTURE_SLOT_COUNT packets, a low priority thread writes
+ * and flushes the file, so a capture never makes the receiver (or a shared
+ * SocketReactor) wait on the disk.  Packets that arrive while the buffer is
+ * full are left out of the capture and counted by getCaptureDropCount().
+ *
+ * A receiver opened with openReplay() instead has no socket and is neither
+ * started nor attached.  injectPacket() puts a packet into its buffer as
+ * if it had been received, so a capture can be replayed through the same
+ * decoding and buffering as live traffic, with the injecting thread as the
+ * buffer's only producer.
  *
  **********************************************************************/
-class UdpBufferedReceiver : public Thread
+class UdpBufferedReceiver : public Thread, public SocketReactorHandler
 {
+	friend class UdpBufferedCaptureWriter;
+
 	public:
+		static const uint32_t CAPTURE_SLOT_COUNT = 1024;
+		static const double CAPTURE_WRITE_PERIOD;
+
 		UdpBufferedReceiver(std::string name, std::string src_host,
 			uint16_t src_port, uint16_t max_length, uint16_t max_count,
 			double interval, int32_t priority);
 		~UdpBufferedReceiver();
 		
 		void run(void);
+
+		bool attach(SocketReactor *reactor);
+		void detach(void);
+		void socketReadable(UdpSocket *socket);
 		
-		bool getPacket(uint16_t *type, uint16_t *flags, uint16_t *data_length, char *data);
+		bool getPacket(uint16_t *type, uint16_t *flags, uint16_t *data_length, char *data,
+			uint16_t *sync = NULL);
+
+		bool startCapture(const char *file_name);
+		void stopCapture(void);
+		uint32_t getCaptureDropCount(void);
+
+		bool openReplay(void);
+		bool injectPacket(const void *packet, uint32_t length);
+
+		uint32_t getDropCount(void);
 
 	protected:
 		void doPeriodic();
 
 	private:
+		// the most packets taken from the socket with one system call
+		static const uint32_t RECEIVE_BATCH_COUNT = 16;
+
 		void init();
-		void receivePacket(void);
+		bool initBuffer(void);
+		int32_t receivePacket(void);
+		bool decodePacket(UdpBufferedPacket *pkt, int32_t length);
+
+		// each capture slot is the double receive time, the uint32 length,
+		// and the packet
+		static const uint32_t CAPTURE_HEADER_SIZE = 16;
+
+		void queueCapture(double time, uint8_t **packets, const uint32_t *lengths,
+			int32_t count);
+		uint32_t drainCapture(void);
 
 		UdpSocket *src_socket;
+		SocketReactor *src_reactor;
 		
 		std::string src_host;
 		int32_t src_port;
 		
 		uint16_t max_packet_size;
 		uint16_t max_packet_count;
-		uint16_t head_idx;
-		uint16_t tail_idx;
 		
 		double pkt_interval;
 		
-		uint8_t *buffer;
+		// filled by run(), emptied by getPacket()
+		UdpBufferedRing *buffer;
+		volatile uint32_t drop_count;
 		
+		// scratch space used to drain the socket when the buffer is full
 		UdpBufferedPacket *receive_packet;
-		
-		Mutex buffer_lock;
+
+		// filled by the receive thread, emptied by capture_writer, both only
+		// while is_capturing is set
+		UdpBufferedCapture capture;
+		UdpBufferedRing *capture_ring;
+		UdpBufferedCaptureWriter *capture_writer;
+		volatile uint32_t is_capturing;
+		volatile uint32_t capture_active;
+		volatile uint32_t capture_drop_count;
+
+		// held by startCapture() and stopCapture()
+		Mutex capture_lock;
+
+		// set by openReplay(), the buffer is only filled by injectPacket()
+		bool is_replay;
 };
 
 } // namespace gsi
@@ -0,0 +1,73 @@
+/*******************************************************************************
+ *
+ * File: UdpBufferedRing.h
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <stdint.h>
+
+#include "gsi/Atomic.h"
+
+namespace gsi
+{
+
+/*******************************************************************************
+ *
+ * A single-producer/single-consumer ring of fixed size packet slots that
+ * does not use a Mutex.
+ *
+ * Exactly one thread may call the producer methods (reserve/commit) and
+ * exactly one thread may call the consumer methods (peek/release).  The
+ * producer fills a slot returned by reserve() then makes it visible to the
+ * consumer with commit(), the consumer reads the slot returned by peek()
+ * then hands it back to the producer with release().
+ *
+ * When the ring is full reserve() returns NULL, the producer is expected to
+ * drop the newest data since it cannot advance the consumer's index.
+ *
+ ******************************************************************************/
+class UdpBufferedRing
+{
+	public:
+		UdpBufferedRing(uint32_t slot_size, uint32_t slot_count);
+		~UdpBufferedRing();
+
+		bool isValid(void);
+		uint32_t getSlotSize(void);
+		uint32_t getSlotCount(void);
+		uint32_t getCount(void);
+
+		// producer methods
+		uint8_t *reserve(void);
+		uint32_t reserve(uint8_t **slots, uint32_t max_count);
+		void commit(uint32_t count = 1);
+
+		// consumer methods
+		uint8_t *peek(void);
+		uint32_t peek(uint8_t **slots, uint32_t max_count);
+		void release(uint32_t count = 1);
+
+	private:
+		uint8_t *ring_buffer;
+		uint32_t ring_slot_size;
+		uint32_t ring_slot_count;
+		uint32_t ring_slot_mask;
+
+		// the indexes run freely and wrap at 2^32, the slot is the index
+		// masked by the slot count, they are kept on separate cache lines
+		// so the producer and consumer do not invalidate each other's cache
+		char pad0[Atomic::CACHE_LINE_SIZE];
+		volatile uint32_t head_idx;	// written by the producer only
+		char pad1[Atomic::CACHE_LINE_SIZE - sizeof(uint32_t)];
+		volatile uint32_t tail_idx;	// written by the consumer only
+		char pad2[Atomic::CACHE_LINE_SIZE - sizeof(uint32_t)];
+};
+
+} // namespace gsi
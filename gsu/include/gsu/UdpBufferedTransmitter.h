@@ -13,19 +13,23 @@
 
 #include <string>
 
-#include "gsi/Thread.h"
+#include "gsi/PeriodicThread.h"
 #include "gsi/Mutex.h"
 #include "gsi/UdpSocket.h"
 
 #include "gsu/UdpBufferedDefs.h"
+#include "gsu/UdpBufferedRing.h"
 
 namespace gsi
 {
 
 /**********************************************************************
+ *
+ * Sends the packets put in its buffer once every period.  It can be
+ * started as its own thread or added to a PeriodicExecutive.
  *
  **********************************************************************/
-class UdpBufferedTransmitter : public Thread
+class UdpBufferedTransmitter : public PeriodicThread
 {
 	public:
 		UdpBufferedTransmitter(std::string name, std::string dest_host,
@@ -33,10 +37,16 @@ class UdpBufferedTransmitter : public Thread
 			double period, int32_t priority) ;
 		~UdpBufferedTransmitter();
 		
-		void run(void);
 		void init();
 		void putPacket(uint16_t data_type, uint16_t data_flags, 
-			uint16_t data_length, const char *data);
+			uint16_t data_length, const char *data,
+			uint16_t data_sync = UDP_BUFFERED_SYNC_0);
+
+		char *reservePacket(uint16_t data_type, uint16_t data_flags,
+			uint16_t data_length, uint16_t data_sync = UDP_BUFFERED_SYNC_0);
+		void commitPacket(void);
+
+		uint32_t getDropCount(void);
 
 	protected:
 		void doPeriodic();
@@ -46,17 +56,18 @@ class UdpBufferedTransmitter : public Thread
 		
 		std::string dest_host;
 		int32_t dest_port;
+		sockaddr_in dest_addr;
 		UdpSocket *dest_socket;
 		
 		uint16_t max_packet_size;
 		uint16_t max_packet_count;
-		uint16_t head_idx;
-		uint16_t tail_idx;
-		
-		uint8_t *buffer;
 		
-		UdpBufferedPacket *send_packet;
+		// packets are held in network byte order so they can be sent
+		// straight from the buffer
+		UdpBufferedRing *buffer;
+		volatile uint32_t drop_count;
 		
+		// only one thread at a time may add to the buffer
 		Mutex buffer_lock;
 };
 
@@ -16,6 +16,10 @@
 #include <vector>
 
 #include "gsi/PeriodicThread.h"
+#include "gsi/FlightRecorder.h"
+#include "gsi/Mutex.h"
+#include "gsi/Semaphore.h"
+#include "gsi/SeqLock.h"
 
 #include "gsu/UdpBufferedTransmitter.h"
 #include "gsu/UdpBufferedReceiver.h"
@@ -26,96 +30,446 @@
 namespace gsu
 {
 
+template <class T> class ParamHandle;
+class TelemetryRecorder;
+class UdpValueTable;
+class UdpValueTableSchema;
+class UdpValueTableBench;
+
+/*******************************************************************************
+ *
+ * Implemented by classes that want to be told when a UdpValueTable
+ * receives a new value for a parameter they subscribed to.
+ *
+ * valueChanged() is called from the table's thread, it should be short
+ * and must not subscribe or unsubscribe.
+ *
+ ******************************************************************************/
+class UdpValueTableListener
+{
+	public:
+		virtual ~UdpValueTableListener() {}
+		virtual void valueChanged(UdpValueTable *table, uint16_t id) = 0;
+};
+
 /**********************************************************************
+ *
+ * Every parameter is interned to a 16-bit ID the first time its name is
+ * seen, the ID is an index into a dense list so access by ID or through
+ * a ParamHandle never compares strings.
+ *
+ * When the use_ids XML attribute is set, updates carry the sender's ID
+ * instead of the 16 byte name.  Before the first update for a parameter,
+ * and again every REGISTER_PERIOD, the sender sends a FLAG_REGISTER
+ * record that binds its ID to the name so the receiver can map the
+ * sender's IDs to its own.
+ *
+ * When the delta XML attribute is set, put() only marks a parameter
+ * dirty if its value changed and doPeriodic() sends the dirty parameters
+ * once per period.  Every keyframe_period seconds (default
+ * DEFAULT_KEYFRAME_PERIOD, 0 to disable) every parameter this side has
+ * sent is sent again so late joiners and lost updates catch up, values
+ * that only came from the remote table are not sent back.
+ *
+ * When the capture XML attribute is set every packet the table receives is
+ * saved to the file it names, see UdpBufferedReceiver::startCapture().
+ * UdpValueTableReplay feeds such a file back into a table through
+ * replayPacket(), which takes the same path as packets from the socket.
+ * The table replayed into must set the replay XML attribute, then its
+ * receiver never opens a socket and packets only come from replayPacket().
+ *
+ * The priority, sched ("fifo" or "rr"), and cpu XML attributes set the
+ * scheduling of the table's thread and its receiver and transmitter.
+ *
+ * When the reactor XML attribute is set the table's receiver does not get
+ * a thread of its own, it is serviced by the SocketReactor returned by
+ * getReactor() that is shared by every table that sets it.  The reactor
+ * gets the scheduling of the first table that uses it.
+ *
+ * Any number of threads may put and get values.  Parameters are kept in a
+ * fixed size list of MAX_PARAMETERS that is filled in order and never
+ * reallocated, so access by ID or through a ParamHandle only loads the
+ * published parameter count and uses the parameter's sequence lock, reads
+ * of numeric values never wait for a Mutex.  Adding a parameter and
+ * looking up a name take parameter_lock.  Adding also holds
+ * subscription_lock, so subscriptions made by name before the parameter
+ * existed are moved to it before its ID is published.
+ *
+ * A group of parameters of one type, like a set of gains, can be defined
+ * with defineGroup().  putGroup() sets every member and sends them in a
+ * single frame flagged FLAG_GROUP, the receiving table applies the whole
+ * frame under group_lock.  getGroup() copies every member under the same
+ * lock, so it never sees part of a group update.  For this to hold on both
+ * ends, update group members only through putGroup().
+ *
+ * Listeners and semaphores can subscribe to a parameter by name or ID,
+ * when doPeriodic() applies a received update that changes the value each
+ * listener's valueChanged() is called and each semaphore is given.  A
+ * parameter can be subscribed to by name before it exists.
+ *
+ * When the gsi::FlightRecorder is open, or a TelemetryRecorder was opened
+ * with the table, each added parameter, each put that changes or sends a
+ * value, and each received value is recorded there by ID.
  *
  **********************************************************************/
 class UdpValueTable : public gsi::PeriodicThread
 {
 // TODO: Add an initial values file / parser
-// TODO: Add a subscribe/notify interface
+
+	template <class T> friend class ParamHandle;
+	friend class UdpValueTableSchema;
+	friend class UdpValueTableBench;	// Bench/src/TableBench.cpp times buildFrame()
 
 	public:
 		static const uint16_t DEFAULT_FLAGS = 0;
+		static const uint16_t FLAG_ID		= 0x0001; // data is id, pad, value
+		static const uint16_t FLAG_REGISTER	= 0x0002; // data is id, pad, name
+		static const uint16_t FLAG_GROUP	= 0x0004; // frame is one group update
+
+		static const uint16_t INVALID_ID = 0xFFFF;
+		static const uint16_t MAX_PARAMETERS = 1024;
+		static const uint16_t MAX_GROUPS = 32;
 		
 		static const uint8_t NAME_LENGTH = 16;
-		static const uint8_t MAX_STR_LENGTH = 100;
-		static const uint8_t MAX_BLOB_LENGTH = 96;
+		static const uint8_t ID_LENGTH = 4;	// the id and 2 bytes of padding
+		static const uint8_t MAX_STR_LENGTH = UdpValueTableParameter::MAX_STR_LENGTH;
+		static const uint8_t MAX_BLOB_LENGTH = UdpValueTableParameter::MAX_BLOB_LENGTH;
 		
 		static const std::string DEFAULT_DEST_HOST;
 		static const uint32_t    DEFAULT_DEST_PORT = 1140;
         static const double 	 DEFAULT_PERIOD;
+        static const double 	 REGISTER_PERIOD;
+        static const double 	 DEFAULT_KEYFRAME_PERIOD;
 //		static const int32_t	 DEFAULT_PRIORITY  = Task::kDefaultPriority;
 	
 		UdpValueTable(std::string name, tinyxml2::XMLElement *xml);
 		~UdpValueTable();
 		void init(std::string name, tinyxml2::XMLElement *xml) ;
 
+		static gsi::SocketReactor *getReactor(void);
+
         void put(std::string name, UdpValueTableParameter::DataType type, uint8_t *bytes, uint16_t length, bool do_send=true);
 
 		template <class T> void put(std::string name, T val, bool do_send=true);
 		template <class T> T get(std::string name, T default_val = NULL);
 
+		template <class T> void put(uint16_t id, T val, bool do_send=true);
+		template <class T> T get(uint16_t id, T default_val);
+
+		uint16_t getId(std::string name);
+		std::string getName(uint16_t id);
+		template <class T> ParamHandle<T> getHandle(std::string name, T default_val);
+
+		template <class T> uint16_t defineGroup(const std::vector<std::string> &names, T default_val);
+		template <class T> void putGroup(uint16_t group, const T *values, bool do_send=true);
+		template <class T> bool getGroup(uint16_t group, T *values);
+		uint16_t getGroupSize(uint16_t group);
+
+		void subscribe(std::string name, UdpValueTableListener *listener);
+		void subscribe(std::string name, gsi::Semaphore *semaphore);
+		void subscribe(uint16_t id, UdpValueTableListener *listener);
+		void subscribe(uint16_t id, gsi::Semaphore *semaphore);
+		void unsubscribe(UdpValueTableListener *listener);
+		void unsubscribe(gsi::Semaphore *semaphore);
+
 		void printTable(void);
 
+		void setTelemetryRecorder(TelemetryRecorder *recorder);
+
+		bool isReplay(void);
+		bool replayPacket(const void *packet, uint32_t length);
+		void applyReceived(void);
+
 	protected:
 		void doPeriodic(void);
 		
 	private:
-		std::map<std::string, UdpValueTableParameter *> parameters;
+		// the most records a frame can hold, the smallest record is a
+		// header, an ID, and a 1 byte value padded to 16 bytes
+		static const uint32_t MAX_FRAME_RECORDS = gsi::UDP_BUFFERED_MAX_FRAME_LENGTH / 16;
+
+		// one of listener or semaphore is set
+		typedef struct
+		{
+			UdpValueTableListener *listener;
+			gsi::Semaphore *semaphore;
+		} Subscription;
+
+		// indexed by ID, sized to MAX_PARAMETERS when constructed, only the
+		// first parameter_count entries are in use.  The parameters are one
+		// array so going through the table walks memory in order, the names
+		// are only used to add and print parameters.
+		UdpValueTableParameter *parameter_store;
+		std::vector<std::string> parameter_names;
+		std::vector<uint8_t> parameter_announced;
+		std::vector<uint32_t> parameter_dirty;
+		volatile uint32_t parameter_count;
+
+		// set once a parameter is sent from this side, keyframes only resend
+		// these so values that came from the remote table are not echoed
+		std::vector<uint32_t> parameter_published;
+
+		// protects parameter_ids and adding parameters
+		std::map<std::string, uint16_t> parameter_ids;
+		gsi::Mutex parameter_lock;
+
+		// the remote table's IDs mapped to the IDs in this table
+		std::vector<uint16_t> remote_ids;
+
+		// member IDs indexed by group, sized to MAX_GROUPS when constructed,
+		// only the first group_count entries are in use
+		std::vector<std::vector<uint16_t> > groups;
+		volatile uint32_t group_count;
+		gsi::SeqLock group_lock;
+
+		// set while a received group is applied so subscribers are only
+		// told once the whole group is visible
+		bool applying_group;
+		std::vector<uint16_t> deferred_notifications;
+
+		// subscriptions indexed by ID, sized to MAX_PARAMETERS when
+		// constructed, and by name for parameters that have not been added
+		// yet.  subscription_lock is taken before parameter_lock when both
+		// are held.
+		std::vector<std::vector<Subscription> > parameter_subscriptions;
+		std::multimap<std::string, Subscription> pending_subscriptions;
+		gsi::Mutex subscription_lock;
+
+		// set and cleared by TelemetryRecorder::open() and close()
+		TelemetryRecorder * volatile telemetry_recorder;
+
 		gsi::UdpBufferedTransmitter *txControl;
 		gsi::UdpBufferedReceiver *rxControl;
+
+		// lets a replay apply packets between the table's periods
+		gsi::Mutex receive_lock;
+
+		// set by the replay XML attribute, rxControl is not started
+		bool replay_only;
+
+		static gsi::SocketReactor *shared_reactor;
+		static gsi::Mutex reactor_lock;
 		
 		UdpValueTableParameter *getParameter(std::string name);
-		void send(std::string name, UdpValueTableParameter *p);
+		UdpValueTableParameter *getParameter(uint16_t id);
+		template <class T> void putValue(uint16_t id, T val, bool do_send);
+		uint16_t addParameter(std::string name, UdpValueTableParameter &p,
+			bool *added = NULL);
+		void initParameter(UdpValueTableParameter &p, UdpValueTableParameter::DataType type,
+			uint8_t *bytes, uint16_t length);
+
+		void publish(uint16_t id, UdpValueTableParameter *p, bool changed);
+		bool isRecording(void);
+		void recordValue(uint16_t id, UdpValueTableParameter *p);
+		void recordValue(uint16_t id, uint8_t type, uint8_t *bytes, uint16_t length);
+		void publishDirty(void);
+		void send(uint16_t id, UdpValueTableParameter *p);
+		void sendRegistration(uint16_t id);
+		void sendRegistrations(const uint16_t *ids, uint32_t count);
+		void getRegistrationKey(uint16_t id, char *key);
+		uint16_t getKey(uint16_t id, char *key, uint16_t *flags);
+		void putRecord(uint16_t type, uint16_t flags, const char *key,
+			uint16_t key_length, UdpValueTableParameter *p);
+		bool appendRecord(char *buffer, uint16_t *length, uint16_t type, uint16_t flags,
+			const char *key, uint16_t key_length, UdpValueTableParameter *p);
+
+		uint16_t addGroup(const std::vector<uint16_t> &ids);
+		bool isGroupType(uint16_t group, UdpValueTableParameter::DataType type);
+		void sendGroup(uint16_t group);
+		void sendKeyframe(uint32_t count);
+		void announce(const uint16_t *ids, uint32_t count);
+		uint32_t buildFrame(char *buffer, uint16_t *length, const uint16_t *ids,
+			uint32_t count);
+
+		void applyPacket(uint16_t type, uint16_t flags, char *data, uint16_t length);
+		void applyValue(uint16_t id, uint16_t type, uint8_t *bytes, uint16_t length);
+		void applyFrame(uint16_t count, char *data, uint16_t length);
+		void applyGroup(uint16_t count, char *data, uint16_t length);
+		void addSubscription(std::string name, uint16_t id, Subscription sub);
+		void removeSubscription(UdpValueTableListener *listener, gsi::Semaphore *semaphore);
+		bool isSubscribed(uint16_t id);
+		void notify(uint16_t id);
+		void flushFrame(void);
+		void sendFrame(void);
 		
 		bool echo_received_data;
 
+		bool use_ids;
+		double next_register_time;
+
+		bool delta_publishing;
+		double keyframe_period;
+		double next_keyframe_time;
+
+		// when coalescing, updates are collected into one frame that is
+		// sent once per period instead of one packet per update
+		bool coalesce_updates;
+		char frame_buffer[gsi::UDP_BUFFERED_MAX_FRAME_LENGTH];
+		uint16_t frame_length;
+		uint16_t frame_count;
+		gsi::Mutex frame_lock;
+
         void finalize(void);
 };
 
+/*******************************************************************************
+ *
+ * A typed reference to one parameter of a UdpValueTable.  Getting and
+ * putting through a handle indexes straight into the table, no strings
+ * are constructed or compared.  Get handles once with
+ * UdpValueTable::getHandle() and keep them for use in control loops.
+ *
+ ******************************************************************************/
+template <class T>
+class ParamHandle
+{
+	public:
+		ParamHandle(void)
+		{
+			table = NULL;
+			id = UdpValueTable::INVALID_ID;
+			default_value = T();
+		}
+
+		ParamHandle(UdpValueTable *t, uint16_t i, T default_val)
+		{
+			table = t;
+			id = i;
+			default_value = default_val;
+		}
+
+		bool isValid(void)		{ return (table != NULL) && (id != UdpValueTable::INVALID_ID); }
+		uint16_t getId(void)	{ return id; }
+
+		T get(void)
+		{
+			UdpValueTableParameter *p = isValid() ? table->getParameter(id) : NULL;
+			return (p == NULL) ? default_value : p->get<T>();
+		}
+
+		void put(T val, bool do_send=true)
+		{
+			if (isValid())
+			{
+				table->put<T>(id, val, do_send);
+			}
+		}
+
+	private:
+		UdpValueTable *table;
+		uint16_t id;
+		T default_value;
+};
+
 /*******************************************************************************
  *
  ******************************************************************************/
 template <class T>
 void UdpValueTable::put(std::string name, T val, bool do_send)
 {
-	UdpValueTableParameter *p = getParameter(name);
-	if (p == NULL)
+	uint16_t id = getId(name);
+	if (id == INVALID_ID)
 	{
         printf("inserting new for %s\n", name.c_str());
-        p = new UdpValueTableParameter();
-        p->init<T>(val);
-        parameters.insert(std::pair<std::string, UdpValueTableParameter *>(name, p));
+        bool added = false;
+        UdpValueTableParameter p;
+        p.init<T>(val);
+        id = addParameter(name, p, &added);
+		if (id == INVALID_ID)
+		{
+			return;
+		}
+
+		if (added)
+		{
+			if (do_send)
+			{
+				publish(id, getParameter(id), true);
+			}
+			return;
+		}
+
+		// another thread added it first
+    }
+
+	put<T>(id, val, do_send);
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+template <class T>
+T UdpValueTable::get(std::string name, T default_val)
+{
+	return get<T>(getId(name), default_val);
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+template <class T>
+void UdpValueTable::put(uint16_t id, T val, bool do_send)
+{
+	UdpValueTableParameter *p = getParameter(id);
+	if (p == NULL)
+	{
+		return;
+	}
+
+    if (p->getType() != UdpValueTableParameter::typeOf<T>(val))
+    {
+        printf("UdpValueTable::put: type mismatch, for parameter %s\n", parameter_names[id].c_str());
+        return;
     }
-    else
+
+	putValue<T>(id, val, do_send);
+}
+
+/*******************************************************************************
+ *
+ * Set a parameter that is known to exist and to be of type T.
+ *
+ ******************************************************************************/
+template <class T>
+void UdpValueTable::putValue(uint16_t id, T val, bool do_send)
+{
+	UdpValueTableParameter *p = &parameter_store[id];
+
+	bool changed = (p->get<T>() != val);
+    if (changed)
     {
-        if (p->getType() != UdpValueTableParameter::typeOf<T>(val))
-        {
-            printf("UdpValueTable::put: type mismatch, for parameter %s\n", name.c_str());
-            return;
-        }
-
-        if (p->get<T>() != val)
-        {
-            // tell observers data changed
-            p->set(val);
-        }
+        // tell observers data changed
+        p->set(val);
     }
 
+	if ((changed || do_send) && isRecording())
+	{
+		recordValue(id, p);
+	}
+
 	if (do_send)
 	{
-        printf("sending %s\n", name.c_str());
-		send(name, p);
+		publish(id, p, changed);
 	}
 }
 
+/*******************************************************************************
+ *
+ * @return	true if there is a recorder that values should be recorded to
+ *
+ ******************************************************************************/
+inline bool UdpValueTable::isRecording(void)
+{
+	return gsi::FlightRecorder::isOpen() || (telemetry_recorder != NULL);
+}
+
 /*******************************************************************************
  *
  ******************************************************************************/
 template <class T>
-T UdpValueTable::get(std::string name, T default_val)
+T UdpValueTable::get(uint16_t id, T default_val)
 {
-    UdpValueTableParameter *p = getParameter(name);
+    UdpValueTableParameter *p = getParameter(id);
     if (p == NULL)
     {
         return default_val;
@@ -129,4 +483,134 @@ T UdpValueTable::get(std::string name, T default_val)
     return p->get<T>();
 }
 
+/*******************************************************************************
+ *
+ * Get a handle to the named parameter, the parameter is added with the
+ * default value (but not sent) if it does not exist yet.
+ *
+ * @return	the handle, it is not valid if the parameter exists with a
+ *			different type
+ *
+ ******************************************************************************/
+template <class T>
+ParamHandle<T> UdpValueTable::getHandle(std::string name, T default_val)
+{
+	uint16_t id = getId(name);
+	if (id == INVALID_ID)
+	{
+		put<T>(name, default_val, false);
+		id = getId(name);
+	}
+
+	UdpValueTableParameter *p = getParameter(id);
+	if ((p == NULL) || (p->getType() != UdpValueTableParameter::typeOf<T>(default_val)))
+	{
+		printf("UdpValueTable::getHandle: type mismatch, for parameter %s\n", name.c_str());
+		return ParamHandle<T>();
+	}
+
+	return ParamHandle<T>(this, id, default_val);
+}
+
+/*******************************************************************************
+ *
+ * Define a group of parameters that are put and gotten together.  Members
+ * that do not exist are added with the default value (but not sent).
+ *
+ * @return	the group or INVALID_ID if a member exists with a different
+ *			type or there are already MAX_GROUPS groups
+ *
+ ******************************************************************************/
+template <class T>
+uint16_t UdpValueTable::defineGroup(const std::vector<std::string> &names, T default_val)
+{
+	std::vector<uint16_t> ids;
+	for (uint32_t i = 0; i < names.size(); i++)
+	{
+		ParamHandle<T> handle = getHandle<T>(names[i], default_val);
+		if (! handle.isValid())
+		{
+			return INVALID_ID;
+		}
+		ids.push_back(handle.getId());
+	}
+
+	return addGroup(ids);
+}
+
+/*******************************************************************************
+ *
+ * Set every member of a group, then if do_send is set send them all in one
+ * frame.  Groups are always sent right away, even when delta publishing.
+ *
+ * @param	values	one value for each member, in the order the names were
+ *					passed to defineGroup()
+ *
+ ******************************************************************************/
+template <class T>
+void UdpValueTable::putGroup(uint16_t group, const T *values, bool do_send)
+{
+	if (! isGroupType(group, UdpValueTableParameter::typeOf<T>(T())))
+	{
+		printf("UdpValueTable::putGroup: bad group or type mismatch, for group %d\n", group);
+		return;
+	}
+
+	std::vector<uint16_t> &ids = groups[group];
+
+	group_lock.beginWrite();
+	for (uint32_t i = 0; i < ids.size(); i++)
+	{
+		parameter_store[ids[i]].set<T>(values[i]);
+	}
+	group_lock.endWrite();
+
+	if (isRecording())
+	{
+		for (uint32_t i = 0; i < ids.size(); i++)
+		{
+			recordValue(ids[i], &parameter_store[ids[i]]);
+		}
+	}
+
+	if (do_send)
+	{
+		sendGroup(group);
+	}
+}
+
+/*******************************************************************************
+ *
+ * Copy every member of a group, the copy is never a mix of two group
+ * updates.
+ *
+ * @param	values	an array of at least getGroupSize() values
+ *
+ * @return	false if the group does not exist or its members are not of
+ *			type T
+ *
+ ******************************************************************************/
+template <class T>
+bool UdpValueTable::getGroup(uint16_t group, T *values)
+{
+	if (! isGroupType(group, UdpValueTableParameter::typeOf<T>(T())))
+	{
+		return false;
+	}
+
+	std::vector<uint16_t> &ids = groups[group];
+
+	uint32_t seq;
+	do
+	{
+		seq = group_lock.beginRead();
+		for (uint32_t i = 0; i < ids.size(); i++)
+		{
+			values[i] = parameter_store[ids[i]].get<T>();
+		}
+	} while (! group_lock.endRead(seq));
+
+	return true;
+}
+
 } // namespace gsu
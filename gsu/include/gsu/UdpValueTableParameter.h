@@ -14,7 +14,12 @@
 #include <string>
 #include <vector>
 
+#include <string.h>
+
 #include <gsi/UdpSocket.h>
+#include <gsi/SeqLock.h>
+
+#include "gsu/UdpValueTableSlab.h"
 
 namespace gsu
 {
@@ -24,6 +29,20 @@ namespace gsu
  * This class uses templated methods to set, get, send, and receive values 
  * of different types and sizes.  It is intended to be used by UdpValueTable
  * but could potentially be used by others.
+ *
+ * The value is protected by a sequence lock so one thread can set it while
+ * others get it without a Mutex.  Writers make the sequence odd while they
+ * change the value, readers copy the value and retry if the sequence was
+ * odd or changed, so reads never block a writer.
+ *
+ * Numbers are kept in an 8 byte value slot, strings and BLOBs are kept in
+ * a block of VALUE_CAPACITY bytes from a shared UdpValueTableSlab that
+ * the slot points to.  The block is taken the first time the value is
+ * set and kept until the parameter is deleted, so setting a new value only
+ * copies it, it never goes to the heap.  Strings longer than MAX_STR_LENGTH
+ * and BLOBs longer than MAX_BLOB_LENGTH are cut off.  The pointer returned
+ * by get<void *>() stays valid as long as the parameter, but the bytes may
+ * change while they are used if another thread sets the BLOB.
  * 
  ******************************************************************************/
 class UdpValueTableParameter
@@ -44,7 +63,12 @@ class UdpValueTableParameter
 			TYPE_BLOB
 		};
 
+		static const uint16_t MAX_STR_LENGTH	= 100;	// not counting the null
+		static const uint16_t MAX_BLOB_LENGTH	= 96;
+		static const uint16_t VALUE_CAPACITY	= MAX_STR_LENGTH + 1;
+
 		UdpValueTableParameter(void);
+		~UdpValueTableParameter(void);
 
 		// for BLOBs
 		UdpValueTableParameter(void *bytes, uint16_t len);
@@ -56,18 +80,39 @@ class UdpValueTableParameter
 		template <class T> void set(T v);
 		template <class T> T get(void);
 		
-		DataType getType()  { return type; }
-		uint16_t getSize()  { return length; }
+		DataType getType()  { return (DataType)type; }
+		uint16_t getSize()  { return readValue(&length); }
+		uint16_t getCapacity(void);
 		
 		template <class T> static DataType typeOf(T);
 		template <class T> static uint16_t sizeOf(T);
 
 		uint16_t toNetBytes(uint8_t *dest);
 		uint16_t fromNetBytes(uint8_t *src, uint32_t length_arg);
+
+		// for numeric types known when compiling, no switch on the type
+		template <class T> static uint16_t toNetBytes(T val, uint8_t *dest);
+		template <class T> static T fromNetBytes(uint8_t *src);
+
+		void takeValue(UdpValueTableParameter &src);
 		
 	private:
-		DataType type;
+		// parameters own their storage block, they are not copied
+		UdpValueTableParameter(const UdpValueTableParameter &);
+		UdpValueTableParameter &operator=(const UdpValueTableParameter &);
+
+		static UdpValueTableSlab value_slab;
+
+		// kept small so a table's parameters pack into few cache lines
+		gsi::SeqLock value_lock;
 		uint16_t length;
+		uint8_t type;
+
+		template <class T> T readValue(T *field);
+		template <class T> void writeValue(T *field, T val);
+
+		void setBytes(const void *bytes, uint16_t len, bool is_string);
+		uint16_t readBytes(uint8_t *dest);
 
 		union
 		{
@@ -79,10 +124,40 @@ class UdpValueTableParameter
 			int32_t 	i32;
 			uint32_t 	u32;
 			float 		f32;
-			uint8_t		*blob;
+			uint8_t		*storage;	// the string or BLOB, NULL until one is set
 		} value;
 };
 
+/*******************************************************************************
+ *
+ * Read a field of a fixed size, retrying until no writer changed it.
+ *
+ ******************************************************************************/
+template <class T> inline T UdpValueTableParameter::readValue(T *field)
+{
+	uint32_t seq;
+	T val;
+	do
+	{
+		seq = value_lock.beginRead();
+		val = *((volatile T *)field);
+	} while (! value_lock.endRead(seq));
+
+	return val;
+}
+
+/*******************************************************************************
+ *
+ * Write a field of a fixed size.
+ *
+ ******************************************************************************/
+template <class T> inline void UdpValueTableParameter::writeValue(T *field, T val)
+{
+	value_lock.beginWrite();
+	*field = val;
+	value_lock.endWrite();
+}
+
 /*******************************************************************************
  *
  * Initialized an instance of this class with the provided value.
@@ -156,24 +231,122 @@ template <class T> 	inline uint16_t UdpValueTableParameter::sizeOf(T v) 			{ ret
  *  @param	v	a type specific value to be stored 
  *  
  ******************************************************************************/
-template<> inline void UdpValueTableParameter::set(bool v) 			{ value.b = v; 		}
-template<> inline void UdpValueTableParameter::set(int8_t v) 		{ value.i8 = v; 	}
-template<> inline void UdpValueTableParameter::set(uint8_t v) 		{ value.u8 = v; 	}
-template<> inline void UdpValueTableParameter::set(int16_t v) 		{ value.i16 = v; 	}
-template<> inline void UdpValueTableParameter::set(uint16_t v) 		{ value.u16 = v; 	}
-template<> inline void UdpValueTableParameter::set(int32_t v) 		{ value.i32 = v; 	}
-template<> inline void UdpValueTableParameter::set(uint32_t v) 		{ value.u32 = v; 	}
-template<> inline void UdpValueTableParameter::set(float v) 		{ value.f32 = v; 	}
-
-template<> inline void UdpValueTableParameter::set(std::string v) 	
-{
-	if (value.blob != NULL)
-	{
-		delete (std::string *)value.blob;
- 	}
+template<> inline void UdpValueTableParameter::set(bool v) 			{ writeValue(&value.b, v); 		}
+template<> inline void UdpValueTableParameter::set(int8_t v) 		{ writeValue(&value.i8, v); 	}
+template<> inline void UdpValueTableParameter::set(uint8_t v) 		{ writeValue(&value.u8, v); 	}
+template<> inline void UdpValueTableParameter::set(int16_t v) 		{ writeValue(&value.i16, v); 	}
+template<> inline void UdpValueTableParameter::set(uint16_t v) 		{ writeValue(&value.u16, v); 	}
+template<> inline void UdpValueTableParameter::set(int32_t v) 		{ writeValue(&value.i32, v); 	}
+template<> inline void UdpValueTableParameter::set(uint32_t v) 		{ writeValue(&value.u32, v); 	}
+template<> inline void UdpValueTableParameter::set(float v) 		{ writeValue(&value.f32, v); 	}
 
-	value.blob = (uint8_t *) new std::string(v);
-	length = v.size() + 1;
+template<> inline void UdpValueTableParameter::set(std::string v)
+{
+	setBytes(v.c_str(), v.size(), true);
+}
+
+/*******************************************************************************
+ *
+ *  Put a value of a numeric type into a buffer in network byte order.
+ *  
+ *  This method is implemented with Templated Method Specialization so
+ *  callers that know the type when compiling do not switch on it.
+ *  
+ *  NOTE:	There is not a generic implementation of this method, strings
+ *			and BLOBs go through the non-templated toNetBytes().
+ *
+ *  @return	the number of bytes put into the destination buffer
+ *  
+ ******************************************************************************/
+template<> inline uint16_t UdpValueTableParameter::toNetBytes(bool val, uint8_t *dest)
+{
+	// NOTE: transmitted as uint8_t because receiver may
+	// declare bools as different sizes
+	*dest = val ? 1 : 0;
+	return 1;
+}
+
+template<> inline uint16_t UdpValueTableParameter::toNetBytes(int8_t val, uint8_t *dest)
+{
+	*dest = (uint8_t)val;
+	return 1;
+}
+
+template<> inline uint16_t UdpValueTableParameter::toNetBytes(uint8_t val, uint8_t *dest)
+{
+	*dest = val;
+	return 1;
+}
+
+template<> inline uint16_t UdpValueTableParameter::toNetBytes(uint16_t val, uint8_t *dest)
+{
+	// the buffer may not be aligned, so copy instead of casting it
+	uint16_t net = htons(val);
+	memcpy(dest, &net, sizeof(net));
+	return 2;
+}
+
+template<> inline uint16_t UdpValueTableParameter::toNetBytes(int16_t val, uint8_t *dest)
+{
+	return toNetBytes<uint16_t>((uint16_t)val, dest);
+}
+
+template<> inline uint16_t UdpValueTableParameter::toNetBytes(uint32_t val, uint8_t *dest)
+{
+	uint32_t net = htonl(val);
+	memcpy(dest, &net, sizeof(net));
+	return 4;
+}
+
+template<> inline uint16_t UdpValueTableParameter::toNetBytes(int32_t val, uint8_t *dest)
+{
+	return toNetBytes<uint32_t>((uint32_t)val, dest);
+}
+
+template<> inline uint16_t UdpValueTableParameter::toNetBytes(float val, uint8_t *dest)
+{
+	uint32_t bits;
+	memcpy(&bits, &val, sizeof(bits));
+	return toNetBytes<uint32_t>(bits, dest);
+}
+
+/*******************************************************************************
+ *
+ *  Read a value of a numeric type from a buffer in network byte order.
+ *  
+ *  This method is implemented with Templated Method Specialization so
+ *  callers that know the type when compiling do not switch on it.
+ *  
+ *  @return	the value in host byte order
+ *  
+ ******************************************************************************/
+template<> inline bool 		UdpValueTableParameter::fromNetBytes(uint8_t *src) { return (*src != 0); }
+template<> inline int8_t 	UdpValueTableParameter::fromNetBytes(uint8_t *src) { return (int8_t)*src; }
+template<> inline uint8_t 	UdpValueTableParameter::fromNetBytes(uint8_t *src) { return *src; }
+
+template<> inline uint16_t UdpValueTableParameter::fromNetBytes(uint8_t *src)
+{
+	uint16_t net;
+	memcpy(&net, src, sizeof(net));
+	return ntohs(net);
+}
+
+template<> inline uint32_t UdpValueTableParameter::fromNetBytes(uint8_t *src)
+{
+	uint32_t net;
+	memcpy(&net, src, sizeof(net));
+	return ntohl(net);
+}
+
+template<> inline int16_t	UdpValueTableParameter::fromNetBytes(uint8_t *src) { return (int16_t)fromNetBytes<uint16_t>(src); }
+template<> inline int32_t	UdpValueTableParameter::fromNetBytes(uint8_t *src) { return (int32_t)fromNetBytes<uint32_t>(src); }
+
+template<> inline float UdpValueTableParameter::fromNetBytes(uint8_t *src)
+{
+	uint32_t bits = fromNetBytes<uint32_t>(src);
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
 }
 
 /*******************************************************************************
@@ -186,15 +359,23 @@ template<> inline void UdpValueTableParameter::set(std::string v)
  *  @return		a type specific value
  *  
  ******************************************************************************/
-template <> inline bool 		UdpValueTableParameter::get(void) 	{ return value.b; }
-template <> inline int8_t 		UdpValueTableParameter::get(void) 	{ return value.i8; }
-template <> inline uint8_t 		UdpValueTableParameter::get(void) 	{ return value.u8; }
-template <> inline int16_t 		UdpValueTableParameter::get(void) 	{ return value.i16; }
-template <> inline uint16_t		UdpValueTableParameter::get(void) 	{ return value.u16; }
-template <> inline int32_t 		UdpValueTableParameter::get(void) 	{ return value.i32; }
-template <> inline uint32_t		UdpValueTableParameter::get(void) 	{ return value.u32; }
-template <> inline float 		UdpValueTableParameter::get(void) 	{ return value.f32; }
-template <> inline std::string	UdpValueTableParameter::get(void) 	{ return *((std::string *)value.blob); }
-template <> inline void *		UdpValueTableParameter::get(void) 	{ return value.blob; }
+template <> inline bool 		UdpValueTableParameter::get(void) 	{ return readValue(&value.b); }
+template <> inline int8_t 		UdpValueTableParameter::get(void) 	{ return readValue(&value.i8); }
+template <> inline uint8_t 		UdpValueTableParameter::get(void) 	{ return readValue(&value.u8); }
+template <> inline int16_t 		UdpValueTableParameter::get(void) 	{ return readValue(&value.i16); }
+template <> inline uint16_t		UdpValueTableParameter::get(void) 	{ return readValue(&value.u16); }
+template <> inline int32_t 		UdpValueTableParameter::get(void) 	{ return readValue(&value.i32); }
+template <> inline uint32_t		UdpValueTableParameter::get(void) 	{ return readValue(&value.u32); }
+template <> inline float 		UdpValueTableParameter::get(void) 	{ return readValue(&value.f32); }
+template <> inline void *		UdpValueTableParameter::get(void) 	{ return readValue(&value.storage); }
+
+template <> inline std::string	UdpValueTableParameter::get(void)
+{
+	uint8_t str[VALUE_CAPACITY];
+	uint16_t len = readBytes(str);
+
+	// the length counts the null
+	return (len == 0) ? std::string() : std::string((char *)str, len - 1);
+}
 
 } // namespace gsu
@@ -0,0 +1,63 @@
+/*******************************************************************************
+ *
+ * File: UdpValueTableReplay.h
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <stdint.h>
+
+namespace gsu
+{
+
+class UdpValueTable;
+
+/*******************************************************************************
+ *
+ * Feeds a capture made by a table with the capture XML attribute (or by
+ * gsi::UdpBufferedReceiver::startCapture()) into a UdpValueTable, so a run
+ * can be reproduced without the robot on the network.
+ *
+ * In real time the packets are given to the table when they were received,
+ * relative to the start of the replay, and the table applies them on its
+ * own period as it would live ones.  Otherwise they are given as fast as
+ * the table takes them, whenever the receiver's buffer fills it is applied
+ * right away, so the replay measures how fast the receive and apply path
+ * can go on real traffic.  Either way no packet is dropped and they are
+ * applied in the order they were received.
+ *
+ * The table must set the replay XML attribute, so its receiver has no
+ * socket and the replay is the only thing that fills its buffer.  It
+ * should otherwise be set up the way the captured one was (use_ids and the
+ * like).
+ *
+ ******************************************************************************/
+class UdpValueTableReplay
+{
+	public:
+		UdpValueTableReplay(UdpValueTable *table);
+
+		bool replay(const char *file_name, bool real_time);
+
+		uint32_t getPacketCount(void)		{ return packet_count; }
+		double getCaptureLength(void)		{ return capture_length; }
+		double getElapsedTime(void)			{ return elapsed_time; }
+
+	private:
+		// how long to wait for a receiver that takes no packets
+		static const double STALL_TIMEOUT;
+
+		UdpValueTable *replay_table;
+
+		uint32_t packet_count;
+		double capture_length;
+		double elapsed_time;
+};
+
+} // namespace gsu
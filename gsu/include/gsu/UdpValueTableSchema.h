@@ -0,0 +1,191 @@
+/*******************************************************************************
+ *
+ * File: UdpValueTableSchema.h
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <string>
+
+#include "gsu/UdpValueTable.h"
+
+namespace gsu
+{
+
+/*******************************************************************************
+ *
+ *	The parameter type for each C++ type a schema entry can have.
+ *
+ *	NOTE:	There is not a generic implementation of this class so an entry
+ *			of a type that is not supported (even void *) does not compile.
+ *
+ ******************************************************************************/
+template <class T> struct UdpValueTableSchemaType;
+
+template <> struct UdpValueTableSchemaType<bool>		{ enum { TYPE = UdpValueTableParameter::TYPE_BOOL }; };
+template <> struct UdpValueTableSchemaType<int8_t>		{ enum { TYPE = UdpValueTableParameter::TYPE_INT8 }; };
+template <> struct UdpValueTableSchemaType<uint8_t>		{ enum { TYPE = UdpValueTableParameter::TYPE_UINT8 }; };
+template <> struct UdpValueTableSchemaType<int16_t>		{ enum { TYPE = UdpValueTableParameter::TYPE_INT16 }; };
+template <> struct UdpValueTableSchemaType<uint16_t>	{ enum { TYPE = UdpValueTableParameter::TYPE_UINT16 }; };
+template <> struct UdpValueTableSchemaType<int32_t>		{ enum { TYPE = UdpValueTableParameter::TYPE_INT32 }; };
+template <> struct UdpValueTableSchemaType<uint32_t>	{ enum { TYPE = UdpValueTableParameter::TYPE_UINT32 }; };
+template <> struct UdpValueTableSchemaType<float>		{ enum { TYPE = UdpValueTableParameter::TYPE_FLOAT32 }; };
+template <> struct UdpValueTableSchemaType<std::string>	{ enum { TYPE = UdpValueTableParameter::TYPE_STRING }; };
+
+/*******************************************************************************
+ *
+ * The base of the classes made by UDP_VALUE_TABLE_SCHEMA().
+ *
+ * A schema is a list of parameters whose names, types, and default values
+ * are known when compiling.  Each entry becomes a nested class of the
+ * schema that carries its type and its index in the list, so
+ *
+ *	#define DRIVE_PARAMS(ENTRY) \
+ *		ENTRY(drive_speed,	float,	0.0f) \
+ *		ENTRY(drive_enable,	bool,	false)
+ *
+ *	UDP_VALUE_TABLE_SCHEMA(DriveSchema, DRIVE_PARAMS)
+ *
+ *	DriveSchema drive;
+ *	drive.bind(table);
+ *	drive.put<DriveSchema::drive_speed>(0.5f);
+ *	float speed = drive.get<DriveSchema::drive_speed>();
+ *
+ * only compiles with the entry's type, and a name that is used twice or
+ * is longer than UdpValueTable::NAME_LENGTH does not compile.
+ *
+ * bind() adds any parameter the table does not have yet with its default
+ * value and checks the type of the ones it does have, once.  After that a
+ * get or put indexes straight into the table with the ID found by bind(),
+ * there is no name lookup and no check of the type.  A schema that is not
+ * bound, or that failed to bind, gets the defaults and drops puts.  bind()
+ * must be called before other threads use the schema.
+ *
+ ******************************************************************************/
+class UdpValueTableSchema
+{
+	public:
+		bool isBound(void)					{ return table != NULL; }
+		UdpValueTable *getTable(void)		{ return table; }
+
+		template <class E> uint16_t getId(void)
+		{
+			return (table == NULL) ? UdpValueTable::INVALID_ID : entry_ids[E::INDEX];
+		}
+
+		template <class E> typename E::Type get(void)
+		{
+			if (table == NULL)
+			{
+				return E::getDefault();
+			}
+
+			return table->parameter_store[entry_ids[E::INDEX]].template get<typename E::Type>();
+		}
+
+		template <class E> void put(typename E::Type val, bool do_send=true)
+		{
+			if (table != NULL)
+			{
+				table->putValue<typename E::Type>(entry_ids[E::INDEX], val, do_send);
+			}
+		}
+
+	protected:
+		UdpValueTableSchema(uint16_t *ids, uint16_t count);
+
+		bool beginBind(UdpValueTable *t);
+		bool endBind(bool ok);
+
+		template <class E> bool bindEntry(void)
+		{
+			if (bind_table == NULL)
+			{
+				return false;
+			}
+
+			ParamHandle<typename E::Type> handle =
+				bind_table->getHandle<typename E::Type>(E::getName(), E::getDefault());
+
+			entry_ids[E::INDEX] = handle.getId();
+			return handle.isValid();
+		}
+
+	private:
+		// entry_ids points at the derived class's list, a copy would keep
+		// using the original's, so schemas are not copied
+		UdpValueTableSchema(const UdpValueTableSchema &);
+		UdpValueTableSchema &operator=(const UdpValueTableSchema &);
+
+		UdpValueTable *table;
+		UdpValueTable *bind_table;
+		uint16_t *entry_ids;
+		uint16_t entry_count;
+};
+
+} // namespace gsu
+
+/*******************************************************************************
+ *
+ * These are used by UDP_VALUE_TABLE_SCHEMA() with each entry of the list.
+ *
+ ******************************************************************************/
+#define UDP_VALUE_TABLE_SCHEMA_INDEX(name, type, default_val)					\
+	name##_INDEX,
+
+#define UDP_VALUE_TABLE_SCHEMA_ENTRY(name, type, default_val)					\
+	class name																	\
+	{																			\
+		public:																	\
+			typedef type Type;													\
+			enum																\
+			{																	\
+				INDEX = name##_INDEX,											\
+				TYPE = gsu::UdpValueTableSchemaType<type>::TYPE					\
+			};																	\
+			static const char *getName(void)	{ return #name; }				\
+			static type getDefault(void)		{ return default_val; }			\
+		private:																\
+			typedef char name_fits[													\
+				(sizeof(#name) <= gsu::UdpValueTable::NAME_LENGTH + 1) ? 1 : -1];	\
+	};
+
+#define UDP_VALUE_TABLE_SCHEMA_BIND(name, type, default_val)					\
+	ok = bindEntry<name>() && ok;
+
+/*******************************************************************************
+ *
+ * Define a class named schema_name that is a UdpValueTableSchema with one
+ * entry for each ENTRY(name, type, default_val) in the list macro.
+ *
+ ******************************************************************************/
+#define UDP_VALUE_TABLE_SCHEMA(schema_name, LIST)								\
+	class schema_name : public gsu::UdpValueTableSchema							\
+	{																			\
+		public:																	\
+			enum																\
+			{																	\
+				LIST(UDP_VALUE_TABLE_SCHEMA_INDEX)								\
+				ENTRY_COUNT														\
+			};																	\
+																				\
+			LIST(UDP_VALUE_TABLE_SCHEMA_ENTRY)									\
+																				\
+			schema_name(void) : gsu::UdpValueTableSchema(schema_ids, ENTRY_COUNT) {}	\
+																				\
+			bool bind(gsu::UdpValueTable *t)									\
+			{																	\
+				bool ok = beginBind(t);											\
+				LIST(UDP_VALUE_TABLE_SCHEMA_BIND)								\
+				return endBind(ok);												\
+			}																	\
+																				\
+		private:																\
+			uint16_t schema_ids[ENTRY_COUNT];									\
+	};
@@ -0,0 +1,61 @@
+/*******************************************************************************
+ *
+ * File: UdpValueTableSlab.h
+ * 
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "gsi/Mutex.h"
+
+namespace gsu
+{
+
+/*******************************************************************************
+ *
+ * This class hands out blocks of one fixed size from slabs that each hold
+ * many blocks, so the string and BLOB values of a UdpValueTable do not
+ * each go to the heap.
+ *
+ * A block is only taken when a parameter is created and given back when
+ * it is deleted, updating a value just copies into the block it already
+ * has.  A slab is allocated when no free blocks are left, slabs are kept
+ * until the slab allocator is deleted.  Any thread may allocate and
+ * release blocks.
+ *
+ ******************************************************************************/
+class UdpValueTableSlab
+{
+	public:
+		UdpValueTableSlab(uint16_t block_size, uint16_t blocks_per_slab);
+		~UdpValueTableSlab(void);
+
+		uint8_t *allocate(void);
+		void release(uint8_t *block);
+		void reserve(uint32_t count);
+
+		uint16_t getBlockSize(void);
+		uint32_t getBlockCount(void);
+		uint32_t getFreeCount(void);
+
+	private:
+		bool addSlab(void);
+
+		uint16_t block_size;
+		uint16_t blocks_per_slab;
+
+		std::vector<uint8_t *> slab_list;
+		std::vector<uint8_t *> free_list;
+		gsi::Mutex slab_lock;
+};
+
+} // namespace gsu
@@ -0,0 +1,72 @@
+/*******************************************************************************
+ *
+ * File: UdpValueTableThreadStats.h
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <string>
+
+#include "gsi/PeriodicThread.h"
+
+#include "gsu/UdpValueTable.h"
+
+namespace gsu
+{
+
+/*******************************************************************************
+ *
+ * Publishes the timing statistics of a PeriodicThread into a UdpValueTable
+ * so loop health can be watched from the driver station.
+ *
+ * The parameters are named <prefix>_<stat>, the prefix is cut to
+ * MAX_PREFIX_LENGTH characters so the names fit in NAME_LENGTH.  Times are
+ * floats in milliseconds:
+ *	_ex50 _ex99 _ex999 _exmax		execution time percentiles and max
+ *	_lat50 _lat99 _lat999 _latmax	wakeup latency percentiles and max
+ *	_per99 _permax					period error 99th percentile and max
+ * counts are uint32_t:
+ *	_cycles _overrun _skipped
+ *
+ * Call publish() at whatever rate the values should be updated, usually
+ * much slower than the thread being watched.
+ *
+ ******************************************************************************/
+class UdpValueTableThreadStats
+{
+	public:
+		static const uint32_t MAX_PREFIX_LENGTH = 8;
+
+		UdpValueTableThreadStats(UdpValueTable *table, gsi::PeriodicThread *thread,
+			std::string prefix);
+
+		void publish(bool do_send=true);
+
+	private:
+		gsi::PeriodicThread *stats_thread;
+
+		ParamHandle<float> ex50;
+		ParamHandle<float> ex99;
+		ParamHandle<float> ex999;
+		ParamHandle<float> exmax;
+
+		ParamHandle<float> lat50;
+		ParamHandle<float> lat99;
+		ParamHandle<float> lat999;
+		ParamHandle<float> latmax;
+
+		ParamHandle<float> per99;
+		ParamHandle<float> permax;
+
+		ParamHandle<uint32_t> cycles;
+		ParamHandle<uint32_t> overrun;
+		ParamHandle<uint32_t> skipped;
+};
+
+} // namespace gsu
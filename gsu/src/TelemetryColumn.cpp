@@ -0,0 +1,566 @@
+/*******************************************************************************
+ *
+ * File: TelemetryColumn.cpp
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include "gsu/TelemetryColumn.h"
+#include "gsu/UdpValueTableParameter.h"
+
+#include <string.h>
+
+namespace gsu
+{
+
+const char TelemetryFormat::MAGIC[8] = { 'G', 'S', 'U', 'T', 'L', 'M', 0, 1 };
+const char TelemetryFormat::INDEX_MAGIC[8] = { 'G', 'S', 'U', 'T', 'L', 'M', 'I', 'X' };
+
+/*******************************************************************************
+ *
+ * @return	the number of network bytes a value of the type has, 0 for
+ *			strings, BLOBs, and unknown types
+ *
+ ******************************************************************************/
+uint32_t TelemetryFormat::getFixedLength(uint8_t type)
+{
+	switch (type)
+	{
+		case UdpValueTableParameter::TYPE_BOOL:
+		case UdpValueTableParameter::TYPE_INT8:
+		case UdpValueTableParameter::TYPE_UINT8:		return 1;
+
+		case UdpValueTableParameter::TYPE_INT16:
+		case UdpValueTableParameter::TYPE_UINT16:		return 2;
+
+		case UdpValueTableParameter::TYPE_INT32:
+		case UdpValueTableParameter::TYPE_UINT32:
+		case UdpValueTableParameter::TYPE_FLOAT32:		return 4;
+
+		default:										return 0;
+	}
+}
+
+/*******************************************************************************
+ *
+ * Put and get little endian numbers that need no alignment.
+ *
+ ******************************************************************************/
+void TelemetryFormat::put16(uint8_t *dest, uint16_t v)
+{
+	dest[0] = (uint8_t)v;
+	dest[1] = (uint8_t)(v >> 8);
+}
+
+void TelemetryFormat::put32(uint8_t *dest, uint32_t v)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		dest[i] = (uint8_t)(v >> (i * 8));
+	}
+}
+
+void TelemetryFormat::put64(uint8_t *dest, uint64_t v)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		dest[i] = (uint8_t)(v >> (i * 8));
+	}
+}
+
+uint16_t TelemetryFormat::get16(const uint8_t *src)
+{
+	return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+uint32_t TelemetryFormat::get32(const uint8_t *src)
+{
+	uint32_t v = 0;
+	for (int i = 3; i >= 0; i--)
+	{
+		v = (v << 8) | src[i];
+	}
+	return v;
+}
+
+uint64_t TelemetryFormat::get64(const uint8_t *src)
+{
+	uint64_t v = 0;
+	for (int i = 7; i >= 0; i--)
+	{
+		v = (v << 8) | src[i];
+	}
+	return v;
+}
+
+/*******************************************************************************
+ *
+ * @return	the number of 0 bits above the highest 1 bit, v may not be 0
+ *
+ ******************************************************************************/
+static uint32_t countLeading(uint32_t v)
+{
+	uint32_t n = 0;
+	while ((v & 0x80000000) == 0)
+	{
+		v <<= 1;
+		n++;
+	}
+	return n;
+}
+
+/*******************************************************************************
+ *
+ * @return	the number of 0 bits below the lowest 1 bit, v may not be 0
+ *
+ ******************************************************************************/
+static uint32_t countTrailing(uint32_t v)
+{
+	uint32_t n = 0;
+	while ((v & 1) == 0)
+	{
+		v >>= 1;
+		n++;
+	}
+	return n;
+}
+
+/*******************************************************************************
+ *
+ * @return	the number of network bytes of a value, as a 32 bit number
+ *
+ ******************************************************************************/
+static uint32_t toNumber(const uint8_t *bytes, uint32_t length)
+{
+	uint32_t v = 0;
+	for (uint32_t i = 0; i < length; i++)
+	{
+		v = (v << 8) | bytes[i];
+	}
+	return v;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+TelemetryColumnWriter::TelemetryColumnWriter(uint16_t id, uint8_t type)
+{
+	column_id = id;
+	column_type = type;
+	reset();
+}
+
+/*******************************************************************************
+ *
+ * Empty the column for the next block.
+ *
+ ******************************************************************************/
+void TelemetryColumnWriter::reset(void)
+{
+	sample_count = 0;
+	first_time = 0;
+	last_time = 0;
+	last_delta = 0;
+
+	last_value = 0;
+	last_leading = 0;
+	last_meaningful = 0;
+
+	time_bits.clear();
+	time_bit_count = 0;
+	value_bits.clear();
+	value_bit_count = 0;
+}
+
+/*******************************************************************************
+ *
+ * Add the n low bits of v to the end of a column, highest bit first.
+ *
+ ******************************************************************************/
+void TelemetryColumnWriter::putBits(std::vector<uint8_t> &bits, uint32_t &bit_count,
+	uint64_t v, uint32_t n)
+{
+	while (n > 0)
+	{
+		if ((bit_count & 7) == 0)
+		{
+			bits.push_back(0);
+		}
+
+		uint32_t room = 8 - (bit_count & 7);
+		uint32_t take = (n < room) ? n : room;
+		uint8_t chunk = (uint8_t)((v >> (n - take)) & ((1u << take) - 1));
+
+		bits[bits.size() - 1] |= (uint8_t)(chunk << (room - take));
+		bit_count += take;
+		n -= take;
+	}
+}
+
+/*******************************************************************************
+ *
+ * Add a sample to the column.
+ *
+ * @param	time	microseconds
+ * @param	bytes	the value in network byte order
+ *
+ ******************************************************************************/
+void TelemetryColumnWriter::add(int64_t time, const uint8_t *bytes, uint16_t length)
+{
+	if (sample_count == 0)
+	{
+		first_time = time;
+	}
+	else
+	{
+		int64_t delta = time - last_time;
+		int64_t dod = delta - last_delta;
+		last_delta = delta;
+
+		if (dod == 0)
+		{
+			putBits(time_bits, time_bit_count, 0, 1);
+		}
+		else if ((dod >= -64) && (dod < 64))
+		{
+			putBits(time_bits, time_bit_count, 2, 2);
+			putBits(time_bits, time_bit_count, (uint64_t)dod, 7);
+		}
+		else if ((dod >= -256) && (dod < 256))
+		{
+			putBits(time_bits, time_bit_count, 6, 3);
+			putBits(time_bits, time_bit_count, (uint64_t)dod, 9);
+		}
+		else if ((dod >= -2048) && (dod < 2048))
+		{
+			putBits(time_bits, time_bit_count, 14, 4);
+			putBits(time_bits, time_bit_count, (uint64_t)dod, 12);
+		}
+		else
+		{
+			putBits(time_bits, time_bit_count, 15, 4);
+			putBits(time_bits, time_bit_count, (uint64_t)dod, 64);
+		}
+	}
+	last_time = time;
+
+	uint32_t fixed = TelemetryFormat::getFixedLength(column_type);
+	if (fixed == 0)
+	{
+		putBits(value_bits, value_bit_count, length, 16);
+		for (uint16_t i = 0; i < length; i++)
+		{
+			putBits(value_bits, value_bit_count, bytes[i], 8);
+		}
+	}
+	else
+	{
+		uint32_t v = toNumber(bytes, (length < fixed) ? length : fixed);
+		if (sample_count == 0)
+		{
+			putBits(value_bits, value_bit_count, v, 32);
+		}
+		else
+		{
+			uint32_t x = v ^ last_value;
+			if (x == 0)
+			{
+				putBits(value_bits, value_bit_count, 0, 1);
+			}
+			else
+			{
+				uint32_t leading = countLeading(x);
+				uint32_t trailing = countTrailing(x);
+				if (leading > 31)
+				{
+					leading = 31;
+				}
+
+				if ((last_meaningful > 0) && (leading >= last_leading) &&
+					(trailing >= 32 - last_leading - last_meaningful))
+				{
+					putBits(value_bits, value_bit_count, 2, 2);
+					putBits(value_bits, value_bit_count,
+						x >> (32 - last_leading - last_meaningful), last_meaningful);
+				}
+				else
+				{
+					uint32_t meaningful = 32 - leading - trailing;
+					putBits(value_bits, value_bit_count, 3, 2);
+					putBits(value_bits, value_bit_count, leading, 5);
+					putBits(value_bits, value_bit_count, meaningful - 1, 5);
+					putBits(value_bits, value_bit_count, x >> trailing, meaningful);
+
+					last_leading = leading;
+					last_meaningful = meaningful;
+				}
+			}
+		}
+		last_value = v;
+	}
+
+	sample_count++;
+}
+
+/*******************************************************************************
+ *
+ * @return	the number of bytes getBlock() will make
+ *
+ ******************************************************************************/
+uint32_t TelemetryColumnWriter::getBlockLength(void)
+{
+	return TelemetryFormat::BLOCK_HEADER_LENGTH + time_bits.size() + value_bits.size();
+}
+
+/*******************************************************************************
+ *
+ * Make a block of the samples added since the last reset().
+ *
+ ******************************************************************************/
+void TelemetryColumnWriter::getBlock(std::vector<uint8_t> &block)
+{
+	block.resize(getBlockLength());
+	uint8_t *b = &block[0];
+
+	TelemetryFormat::put16(&b[0], column_id);
+	b[2] = column_type;
+	b[3] = 0;
+	TelemetryFormat::put32(&b[4], sample_count);
+	TelemetryFormat::put64(&b[8], (uint64_t)first_time);
+	TelemetryFormat::put32(&b[16], time_bits.size());
+	TelemetryFormat::put32(&b[20], value_bits.size());
+
+	uint32_t offset = TelemetryFormat::BLOCK_HEADER_LENGTH;
+	if (! time_bits.empty())
+	{
+		memcpy(&b[offset], &time_bits[0], time_bits.size());
+		offset += time_bits.size();
+	}
+	if (! value_bits.empty())
+	{
+		memcpy(&b[offset], &value_bits[0], value_bits.size());
+	}
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+TelemetryColumnReader::TelemetryColumnReader(const uint8_t *block, uint32_t length)
+{
+	block_valid = false;
+	column_id = 0;
+	column_type = 0;
+	sample_count = 0;
+	sample_index = 0;
+
+	time_data = NULL;
+	time_bit_length = 0;
+	time_pos = 0;
+	last_time = 0;
+	last_delta = 0;
+
+	value_data = NULL;
+	value_bit_length = 0;
+	value_pos = 0;
+	last_value = 0;
+	last_leading = 0;
+	last_meaningful = 0;
+
+	if (length < TelemetryFormat::BLOCK_HEADER_LENGTH)
+	{
+		return;
+	}
+
+	uint32_t time_bytes = TelemetryFormat::get32(&block[16]);
+	uint32_t value_bytes = TelemetryFormat::get32(&block[20]);
+	if ((uint64_t)TelemetryFormat::BLOCK_HEADER_LENGTH + time_bytes + value_bytes > length)
+	{
+		return;
+	}
+
+	column_id = TelemetryFormat::get16(&block[0]);
+	column_type = block[2];
+	sample_count = TelemetryFormat::get32(&block[4]);
+	last_time = (int64_t)TelemetryFormat::get64(&block[8]);
+
+	time_data = &block[TelemetryFormat::BLOCK_HEADER_LENGTH];
+	time_bit_length = time_bytes * 8;
+	value_data = &time_data[time_bytes];
+	value_bit_length = value_bytes * 8;
+
+	block_valid = true;
+}
+
+/*******************************************************************************
+ *
+ * Get the next n bits of a column, false if the column ends first.
+ *
+ ******************************************************************************/
+bool TelemetryColumnReader::getBits(const uint8_t *bits, uint32_t bit_length,
+	uint32_t &bit_pos, uint32_t n, uint64_t *v)
+{
+	if (bit_pos + n > bit_length)
+	{
+		return false;
+	}
+
+	*v = 0;
+	while (n > 0)
+	{
+		uint32_t room = 8 - (bit_pos & 7);
+		uint32_t take = (n < room) ? n : room;
+		uint8_t chunk = (uint8_t)((bits[bit_pos >> 3] >> (room - take)) & ((1u << take) - 1));
+
+		*v = (*v << take) | chunk;
+		bit_pos += take;
+		n -= take;
+	}
+	return true;
+}
+
+/*******************************************************************************
+ *
+ * Get the next sample.
+ *
+ * @param	time	set to the time in microseconds
+ * @param	bytes	set to the value in network byte order, must hold
+ *					UdpValueTableParameter::VALUE_CAPACITY bytes
+ * @param	length	set to the number of bytes in the value
+ *
+ * @return	false when there are no more samples or the block is bad
+ *
+ ******************************************************************************/
+bool TelemetryColumnReader::next(int64_t *time, uint8_t *bytes, uint16_t *length)
+{
+	if ((! block_valid) || (sample_index >= sample_count))
+	{
+		return false;
+	}
+
+	uint64_t v = 0;
+	if (sample_index > 0)
+	{
+		static const uint32_t DOD_BITS[] = { 7, 9, 12, 64 };
+
+		uint32_t ones = 0;
+		while (ones < 4)
+		{
+			if (! getBits(time_data, time_bit_length, time_pos, 1, &v))
+			{
+				return (block_valid = false);
+			}
+			if (v == 0)
+			{
+				break;
+			}
+			ones++;
+		}
+
+		int64_t dod = 0;
+		if (ones > 0)
+		{
+			uint32_t n = DOD_BITS[ones - 1];
+			if (! getBits(time_data, time_bit_length, time_pos, n, &v))
+			{
+				return (block_valid = false);
+			}
+
+			// sign extend the n bit value
+			dod = (n == 64) ? (int64_t)v :
+				(int64_t)(v ^ ((uint64_t)1 << (n - 1))) - ((int64_t)1 << (n - 1));
+		}
+
+		last_delta += dod;
+		last_time += last_delta;
+	}
+	*time = last_time;
+
+	uint32_t fixed = TelemetryFormat::getFixedLength(column_type);
+	if (fixed == 0)
+	{
+		if (! getBits(value_data, value_bit_length, value_pos, 16, &v))
+		{
+			return (block_valid = false);
+		}
+
+		uint16_t n = (uint16_t)v;
+		if (n > UdpValueTableParameter::VALUE_CAPACITY)
+		{
+			return (block_valid = false);
+		}
+		for (uint16_t i = 0; i < n; i++)
+		{
+			if (! getBits(value_data, value_bit_length, value_pos, 8, &v))
+			{
+				return (block_valid = false);
+			}
+			bytes[i] = (uint8_t)v;
+		}
+		*length = n;
+	}
+	else
+	{
+		uint32_t value = 0;
+		if (sample_index == 0)
+		{
+			if (! getBits(value_data, value_bit_length, value_pos, 32, &v))
+			{
+				return (block_valid = false);
+			}
+			value = (uint32_t)v;
+		}
+		else
+		{
+			uint64_t control = 0;
+			if (! getBits(value_data, value_bit_length, value_pos, 1, &control))
+			{
+				return (block_valid = false);
+			}
+
+			value = last_value;
+			if (control != 0)
+			{
+				if (! getBits(value_data, value_bit_length, value_pos, 1, &control))
+				{
+					return (block_valid = false);
+				}
+
+				if (control != 0)
+				{
+					uint64_t leading = 0;
+					uint64_t meaningful = 0;
+					if ((! getBits(value_data, value_bit_length, value_pos, 5, &leading)) ||
+						(! getBits(value_data, value_bit_length, value_pos, 5, &meaningful)))
+					{
+						return (block_valid = false);
+					}
+					last_leading = (uint32_t)leading;
+					last_meaningful = (uint32_t)meaningful + 1;
+				}
+
+				if ((last_meaningful == 0) || (last_leading + last_meaningful > 32) ||
+					(! getBits(value_data, value_bit_length, value_pos, last_meaningful, &v)))
+				{
+					return (block_valid = false);
+				}
+				value ^= (uint32_t)v << (32 - last_leading - last_meaningful);
+			}
+		}
+		last_value = value;
+
+		for (uint32_t i = 0; i < fixed; i++)
+		{
+			bytes[i] = (uint8_t)(value >> ((fixed - 1 - i) * 8));
+		}
+		*length = (uint16_t)fixed;
+	}
+
+	sample_index++;
+	return true;
+}
+
+} // namespace gsu
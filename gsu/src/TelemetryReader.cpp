@@ -0,0 +1,442 @@
+/*******************************************************************************
+ *
+ * File: TelemetryReader.cpp
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include "gsu/TelemetryReader.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(LINUX) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define GSU_TELEMETRY_MMAP
+#endif
+
+namespace gsu
+{
+
+static const int64_t TIME_UNKNOWN = 0x7FFFFFFFFFFFFFFFLL;
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+TelemetryReader::TelemetryReader(void)
+{
+	file_data = NULL;
+	file_length = 0;
+	file_indexed = false;
+	start_time = 0.0;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+TelemetryReader::~TelemetryReader(void)
+{
+	close();
+}
+
+/*******************************************************************************
+ *
+ * Open a telemetry file and read its index.
+ *
+ * @return	false if the file could not be read or is not a telemetry file
+ *
+ ******************************************************************************/
+bool TelemetryReader::open(const char *file_name)
+{
+	close();
+
+#if defined(GSU_TELEMETRY_MMAP)
+	int fd = ::open(file_name, O_RDONLY);
+	if (fd < 0)
+	{
+		printf("TelemetryReader::open - could not open %s\n", file_name);
+		return false;
+	}
+
+	struct stat file_stat;
+	if ((fstat(fd, &file_stat) == 0) && (file_stat.st_size > 0))
+	{
+		void *memory = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (memory != MAP_FAILED)
+		{
+			file_data = (const uint8_t *)memory;
+			file_length = file_stat.st_size;
+		}
+	}
+	::close(fd);
+#else
+	FILE *file = fopen(file_name, "rb");
+	if (file == NULL)
+	{
+		printf("TelemetryReader::open - could not open %s\n", file_name);
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (length > 0)
+	{
+		uint8_t *memory = (uint8_t *)malloc(length);
+		if ((memory != NULL) && (fread(memory, 1, length, file) == (size_t)length))
+		{
+			file_data = memory;
+			file_length = length;
+		}
+		else
+		{
+			free(memory);
+		}
+	}
+	fclose(file);
+#endif
+
+	if ((file_data == NULL) || (file_length < TelemetryFormat::HEADER_LENGTH) ||
+		(memcmp(file_data, TelemetryFormat::MAGIC, sizeof(TelemetryFormat::MAGIC)) != 0) ||
+		(TelemetryFormat::get32(&file_data[8]) != TelemetryFormat::VERSION))
+	{
+		printf("TelemetryReader::open - %s is not a version %u telemetry file\n",
+			file_name, TelemetryFormat::VERSION);
+		close();
+		return false;
+	}
+
+	uint64_t bits = TelemetryFormat::get64(&file_data[16]);
+	memcpy(&start_time, &bits, sizeof(start_time));
+
+	file_indexed = readIndex();
+	if (! file_indexed)
+	{
+		parameters.clear();
+		walkBlocks();
+	}
+
+	return true;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+void TelemetryReader::close(void)
+{
+	if (file_data != NULL)
+	{
+#if defined(GSU_TELEMETRY_MMAP)
+		munmap((void *)file_data, file_length);
+#else
+		free((void *)file_data);
+#endif
+	}
+
+	file_data = NULL;
+	file_length = 0;
+	file_indexed = false;
+	start_time = 0.0;
+	parameters.clear();
+}
+
+/*******************************************************************************
+ *
+ * Find the blocks from the index at the end of the file.
+ *
+ * @return	false if the file has no index or it is bad
+ *
+ ******************************************************************************/
+bool TelemetryReader::readIndex(void)
+{
+	if (file_length < TelemetryFormat::HEADER_LENGTH + TelemetryFormat::BLOCK_HEADER_LENGTH +
+		TelemetryFormat::TRAILER_LENGTH)
+	{
+		return false;
+	}
+
+	const uint8_t *trailer = &file_data[file_length - TelemetryFormat::TRAILER_LENGTH];
+	if (memcmp(&trailer[8], TelemetryFormat::INDEX_MAGIC, sizeof(TelemetryFormat::INDEX_MAGIC)) != 0)
+	{
+		return false;
+	}
+
+	uint64_t footer = TelemetryFormat::get64(trailer);
+	uint64_t footer_end = file_length - TelemetryFormat::TRAILER_LENGTH;
+	if ((footer < TelemetryFormat::HEADER_LENGTH) ||
+		(footer + TelemetryFormat::BLOCK_HEADER_LENGTH > footer_end))
+	{
+		return false;
+	}
+
+	const uint8_t *b = &file_data[footer];
+	uint32_t count = TelemetryFormat::get32(&b[4]);
+	if ((TelemetryFormat::get16(&b[0]) != TelemetryFormat::INDEX_ID) ||
+		(b[2] != UdpValueTableParameter::TYPE_NONE) ||
+		(footer + TelemetryFormat::BLOCK_HEADER_LENGTH +
+			(uint64_t)count * TelemetryFormat::INDEX_ENTRY_LENGTH != footer_end))
+	{
+		return false;
+	}
+
+	const uint8_t *entry = &b[TelemetryFormat::BLOCK_HEADER_LENGTH];
+	for (uint32_t i = 0; i < count; i++, entry += TelemetryFormat::INDEX_ENTRY_LENGTH)
+	{
+		uint64_t offset = TelemetryFormat::get64(&entry[22]);
+		if (offset + TelemetryFormat::BLOCK_HEADER_LENGTH > footer)
+		{
+			return false;
+		}
+
+		addBlock(TelemetryFormat::get16(&entry[0]), TelemetryFormat::get32(&entry[2]),
+			(int64_t)TelemetryFormat::get64(&entry[6]),
+			(int64_t)TelemetryFormat::get64(&entry[14]), offset);
+	}
+
+	return true;
+}
+
+/*******************************************************************************
+ *
+ * Find the blocks by walking them from the header, stopping at the first
+ * one that is cut off or is the start of a footer.
+ *
+ ******************************************************************************/
+void TelemetryReader::walkBlocks(void)
+{
+	uint64_t offset = TelemetryFormat::HEADER_LENGTH;
+	while (offset + TelemetryFormat::BLOCK_HEADER_LENGTH <= file_length)
+	{
+		const uint8_t *b = &file_data[offset];
+		uint64_t length = (uint64_t)TelemetryFormat::BLOCK_HEADER_LENGTH +
+			TelemetryFormat::get32(&b[16]) + TelemetryFormat::get32(&b[20]);
+		if ((b[2] == UdpValueTableParameter::TYPE_NONE) || (offset + length > file_length))
+		{
+			break;
+		}
+
+		addBlock(TelemetryFormat::get16(&b[0]), TelemetryFormat::get32(&b[4]),
+			(int64_t)TelemetryFormat::get64(&b[8]), TIME_UNKNOWN, offset);
+		offset += length;
+	}
+}
+
+/*******************************************************************************
+ *
+ * Add a block found in the index or by walking, a block with no samples
+ * names its parameter.
+ *
+ ******************************************************************************/
+void TelemetryReader::addBlock(uint16_t id, uint32_t count, int64_t first_time,
+	int64_t last_time, uint64_t offset)
+{
+	if (id >= parameters.size())
+	{
+		Parameter empty;
+		empty.known = false;
+		empty.type = UdpValueTableParameter::TYPE_NONE;
+		empty.sample_count = 0;
+		parameters.resize(id + 1, empty);
+	}
+
+	Parameter &p = parameters[id];
+	const uint8_t *b = &file_data[offset];
+
+	if (count == 0)
+	{
+		uint32_t length = TelemetryFormat::get32(&b[20]);
+		if (offset + TelemetryFormat::BLOCK_HEADER_LENGTH + length <= file_length)
+		{
+			p.known = true;
+			p.type = b[2];
+			p.name.assign((const char *)&b[TelemetryFormat::BLOCK_HEADER_LENGTH], length);
+		}
+		return;
+	}
+
+	if (! p.known)
+	{
+		p.known = true;
+		p.type = b[2];
+	}
+
+	Block block;
+	block.offset = offset;
+	block.count = count;
+	block.first_time = first_time;
+	block.last_time = last_time;
+	p.blocks.push_back(block);
+	p.sample_count += count;
+}
+
+/*******************************************************************************
+ *
+ * @return	the parameter, NULL if the file does not have it
+ *
+ ******************************************************************************/
+TelemetryReader::Parameter *TelemetryReader::getParameter(uint16_t id)
+{
+	if ((id >= parameters.size()) || (! parameters[id].known))
+	{
+		return NULL;
+	}
+
+	return &parameters[id];
+}
+
+/*******************************************************************************
+ *
+ * Get the IDs of every parameter in the file.
+ *
+ ******************************************************************************/
+void TelemetryReader::getIds(std::vector<uint16_t> &ids)
+{
+	ids.clear();
+	for (uint32_t i = 0; i < parameters.size(); i++)
+	{
+		if (parameters[i].known)
+		{
+			ids.push_back((uint16_t)i);
+		}
+	}
+}
+
+/*******************************************************************************
+ *
+ * @return	the ID of the named parameter, 0xFFFF if the file does not
+ *			have it
+ *
+ ******************************************************************************/
+uint16_t TelemetryReader::getId(std::string name)
+{
+	for (uint32_t i = 0; i < parameters.size(); i++)
+	{
+		if (parameters[i].known && (parameters[i].name == name))
+		{
+			return (uint16_t)i;
+		}
+	}
+
+	return 0xFFFF;
+}
+
+/*******************************************************************************
+ *
+ * @return	the name of the parameter, an empty string if it is not known
+ *
+ ******************************************************************************/
+std::string TelemetryReader::getName(uint16_t id)
+{
+	Parameter *p = getParameter(id);
+	return (p == NULL) ? std::string("") : p->name;
+}
+
+/*******************************************************************************
+ *
+ * @return	the type of the parameter, TYPE_NONE if the file does not have it
+ *
+ ******************************************************************************/
+UdpValueTableParameter::DataType TelemetryReader::getType(uint16_t id)
+{
+	Parameter *p = getParameter(id);
+	return (p == NULL) ? UdpValueTableParameter::TYPE_NONE :
+		(UdpValueTableParameter::DataType)p->type;
+}
+
+/*******************************************************************************
+ *
+ * @return	the number of samples of the parameter in the file
+ *
+ ******************************************************************************/
+uint32_t TelemetryReader::getSampleCount(uint16_t id)
+{
+	Parameter *p = getParameter(id);
+	return (p == NULL) ? 0 : p->sample_count;
+}
+
+/*******************************************************************************
+ *
+ * Get the samples of a parameter of any type that are between two times,
+ * each value is its bytes in network byte order.
+ *
+ * @return	the number of samples added
+ *
+ ******************************************************************************/
+uint32_t TelemetryReader::scanBytes(uint16_t id, std::vector<double> &times,
+	std::vector<std::string> &values, double start, double end)
+{
+	return scanBlocks(id, start, end, times, &values, NULL);
+}
+
+/*******************************************************************************
+ *
+ * Decode the parameter's blocks that overlap the times and add the samples
+ * that are between them.
+ *
+ * @param	byte_values		if not NULL, each value is added as a string
+ * @param	number_bytes	if not NULL, each value's bytes are appended
+ *
+ * @return	the number of samples added
+ *
+ ******************************************************************************/
+uint32_t TelemetryReader::scanBlocks(uint16_t id, double start, double end,
+	std::vector<double> &times, std::vector<std::string> *byte_values,
+	std::vector<uint8_t> *number_bytes)
+{
+	Parameter *p = getParameter(id);
+	if (p == NULL)
+	{
+		return 0;
+	}
+
+	uint32_t added = 0;
+	uint8_t bytes[UdpValueTableParameter::VALUE_CAPACITY];
+
+	for (uint32_t i = 0; i < p->blocks.size(); i++)
+	{
+		Block &block = p->blocks[i];
+		if ((block.first_time / 1000000.0 > end) ||
+			((block.last_time != TIME_UNKNOWN) && (block.last_time / 1000000.0 < start)))
+		{
+			continue;
+		}
+
+		TelemetryColumnReader reader(&file_data[block.offset], file_length - block.offset);
+		int64_t time;
+		uint16_t length;
+		while (reader.next(&time, bytes, &length))
+		{
+			double seconds = time / 1000000.0;
+			if (seconds < start)
+			{
+				continue;
+			}
+			if (seconds > end)
+			{
+				break;
+			}
+
+			times.push_back(seconds);
+			if (byte_values != NULL)
+			{
+				byte_values->push_back(std::string((const char *)bytes, length));
+			}
+			if (number_bytes != NULL)
+			{
+				number_bytes->insert(number_bytes->end(), bytes, bytes + length);
+			}
+			added++;
+		}
+	}
+
+	return added;
+}
+
+} // namespace gsu
@@ -0,0 +1,524 @@
+/*******************************************************************************
+ *
+ * File: TelemetryRecorder.cpp
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include "gsu/TelemetryRecorder.h"
+#include "gsu/UdpValueTable.h"
+
+#include "gsi/Time.h"
+
+#include <string.h>
+
+namespace gsu
+{
+
+/*******************************************************************************
+ *
+ * Takes the samples out of a recorder's rings and writes them to its file.
+ *
+ ******************************************************************************/
+class TelemetryWriter : public gsi::Thread
+{
+	public:
+		TelemetryWriter(TelemetryRecorder *recorder, ThreadPriority priority)
+			: gsi::Thread("TelemetryWriter", priority)
+		{
+			writer_recorder = recorder;
+		}
+
+	protected:
+		void run(void)
+		{
+			while (! isStopRequested())
+			{
+				if (writer_recorder->drain() == 0)
+				{
+					sleep(TelemetryRecorder::WRITE_PERIOD);
+				}
+			}
+		}
+
+	private:
+		TelemetryRecorder *writer_recorder;
+};
+
+const double TelemetryRecorder::WRITE_PERIOD = 0.02;
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+TelemetryRecorder::TelemetryRecorder(void)
+{
+	recorder_file = NULL;
+	recorder_table = NULL;
+	start_time = 0.0;
+	file_offset = 0;
+	block_count = 0;
+
+	is_recording = 0;
+	active_count = 0;
+	drop_count = 0;
+	ring_count = 0;
+	for (uint32_t i = 0; i < MAX_THREADS; i++)
+	{
+		rings[i] = NULL;
+		ring_owners[i] = 0;
+		ring_ready[i] = 0;
+	}
+
+	writer = NULL;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+TelemetryRecorder::~TelemetryRecorder(void)
+{
+	close();
+}
+
+/*******************************************************************************
+ *
+ * Start recording into the file.
+ *
+ * @param	table		if not NULL, the table to record, its current values
+ *						are recorded right away
+ * @param	priority	the priority of the thread that writes the file
+ *
+ * @return	true if the file was opened
+ *
+ ******************************************************************************/
+bool TelemetryRecorder::open(const char *file_name, UdpValueTable *table,
+	gsi::Thread::ThreadPriority priority)
+{
+	{
+		gsi::MutexScopeLock lock(recorder_lock);
+
+		if (recorder_file != NULL)
+		{
+			printf("TelemetryRecorder::open - already open\n");
+			return false;
+		}
+
+		FILE *file = fopen(file_name, "wb");
+		if (file == NULL)
+		{
+			printf("TelemetryRecorder::open - could not open %s\n", file_name);
+			return false;
+		}
+
+		double wall_time = gsi::Time::getTime();
+		start_time = gsi::Time::getMonotonicTime();
+
+		uint64_t bits[2];
+		memcpy(&bits[0], &wall_time, sizeof(bits[0]));
+		memcpy(&bits[1], &start_time, sizeof(bits[1]));
+
+		uint8_t header[TelemetryFormat::HEADER_LENGTH];
+		memcpy(&header[0], TelemetryFormat::MAGIC, sizeof(TelemetryFormat::MAGIC));
+		TelemetryFormat::put32(&header[8], TelemetryFormat::VERSION);
+		TelemetryFormat::put32(&header[12], 0);
+		TelemetryFormat::put64(&header[16], bits[0]);
+		TelemetryFormat::put64(&header[24], bits[1]);
+		fwrite(header, 1, sizeof(header), file);
+
+		recorder_file = file;
+		recorder_table = table;
+		file_offset = sizeof(header);
+		block_count = 0;
+		index_buffer.clear();
+		drop_count = 0;
+
+		gsi::Atomic::storeRelease(&is_recording, 1);
+
+		writer = new TelemetryWriter(this, priority);
+		writer->start();
+	}
+
+	// the table records through record(), so it is attached without the lock
+	if (table != NULL)
+	{
+		table->setTelemetryRecorder(this);
+	}
+
+	return true;
+}
+
+/*******************************************************************************
+ *
+ * Write the samples that are left and the index, and close the file.
+ *
+ ******************************************************************************/
+void TelemetryRecorder::close(void)
+{
+	if (recorder_table != NULL)
+	{
+		recorder_table->setTelemetryRecorder(NULL);
+	}
+
+	gsi::MutexScopeLock lock(recorder_lock);
+
+	if (recorder_file == NULL)
+	{
+		return;
+	}
+
+	// stop taking samples and wait for the record() calls that already
+	// saw is_recording set to finish with their rings
+	gsi::Atomic::storeRelease(&is_recording, 0);
+	gsi::Atomic::fence();
+	while (gsi::Atomic::loadAcquire(&active_count) != 0)
+	{
+		gsi::Thread::sleep(0.0001);
+	}
+
+	writer->requestStop();
+	while (writer->isRunning())
+	{
+		gsi::Thread::sleep(0.001);
+	}
+	delete writer;
+	writer = NULL;
+
+	drain();
+	freeRings();
+
+	for (uint32_t i = 0; i < columns.size(); i++)
+	{
+		if (columns[i] != NULL)
+		{
+			if (columns[i]->getCount() > 0)
+			{
+				writeColumn(columns[i]);
+			}
+			delete columns[i];
+		}
+	}
+	columns.clear();
+
+	uint8_t header[TelemetryFormat::BLOCK_HEADER_LENGTH];
+	memset(header, 0, sizeof(header));
+	TelemetryFormat::put16(&header[0], TelemetryFormat::INDEX_ID);
+	TelemetryFormat::put32(&header[4], block_count);
+	TelemetryFormat::put32(&header[20], index_buffer.size());
+	fwrite(header, 1, sizeof(header), recorder_file);
+	if (! index_buffer.empty())
+	{
+		fwrite(&index_buffer[0], 1, index_buffer.size(), recorder_file);
+	}
+
+	uint8_t bytes[8];
+	TelemetryFormat::put64(bytes, file_offset);
+	fwrite(bytes, 1, 8, recorder_file);
+	fwrite(TelemetryFormat::INDEX_MAGIC, 1, sizeof(TelemetryFormat::INDEX_MAGIC), recorder_file);
+
+	fclose(recorder_file);
+	recorder_file = NULL;
+	recorder_table = NULL;
+	index_buffer.clear();
+}
+
+/*******************************************************************************
+ *
+ * Record a value of a parameter.  The value is copied into the calling
+ * thread's ring, it is compressed and written by the writer thread.
+ *
+ * @param	bytes	the value in network byte order
+ *
+ ******************************************************************************/
+void TelemetryRecorder::record(uint16_t id, uint8_t type, const uint8_t *bytes,
+	uint16_t length)
+{
+	if (type == UdpValueTableParameter::TYPE_NONE)
+	{
+		return;
+	}
+
+	// counted before is_recording is read, close() sets it the other way
+	gsi::Atomic::fetchAdd(&active_count, 1);
+	gsi::Atomic::fence();
+
+	if (gsi::Atomic::loadAcquire(&is_recording))
+	{
+		SampleRing *ring = getRing();
+		uint32_t head = (ring == NULL) ? 0 : ring->head;
+
+		if ((ring == NULL) || (head - gsi::Atomic::loadAcquire(&ring->tail) >= RING_SIZE))
+		{
+			gsi::Atomic::fetchAdd(&drop_count, 1);
+		}
+		else
+		{
+			if (length > UdpValueTableParameter::VALUE_CAPACITY)
+			{
+				length = UdpValueTableParameter::VALUE_CAPACITY;
+			}
+
+			Sample *sample = &ring->samples[head & (RING_SIZE - 1)];
+			sample->time = (int64_t)((gsi::Time::getMonotonicTime() - start_time) * 1000000.0);
+			sample->id = id;
+			sample->type = type;
+			sample->length = length;
+			memcpy(sample->bytes, bytes, length);
+
+			gsi::Atomic::storeRelease(&ring->head, head + 1);
+		}
+	}
+
+	gsi::Atomic::fetchAdd(&active_count, (uint32_t)-1);
+}
+
+/*******************************************************************************
+ *
+ * @return	the number of samples that were dropped because a thread's ring
+ *			was full or there were more than MAX_THREADS threads
+ *
+ ******************************************************************************/
+uint32_t TelemetryRecorder::getDropCount(void)
+{
+	return gsi::Atomic::loadAcquire(&drop_count);
+}
+
+/*******************************************************************************
+ *
+ * @return	the calling thread's ring, made the first time the thread
+ *			records, NULL if MAX_THREADS threads already have rings
+ *
+ ******************************************************************************/
+TelemetryRecorder::SampleRing *TelemetryRecorder::getRing(void)
+{
+	int64_t id = gsi::Thread::getCurrentId();
+
+	uint32_t count = gsi::Atomic::loadAcquire(&ring_count);
+	if (count > MAX_THREADS)
+	{
+		count = MAX_THREADS;
+	}
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (gsi::Atomic::loadAcquire(&ring_ready[i]) && (ring_owners[i] == id))
+		{
+			return rings[i];
+		}
+	}
+
+	uint32_t index = gsi::Atomic::fetchAdd(&ring_count, 1);
+	if (index >= MAX_THREADS)
+	{
+		return NULL;
+	}
+
+	SampleRing *ring = new SampleRing;
+	ring->head = 0;
+	ring->tail = 0;
+
+	rings[index] = ring;
+	ring_owners[index] = id;
+	gsi::Atomic::storeRelease(&ring_ready[index], 1);
+
+	return ring;
+}
+
+/*******************************************************************************
+ *
+ * Write the samples queued in every ring, oldest first, so each column's
+ * times go forward even when several threads set the same parameter.
+ *
+ * @return	the number of samples written
+ *
+ ******************************************************************************/
+uint32_t TelemetryRecorder::drain(void)
+{
+	uint32_t count = gsi::Atomic::loadAcquire(&ring_count);
+	if (count > MAX_THREADS)
+	{
+		count = MAX_THREADS;
+	}
+
+	// only what was queued when the drain started, so a busy thread can't
+	// keep the others' samples waiting
+	SampleRing *ready[MAX_THREADS];
+	uint32_t heads[MAX_THREADS];
+	uint32_t ready_count = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (gsi::Atomic::loadAcquire(&ring_ready[i]))
+		{
+			ready[ready_count] = rings[i];
+			heads[ready_count] = gsi::Atomic::loadAcquire(&rings[i]->head);
+			ready_count++;
+		}
+	}
+
+	uint32_t written = 0;
+	while (true)
+	{
+		Sample *oldest = NULL;
+		uint32_t oldest_ring = 0;
+		for (uint32_t i = 0; i < ready_count; i++)
+		{
+			uint32_t tail = ready[i]->tail;
+			if (tail != heads[i])
+			{
+				Sample *sample = &ready[i]->samples[tail & (RING_SIZE - 1)];
+				if ((oldest == NULL) || (sample->time < oldest->time))
+				{
+					oldest = sample;
+					oldest_ring = i;
+				}
+			}
+		}
+
+		if (oldest == NULL)
+		{
+			break;
+		}
+
+		writeSample(oldest);
+		gsi::Atomic::storeRelease(&ready[oldest_ring]->tail, ready[oldest_ring]->tail + 1);
+		written++;
+	}
+
+	return written;
+}
+
+/*******************************************************************************
+ *
+ * Free the rings, only once nothing can record into them.
+ *
+ ******************************************************************************/
+void TelemetryRecorder::freeRings(void)
+{
+	for (uint32_t i = 0; i < MAX_THREADS; i++)
+	{
+		delete rings[i];
+		rings[i] = NULL;
+		ring_owners[i] = 0;
+		ring_ready[i] = 0;
+	}
+	gsi::Atomic::storeRelease(&ring_count, 0);
+}
+
+/*******************************************************************************
+ *
+ * Add a sample to its parameter's column, and write the column when it is
+ * full.
+ *
+ ******************************************************************************/
+void TelemetryRecorder::writeSample(const Sample *sample)
+{
+	TelemetryColumnWriter *column = getColumn(sample->id, sample->type);
+	if (column == NULL)
+	{
+		return;
+	}
+
+	column->add(sample->time, sample->bytes, sample->length);
+
+	if ((column->getCount() >= CHUNK_SAMPLES) || (column->getBlockLength() >= CHUNK_BYTES))
+	{
+		writeColumn(column);
+	}
+}
+
+/*******************************************************************************
+ *
+ * @return	the column for the parameter, made and its name written the
+ *			first time, or NULL if the parameter was seen with another type
+ *
+ ******************************************************************************/
+TelemetryColumnWriter *TelemetryRecorder::getColumn(uint16_t id, uint8_t type)
+{
+	if (id >= columns.size())
+	{
+		columns.resize(id + 1, NULL);
+	}
+
+	if (columns[id] == NULL)
+	{
+		columns[id] = new TelemetryColumnWriter(id, type);
+
+		std::string name;
+		if (recorder_table != NULL)
+		{
+			name = recorder_table->getName(id);
+		}
+		writeName(id, type, name);
+	}
+	else if (columns[id]->getType() != type)
+	{
+		return NULL;
+	}
+
+	return columns[id];
+}
+
+/*******************************************************************************
+ *
+ * Write a block with no samples that has the parameter's name as its values.
+ *
+ ******************************************************************************/
+void TelemetryRecorder::writeName(uint16_t id, uint8_t type, const std::string &name)
+{
+	uint32_t length = (name.size() < 255) ? name.size() : 255;
+
+	block_buffer.resize(TelemetryFormat::BLOCK_HEADER_LENGTH + length);
+	uint8_t *b = &block_buffer[0];
+	memset(b, 0, TelemetryFormat::BLOCK_HEADER_LENGTH);
+	TelemetryFormat::put16(&b[0], id);
+	b[2] = type;
+	TelemetryFormat::put32(&b[20], length);
+	memcpy(&b[TelemetryFormat::BLOCK_HEADER_LENGTH], name.data(), length);
+
+	writeBlock(id, 0, 0, 0);
+}
+
+/*******************************************************************************
+ *
+ * Write a column's samples as a block and start the column over.
+ *
+ ******************************************************************************/
+void TelemetryRecorder::writeColumn(TelemetryColumnWriter *column)
+{
+	column->getBlock(block_buffer);
+	writeBlock(column->getId(), column->getCount(), column->getFirstTime(),
+		column->getLastTime());
+	column->reset();
+}
+
+/*******************************************************************************
+ *
+ * Write block_buffer to the file and add it to the index.
+ *
+ ******************************************************************************/
+void TelemetryRecorder::writeBlock(uint16_t id, uint32_t count, int64_t first_time,
+	int64_t last_time)
+{
+	uint32_t length = block_buffer.size();
+	if (fwrite(&block_buffer[0], 1, length, recorder_file) != length)
+	{
+		printf("TelemetryRecorder::writeBlock - write failed\n");
+	}
+
+	uint8_t entry[TelemetryFormat::INDEX_ENTRY_LENGTH];
+	TelemetryFormat::put16(&entry[0], id);
+	TelemetryFormat::put32(&entry[2], count);
+	TelemetryFormat::put64(&entry[6], (uint64_t)first_time);
+	TelemetryFormat::put64(&entry[14], (uint64_t)last_time);
+	TelemetryFormat::put64(&entry[22], file_offset);
+	index_buffer.insert(index_buffer.end(), entry, entry + sizeof(entry));
+
+	// the block length is not in the entry, it is in the block's header
+	file_offset += length;
+	block_count++;
+}
+
+} // namespace gsu
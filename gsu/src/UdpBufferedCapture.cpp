@@ -0,0 +1,275 @@
+/*******************************************************************************
+ *
+ * File: UdpBufferedCapture.cpp
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include "gsu/UdpBufferedCapture.h"
+
+#include "gsi/Time.h"
+
+#include <string.h>
+
+namespace gsi
+{
+
+const char UdpBufferedCapture::MAGIC[8] = { 'G', 'S', 'U', 'C', 'A', 'P', 0, 1 };
+
+/*******************************************************************************
+ *
+ * Put and get little endian numbers.
+ *
+ ******************************************************************************/
+static void put32(uint8_t *dest, uint32_t v)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		dest[i] = (uint8_t)(v >> (i * 8));
+	}
+}
+
+static void putDouble(uint8_t *dest, double d)
+{
+	uint64_t v;
+	memcpy(&v, &d, sizeof(v));
+	for (int i = 0; i < 8; i++)
+	{
+		dest[i] = (uint8_t)(v >> (i * 8));
+	}
+}
+
+static uint32_t get32(const uint8_t *src)
+{
+	uint32_t v = 0;
+	for (int i = 3; i >= 0; i--)
+	{
+		v = (v << 8) | src[i];
+	}
+	return v;
+}
+
+static double getDouble(const uint8_t *src)
+{
+	uint64_t v = 0;
+	for (int i = 7; i >= 0; i--)
+	{
+		v = (v << 8) | src[i];
+	}
+
+	double d;
+	memcpy(&d, &v, sizeof(d));
+	return d;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+UdpBufferedCapture::UdpBufferedCapture(void)
+{
+	capture_file = NULL;
+	capture_writing = false;
+	start_time = 0.0;
+	start_monotonic = 0.0;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+UdpBufferedCapture::~UdpBufferedCapture(void)
+{
+	close();
+}
+
+/*******************************************************************************
+ *
+ * Start a new capture file.
+ *
+ * @return	true if the file was opened
+ *
+ ******************************************************************************/
+bool UdpBufferedCapture::openWrite(const char *file_name)
+{
+	MutexScopeLock lock(capture_lock);
+
+	if (capture_file != NULL)
+	{
+		printf("UdpBufferedCapture::openWrite - already open\n");
+		return false;
+	}
+
+	FILE *file = fopen(file_name, "wb");
+	if (file == NULL)
+	{
+		printf("UdpBufferedCapture::openWrite - could not open %s\n", file_name);
+		return false;
+	}
+
+	start_time = Time::getTime();
+	start_monotonic = Time::getMonotonicTime();
+
+	uint8_t header[HEADER_LENGTH];
+	memcpy(&header[0], MAGIC, sizeof(MAGIC));
+	put32(&header[8], VERSION);
+	put32(&header[12], 0);
+	putDouble(&header[16], start_time);
+	fwrite(header, 1, sizeof(header), file);
+
+	capture_file = file;
+	capture_writing = true;
+	return true;
+}
+
+/*******************************************************************************
+ *
+ * Open a capture file to read its packets.
+ *
+ * @return	false if the file could not be opened or is not a capture
+ *
+ ******************************************************************************/
+bool UdpBufferedCapture::openRead(const char *file_name)
+{
+	MutexScopeLock lock(capture_lock);
+
+	if (capture_file != NULL)
+	{
+		printf("UdpBufferedCapture::openRead - already open\n");
+		return false;
+	}
+
+	FILE *file = fopen(file_name, "rb");
+	if (file == NULL)
+	{
+		printf("UdpBufferedCapture::openRead - could not open %s\n", file_name);
+		return false;
+	}
+
+	uint8_t header[HEADER_LENGTH];
+	if ((fread(header, 1, sizeof(header), file) != sizeof(header)) ||
+		(memcmp(header, MAGIC, sizeof(MAGIC)) != 0) || (get32(&header[8]) != VERSION))
+	{
+		printf("UdpBufferedCapture::openRead - %s is not a version %u capture\n",
+			file_name, VERSION);
+		fclose(file);
+		return false;
+	}
+
+	start_time = getDouble(&header[16]);
+	capture_file = file;
+	capture_writing = false;
+	return true;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+void UdpBufferedCapture::close(void)
+{
+	MutexScopeLock lock(capture_lock);
+
+	if (capture_file != NULL)
+	{
+		fclose(capture_file);
+		capture_file = NULL;
+	}
+}
+
+/*******************************************************************************
+ *
+ * Add a packet to a capture opened with openWrite(), nothing is done if it
+ * is not open.
+ *
+ * @param	monotonic_time	when the packet was received, from
+ *							Time::getMonotonicTime()
+ * @param	packet			the packet as received, in network byte order
+ *
+ ******************************************************************************/
+void UdpBufferedCapture::write(double monotonic_time, const void *packet,
+	uint32_t length)
+{
+	MutexScopeLock lock(capture_lock);
+
+	if ((capture_file == NULL) || (! capture_writing))
+	{
+		return;
+	}
+
+	uint8_t header[RECORD_HEADER_LENGTH];
+	putDouble(&header[0], monotonic_time - start_monotonic);
+	put32(&header[8], length);
+
+	if ((fwrite(header, 1, sizeof(header), capture_file) != sizeof(header)) ||
+		(fwrite(packet, 1, length, capture_file) != length))
+	{
+		printf("UdpBufferedCapture::write - write failed, capture stopped\n");
+		fclose(capture_file);
+		capture_file = NULL;
+	}
+}
+
+/*******************************************************************************
+ *
+ * Write the packets added so far to the file.
+ *
+ ******************************************************************************/
+void UdpBufferedCapture::flush(void)
+{
+	MutexScopeLock lock(capture_lock);
+
+	if ((capture_file != NULL) && capture_writing)
+	{
+		fflush(capture_file);
+	}
+}
+
+/*******************************************************************************
+ *
+ * Get the next packet of a capture opened with openRead().
+ *
+ * @param	time		set to the seconds since the capture started
+ * @param	packet		set to the packet as it was received
+ * @param	length		set to the number of bytes in the packet
+ * @param	max_length	the number of bytes packet can hold, longer
+ *						packets are cut off
+ *
+ * @return	false at the end of the capture
+ *
+ ******************************************************************************/
+bool UdpBufferedCapture::read(double *time, void *packet, uint32_t *length,
+	uint32_t max_length)
+{
+	MutexScopeLock lock(capture_lock);
+
+	if ((capture_file == NULL) || capture_writing)
+	{
+		return false;
+	}
+
+	uint8_t header[RECORD_HEADER_LENGTH];
+	if (fread(header, 1, sizeof(header), capture_file) != sizeof(header))
+	{
+		return false;
+	}
+
+	*time = getDouble(&header[0]);
+	uint32_t n = get32(&header[8]);
+	uint32_t keep = (n < max_length) ? n : max_length;
+
+	if (fread(packet, 1, keep, capture_file) != keep)
+	{
+		return false;
+	}
+	if ((n > keep) && (fseek(capture_file, n - keep, SEEK_CUR) != 0))
+	{
+		return false;
+	}
+
+	*length = keep;
+	return true;
+}
+
+} // namespace gsi
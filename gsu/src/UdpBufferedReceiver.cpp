@@ -11,24 +11,65 @@
  ******************************************************************************/
 #include "gsu/UdpBufferedReceiver.h"
 
+#include "gsi/Time.h"
 
 namespace gsi
 {
 
+/*******************************************************************************
+ *
+ * Writes the packets a receiver queued for its capture to the file, so the
+ * receive thread never waits on the disk.
+ *
+ ******************************************************************************/
+class UdpBufferedCaptureWriter : public Thread
+{
+	public:
+		UdpBufferedCaptureWriter(UdpBufferedReceiver *receiver)
+			: Thread("UdpBufferedCaptureWriter", PRIORITY_LOWEST)
+		{
+			writer_receiver = receiver;
+		}
+
+	protected:
+		void run(void)
+		{
+			while (! isStopRequested())
+			{
+				if (writer_receiver->drainCapture() == 0)
+				{
+					sleep(UdpBufferedReceiver::CAPTURE_WRITE_PERIOD);
+				}
+			}
+		}
+
+	private:
+		UdpBufferedReceiver *writer_receiver;
+};
+
+const double UdpBufferedReceiver::CAPTURE_WRITE_PERIOD = 0.02;
+
 /*******************************************************************************
  *
  ******************************************************************************/
 UdpBufferedReceiver::UdpBufferedReceiver(std::string name, std::string host, 
 	uint16_t port, uint16_t max_length, uint16_t max_count, double interval, 
 	int32_t priority) :
-	Thread(name)
+	Thread(name, (ThreadPriority)priority)
 {
-	head_idx = 0;
-	tail_idx = 0;
 	src_socket = NULL;
+	src_reactor = NULL;
 
 	buffer = NULL;
+	drop_count = 0;
 	receive_packet = NULL;
+	is_replay = false;
+
+	capture_ring = NULL;
+	capture_writer = NULL;
+	is_capturing = 0;
+	capture_active = 0;
+	capture_drop_count = 0;
 	
 	src_host = host;
 	src_port = port;
@@ -50,6 +91,9 @@ UdpBufferedReceiver::UdpBufferedReceiver(std::string name, std::string host,
 UdpBufferedReceiver::~UdpBufferedReceiver()
 {
 	printf("UdpReceiver::~UdpReceiver\n");
+
+	detach();
+	stopCapture();
 	
 	// close socket
 	if (src_socket != NULL)
@@ -66,7 +110,7 @@ UdpBufferedReceiver::~UdpBufferedReceiver()
 
 	if (receive_packet != NULL)
 	{
-		delete receive_packet;
+		delete[] (uint8_t *)receive_packet;
 		receive_packet = NULL;
 	}
 }
@@ -76,6 +120,12 @@ UdpBufferedReceiver::~UdpBufferedReceiver()
  ******************************************************************************/
 void UdpBufferedReceiver::init()
 {
+	if (is_replay)
+	{
+		printf("ERROR: UdpReceiver %s is open for replay, it has no socket\n", getName().c_str());
+		return;
+	}
+
 	if ((src_port <= 0) || (src_host.length() < 1))
 	{
 		printf("ERROR: UdpReceiver did not attempt to create socket, invalid config\n");
@@ -85,11 +135,11 @@ void UdpBufferedReceiver::init()
 	src_socket = new UdpSocket(src_host, src_port);
 	if (src_socket == NULL)
 	{
-		printf("ERROR: UdpReceiver could not create socket (ret=%d, err = %d)\n", (int)src_socket, errno);
+		printf("ERROR: UdpReceiver could not create socket (err = %d)\n", errno);
 		return;
 	}
 
-	receive_packet = new UdpBufferedPacket();
+	receive_packet = (UdpBufferedPacket *)(new uint8_t[max_packet_size + 1]);
 	if (receive_packet == NULL) 
 	{
 		printf("ERROR: UdpReceiver could not allocate receive packet\n");
@@ -98,13 +148,11 @@ void UdpBufferedReceiver::init()
 		return;
 	}
 
-	buffer = new uint8_t[max_packet_size * max_packet_count];
-	if (buffer == NULL)
+	if (! initBuffer())
 	{
-		printf("ERROR: UdpReceiver could not allocate buffer space\n");
 		delete src_socket;
 		src_socket = NULL;
-		delete receive_packet;
+		delete[] (uint8_t *)receive_packet;
 		receive_packet = NULL;
 		return;
 	}
@@ -113,13 +161,36 @@ void UdpBufferedReceiver::init()
 }
 
 /*******************************************************************************
+ *
+ * Make the buffer the packets are received into.
+ *
+ * @return	true if the buffer was made
  *
  ******************************************************************************/
-void UdpBufferedReceiver::run(void)
+bool UdpBufferedReceiver::initBuffer(void)
 {
-	std::string from;
-	uint16_t fromlen;
+	// one extra byte per slot so the data can always be null terminated
+	buffer = new UdpBufferedRing(max_packet_size + 1, max_packet_count);
+	if ((buffer == NULL) || (! buffer->isValid()))
+	{
+		printf("ERROR: UdpReceiver could not allocate buffer space\n");
+		delete buffer;
+		buffer = NULL;
+		return false;
+	}
+
+	return true;
+}
 
+/*******************************************************************************
+ *
+ * Receive packets directly into the buffer until a stop is requested.  This
+ * thread is the only producer for the buffer so it never waits on the thread
+ * that calls getPacket().
+ *
+ ******************************************************************************/
+void UdpBufferedReceiver::run(void)
+{
 	init();
 	
 	if ((src_socket == NULL) || (buffer == NULL) || (receive_packet == NULL))
@@ -133,38 +204,7 @@ void UdpBufferedReceiver::run(void)
 	{
 		try
 		{
-            uint32_t ret = src_socket->recvFrom((void *)receive_packet,
-                 max_packet_size, from, fromlen);
-
-            if (ret >= 0)
-			{
-                buffer_lock.lock();
-				try
-				{	
-					if (ntohs(receive_packet->sync) == UDP_BUFFERED_SYNC_0)
-					{
-						UdpBufferedPacket *pkt = (UdpBufferedPacket *)&(buffer[head_idx * max_packet_size]);
-						pkt->sync 		= ntohs(receive_packet->sync);
-						pkt->flags 	    = ntohs(receive_packet->flags);
-						pkt->type 		= ntohs(receive_packet->type);
-						pkt->length 	= ntohs(receive_packet->length);
-	
-                        memcpy(pkt->data, receive_packet->data, pkt->length);
-                        pkt->data[pkt->length] = 0;
-
-						head_idx = (head_idx + 1) % max_packet_count;
-		
-						// if the buffer is full, the oldest is lost
-						if (head_idx == tail_idx)
-						{
-							tail_idx = (tail_idx + 1) % max_packet_count;
-						}
-					}
-				}
-				catch (...) {}
-				buffer_lock.unlock();
-			}
-			else
+			if (receivePacket() < 0)
 			{
 				sleep(pkt_interval);
 			}
@@ -177,37 +217,458 @@ void UdpBufferedReceiver::run(void)
 }
 
 /*******************************************************************************
+ *
+ * Create the socket and have the reactor call socketReadable() when
+ * packets arrive, instead of starting a thread for this receiver.
+ *
+ * @return	true if the receiver is attached
+ *
+ ******************************************************************************/
+bool UdpBufferedReceiver::attach(SocketReactor *reactor)
+{
+	if ((reactor == NULL) || (src_reactor != NULL))
+	{
+		return false;
+	}
+
+	init();
+
+	if ((src_socket == NULL) || (buffer == NULL) || (receive_packet == NULL))
+	{
+		printf("UdpReceiver::attach: cannot attach, initialization failed\n");
+		return false;
+	}
+
+	if (! reactor->addSocket(src_socket, this))
+	{
+		return false;
+	}
+
+	src_reactor = reactor;
+	return true;
+}
+
+/*******************************************************************************
+ *
+ * Stop being serviced by the reactor given to attach().
+ *
+ ******************************************************************************/
+void UdpBufferedReceiver::detach(void)
+{
+	if (src_reactor != NULL)
+	{
+		src_reactor->removeSocket(src_socket);
+		src_reactor = NULL;
+	}
+}
+
+/*******************************************************************************
+ *
+ * Called by the reactor when packets arrive, receive until the socket is
+ * empty.  The socket is always this receiver's own.
+ *
+ ******************************************************************************/
+void UdpBufferedReceiver::socketReadable(UdpSocket *)
+{
+	while (receivePacket() >= 0)
+	{
+	}
+}
+
+/*******************************************************************************
+ *
+ * Wait for packets then move as many as are available, up to the free space
+ * in the buffer, straight from the socket into the buffer with one system
+ * call.  When attached to a reactor the socket does not wait.
+ *
+ * @return	the number of packets taken from the socket, including ones
+ *			that were bad or dropped, or -1 if none could be received
+ *
+ ******************************************************************************/
+int32_t UdpBufferedReceiver::receivePacket(void)
+{
+	uint8_t *slots[RECEIVE_BATCH_COUNT];
+	uint32_t lengths[RECEIVE_BATCH_COUNT];
+
+	uint32_t slot_count = buffer->reserve(slots, RECEIVE_BATCH_COUNT);
+	if (slot_count == 0)
+	{
+		// if the buffer is full, the newest is lost
+		std::string from;
+		uint16_t from_port;
+
+		int32_t ret = src_socket->recvFrom((void *)receive_packet,
+			max_packet_size, from, from_port);
+
+		if (ret < 0)
+		{
+			return -1;
+		}
+
+		uint8_t *packet = (uint8_t *)receive_packet;
+		uint32_t length = ret;
+		queueCapture(Time::getMonotonicTime(), &packet, &length, 1);
+		
+		if (decodePacket(receive_packet, ret))
+		{
+			Atomic::fetchAdd(&drop_count, 1);
+		}
+		return 1;
+	}
+
+	int32_t count = src_socket->recvFromBatch((void **)slots, max_packet_size,
+		lengths, slot_count);
+
+	if (count < 0)
+	{
+		return -1;
+	}
+
+	// capture the packets before they are decoded in place
+	queueCapture(Time::getMonotonicTime(), slots, lengths, count);
+
+	// keep the good packets together at the front of the reserved slots
+	uint32_t good_count = 0;
+	for (int32_t i = 0; i < count; i++)
+	{
+		UdpBufferedPacket *pkt = (UdpBufferedPacket *)slots[i];
+		if (decodePacket(pkt, lengths[i]))
+		{
+			if (good_count != (uint32_t)i)
+			{
+				memcpy(slots[good_count], pkt,
+					UDP_BUFFERED_HEADER_SIZE + pkt->length + 1);
+			}
+			good_count++;
+		}
+	}
+
+	buffer->commit(good_count);
+	return count;
+}
+
+/*******************************************************************************
+ *
+ * Convert the header of a received packet to host byte order in place and
+ * null terminate the data.
+ *
+ * @param	pkt		the packet as received, must have space for one byte
+ *					after the received length
+ * @param	length	the number of bytes received
+ *
+ * @return	true if the packet is valid
+ *
+ ******************************************************************************/
+bool UdpBufferedReceiver::decodePacket(UdpBufferedPacket *pkt, int32_t length)
+{
+	if ((length < UDP_BUFFERED_HEADER_SIZE) ||
+		((ntohs(pkt->sync) != UDP_BUFFERED_SYNC_0) &&
+		 (ntohs(pkt->sync) != UDP_BUFFERED_SYNC_1)))
+	{
+		return false;
+	}
+
+	pkt->sync 		= ntohs(pkt->sync);
+	pkt->flags 	    = ntohs(pkt->flags);
+	pkt->type 		= ntohs(pkt->type);
+	pkt->length 	= ntohs(pkt->length);
+
+	if (pkt->length > length - UDP_BUFFERED_HEADER_SIZE)
+	{
+		// truncated or corrupt
+		return false;
+	}
+
+	pkt->data[pkt->length] = 0;
+	return true;
+}
+
+/*******************************************************************************
+ *
+ * Copy the oldest received packet out of the buffer.  This must only be
+ * called from one thread at a time.
+ *
+ * @param	data_sync	if not NULL, set to the sync pattern of the packet,
+ *						UDP_BUFFERED_SYNC_1 means the data holds coalesced
+ *						records
  *
  ******************************************************************************/
 bool UdpBufferedReceiver::getPacket(uint16_t *data_type, uint16_t *data_flags, 
-	uint16_t *data_length, char *data)
+	uint16_t *data_length, char *data, uint16_t *data_sync)
 {
 	bool ret_val = false;
 	
-	buffer_lock.lock();
-	try
+	if (buffer == NULL)
 	{
-		if (tail_idx != head_idx)
-		{
-			UdpBufferedPacket *pkt = (UdpBufferedPacket *)&(buffer[tail_idx * max_packet_size]);
-	
-            *data_type   = pkt->type;
-            *data_length = pkt->length;
-            *data_flags  = pkt->flags;
-            memcpy(data, pkt->data, *data_length);
+		return false;
+	}
 
-			tail_idx = (tail_idx + 1) % max_packet_count;
-	
-            ret_val = true;
+	UdpBufferedPacket *pkt = (UdpBufferedPacket *)buffer->peek();
+	if (pkt != NULL)
+	{
+        *data_type   = pkt->type;
+        *data_length = pkt->length;
+        *data_flags  = pkt->flags;
+        memcpy(data, pkt->data, *data_length);
+		if (data_sync != NULL)
+		{
+			*data_sync = pkt->sync;
 		}
+
+		buffer->release();
+
+        ret_val = true;
 	}
-    catch (...)
-    {
-        printf("UdpBufferedReceiver::getPacket error\n");
-    }
-	buffer_lock.unlock();
 	
 	return ret_val;
 }
 
+/*******************************************************************************
+ *
+ * Start saving every packet taken from the socket into a capture file.
+ * The receive thread only copies the packets into a buffer, a low priority
+ * thread writes them to the file and flushes it every
+ * CAPTURE_WRITE_PERIOD.
+ *
+ * @return	true if the capture file was opened
+ *
+ ******************************************************************************/
+bool UdpBufferedReceiver::startCapture(const char *file_name)
+{
+	MutexScopeLock lock(capture_lock);
+
+	if (capture_ring != NULL)
+	{
+		printf("UdpReceiver::startCapture - already capturing\n");
+		return false;
+	}
+
+	if (! capture.openWrite(file_name))
+	{
+		return false;
+	}
+
+	capture_ring = new UdpBufferedRing(CAPTURE_HEADER_SIZE + max_packet_size,
+		CAPTURE_SLOT_COUNT);
+	if (! capture_ring->isValid())
+	{
+		printf("ERROR: UdpReceiver could not allocate capture buffer space\n");
+		delete capture_ring;
+		capture_ring = NULL;
+		capture.close();
+		return false;
+	}
+
+	capture_drop_count = 0;
+	capture_writer = new UdpBufferedCaptureWriter(this);
+	capture_writer->start();
+
+	Atomic::storeRelease(&is_capturing, 1);
+	return true;
+}
+
+/*******************************************************************************
+ *
+ * Write the packets that are still buffered and close the capture file.
+ *
+ ******************************************************************************/
+void UdpBufferedReceiver::stopCapture(void)
+{
+	MutexScopeLock lock(capture_lock);
+
+	if (capture_ring == NULL)
+	{
+		return;
+	}
+
+	// wait for a receive that already saw is_capturing set to queue its
+	// packets, then nothing else is put in the buffer
+	Atomic::storeRelease(&is_capturing, 0);
+	Atomic::fence();
+	while (Atomic::loadAcquire(&capture_active) != 0)
+	{
+		sleep(0.0001);
+	}
+
+	capture_writer->requestStop();
+	while (capture_writer->isRunning())
+	{
+		sleep(0.001);
+	}
+	delete capture_writer;
+	capture_writer = NULL;
+
+	drainCapture();
+	capture.close();
+
+	delete capture_ring;
+	capture_ring = NULL;
+}
+
+/*******************************************************************************
+ *
+ * Copy received packets into the capture buffer, nothing is done if there
+ * is no capture.  Packets that do not fit are counted by
+ * getCaptureDropCount().
+ *
+ ******************************************************************************/
+void UdpBufferedReceiver::queueCapture(double time, uint8_t **packets,
+	const uint32_t *lengths, int32_t count)
+{
+	if (! Atomic::loadAcquire(&is_capturing))
+	{
+		return;
+	}
+
+	// counted before is_capturing is read again, stopCapture() sets it the
+	// other way
+	Atomic::fetchAdd(&capture_active, 1);
+	Atomic::fence();
+
+	if (Atomic::loadAcquire(&is_capturing))
+	{
+		for (int32_t i = 0; i < count; i++)
+		{
+			uint8_t *slot = capture_ring->reserve();
+			if (slot == NULL)
+			{
+				Atomic::fetchAdd(&capture_drop_count, count - i);
+				break;
+			}
+
+			uint32_t length = (lengths[i] < max_packet_size) ? lengths[i] : max_packet_size;
+			memcpy(&slot[0], &time, sizeof(time));
+			memcpy(&slot[sizeof(time)], &length, sizeof(length));
+			memcpy(&slot[CAPTURE_HEADER_SIZE], packets[i], length);
+			capture_ring->commit();
+		}
+	}
+
+	Atomic::fetchAdd(&capture_active, (uint32_t)-1);
+}
+
+/*******************************************************************************
+ *
+ * Write the packets in the capture buffer to the file and flush it.  Only
+ * called by the capture writer, or by stopCapture() once it has stopped.
+ *
+ * @return	the number of packets written
+ *
+ ******************************************************************************/
+uint32_t UdpBufferedReceiver::drainCapture(void)
+{
+	uint32_t written = 0;
+
+	uint8_t *slot;
+	while ((slot = capture_ring->peek()) != NULL)
+	{
+		double time;
+		uint32_t length;
+		memcpy(&time, &slot[0], sizeof(time));
+		memcpy(&length, &slot[sizeof(time)], sizeof(length));
+		capture.write(time, &slot[CAPTURE_HEADER_SIZE], length);
+
+		capture_ring->release();
+		written++;
+	}
+
+	if (written > 0)
+	{
+		capture.flush();
+	}
+
+	return written;
+}
+
+/*******************************************************************************
+ *
+ * @return	the number of received packets that were left out of the
+ *			capture because its buffer was full
+ *
+ ******************************************************************************/
+uint32_t UdpBufferedReceiver::getCaptureDropCount(void)
+{
+	return Atomic::loadAcquire(&capture_drop_count);
+}
+
+/*******************************************************************************
+ *
+ * Make the buffer without a socket, so packets only come from
+ * injectPacket().  The receiver must not be started or attached to a
+ * reactor after this.
+ *
+ * @return	true if the receiver is open for replay
+ *
+ ******************************************************************************/
+bool UdpBufferedReceiver::openReplay(void)
+{
+	if ((buffer != NULL) || (src_socket != NULL))
+	{
+		printf("ERROR: UdpReceiver %s is already receiving, it cannot be opened for replay\n",
+			getName().c_str());
+		return false;
+	}
+
+	if (! initBuffer())
+	{
+		return false;
+	}
+
+	is_replay = true;
+	return true;
+}
+
+/*******************************************************************************
+ *
+ * Put a packet in the buffer as if it had just been received, it is
+ * decoded the same way and bad packets are thrown away.  The receiver must
+ * have been opened with openReplay(), so the thread that injects is the
+ * buffer's only producer, and only one thread may inject.
+ *
+ * @param	packet	the packet as it would be received, in network byte
+ *					order
+ *
+ * @return	false if the receiver is not open for replay or the buffer is
+ *			full, when full the packet was not taken and may be injected
+ *			again once the buffer is read
+ *
+ ******************************************************************************/
+bool UdpBufferedReceiver::injectPacket(const void *packet, uint32_t length)
+{
+	if (! is_replay)
+	{
+		return false;
+	}
+
+	if (length > max_packet_size)
+	{
+		return true;
+	}
+
+	uint8_t *slot = buffer->reserve();
+	if (slot == NULL)
+	{
+		return false;
+	}
+
+	memcpy(slot, packet, length);
+	if (decodePacket((UdpBufferedPacket *)slot, length))
+	{
+		buffer->commit();
+	}
+
+	return true;
+}
+
+/*******************************************************************************
+ *
+ * @return	the number of packets that were received while the buffer was
+ *			full and were thrown away
+ *
+ ******************************************************************************/
+uint32_t UdpBufferedReceiver::getDropCount(void)
+{
+	return Atomic::loadAcquire(&drop_count);
+}
+
 } // namespace gsi
@@ -0,0 +1,202 @@
+/*******************************************************************************
+ *
+ * File: UdpBufferedRing.cpp
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include <stdio.h>
+
+#include "gsu/UdpBufferedRing.h"
+
+namespace gsi
+{
+
+/*******************************************************************************
+ *
+ * Create a ring with at least slot_count slots of slot_size bytes each.
+ *
+ * The slot count is rounded up to a power of two so the free running
+ * indexes still map to the correct slot when they wrap.
+ *
+ ******************************************************************************/
+UdpBufferedRing::UdpBufferedRing(uint32_t slot_size, uint32_t slot_count)
+{
+	ring_slot_size = slot_size;
+	ring_slot_count = 1;
+	while (ring_slot_count < slot_count)
+	{
+		ring_slot_count <<= 1;
+	}
+	ring_slot_mask = ring_slot_count - 1;
+
+	head_idx = 0;
+	tail_idx = 0;
+
+	ring_buffer = new uint8_t[ring_slot_size * ring_slot_count];
+	if (ring_buffer == NULL)
+	{
+		printf("ERROR: UdpBufferedRing could not allocate buffer space\n");
+		ring_slot_count = 0;
+	}
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+UdpBufferedRing::~UdpBufferedRing()
+{
+	if (ring_buffer != NULL)
+	{
+		delete[] ring_buffer;
+		ring_buffer = NULL;
+	}
+}
+
+/*******************************************************************************
+ *
+ * @return true if the buffer space for the ring was allocated
+ *
+ ******************************************************************************/
+bool UdpBufferedRing::isValid(void)
+{
+	return ((ring_buffer != NULL) && (ring_slot_count > 0));
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+uint32_t UdpBufferedRing::getSlotSize(void)
+{
+	return ring_slot_size;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+uint32_t UdpBufferedRing::getSlotCount(void)
+{
+	return ring_slot_count;
+}
+
+/*******************************************************************************
+ *
+ * @return	the number of committed slots that have not been released, this
+ *			is only a snapshot when called from a third thread
+ *
+ ******************************************************************************/
+uint32_t UdpBufferedRing::getCount(void)
+{
+	return Atomic::loadAcquire(&head_idx) - Atomic::loadAcquire(&tail_idx);
+}
+
+/*******************************************************************************
+ *
+ * Producer only, get the next free slot.
+ *
+ * @return	a pointer to the slot or NULL if the ring is full
+ *
+ ******************************************************************************/
+uint8_t *UdpBufferedRing::reserve(void)
+{
+	uint8_t *slot = NULL;
+	reserve(&slot, 1);
+	return slot;
+}
+
+/*******************************************************************************
+ *
+ * Producer only, get up to max_count free slots.  The slots are not
+ * contiguous in memory when the ring wraps so a pointer to each is returned.
+ *
+ * @param	slots		an array to hold at least max_count slot pointers
+ * @param	max_count	the most slots that should be returned
+ *
+ * @return	the number of slot pointers put in the slots array
+ *
+ ******************************************************************************/
+uint32_t UdpBufferedRing::reserve(uint8_t **slots, uint32_t max_count)
+{
+	uint32_t head = head_idx;
+	uint32_t free_count = ring_slot_count - (head - Atomic::loadAcquire(&tail_idx));
+
+	if (max_count > free_count)
+	{
+		max_count = free_count;
+	}
+
+	for (uint32_t i = 0; i < max_count; i++)
+	{
+		slots[i] = &(ring_buffer[((head + i) & ring_slot_mask) * ring_slot_size]);
+	}
+
+	return max_count;
+}
+
+/*******************************************************************************
+ *
+ * Producer only, make the next count reserved slots visible to the consumer.
+ *
+ ******************************************************************************/
+void UdpBufferedRing::commit(uint32_t count)
+{
+	Atomic::storeRelease(&head_idx, head_idx + count);
+}
+
+/*******************************************************************************
+ *
+ * Consumer only, get the oldest committed slot.
+ *
+ * @return	a pointer to the slot or NULL if the ring is empty
+ *
+ ******************************************************************************/
+uint8_t *UdpBufferedRing::peek(void)
+{
+	uint8_t *slot = NULL;
+	peek(&slot, 1);
+	return slot;
+}
+
+/*******************************************************************************
+ *
+ * Consumer only, get up to max_count of the oldest committed slots.
+ *
+ * @param	slots		an array to hold at least max_count slot pointers
+ * @param	max_count	the most slots that should be returned
+ *
+ * @return	the number of slot pointers put in the slots array
+ *
+ ******************************************************************************/
+uint32_t UdpBufferedRing::peek(uint8_t **slots, uint32_t max_count)
+{
+	uint32_t tail = tail_idx;
+	uint32_t used_count = Atomic::loadAcquire(&head_idx) - tail;
+
+	if (max_count > used_count)
+	{
+		max_count = used_count;
+	}
+
+	for (uint32_t i = 0; i < max_count; i++)
+	{
+		slots[i] = &(ring_buffer[((tail + i) & ring_slot_mask) * ring_slot_size]);
+	}
+
+	return max_count;
+}
+
+/*******************************************************************************
+ *
+ * Consumer only, return the oldest count slots to the producer.
+ *
+ ******************************************************************************/
+void UdpBufferedRing::release(uint32_t count)
+{
+	Atomic::storeRelease(&tail_idx, tail_idx + count);
+}
+
+} // namespace gsi
@@ -11,16 +11,6 @@
  ******************************************************************************/
 #include "gsu/UdpBufferedTransmitter.h"
 
-void hexDumpp(char *buf, uint32_t len)
-{
-    for(uint32_t i = 0; i < len; i++)
-    {
-        if ((i > 0) && (i%16==0)) printf("\n");
-        printf("%02X ", (unsigned char)(buf[i]));
-    }
-    printf("\n");
-}
-
 namespace gsi
 {
 
@@ -30,7 +20,7 @@ namespace gsi
 UdpBufferedTransmitter::UdpBufferedTransmitter(std::string name, std::string host,
 	uint16_t port, uint16_t max_length, uint16_t max_count,
 	double period, int32_t priority) :
-	Thread(name)
+	PeriodicThread(name, period, (ThreadPriority)priority)
 {
 	dest_socket = NULL;
 	
@@ -40,11 +30,8 @@ UdpBufferedTransmitter::UdpBufferedTransmitter(std::string name, std::string hos
 	max_packet_size = max_length + UDP_BUFFERED_HEADER_SIZE;
 	max_packet_count = max_count + 2;  // must have at least 2 for rolling
 	
-	send_packet = NULL;
 	buffer = NULL;
-
-	head_idx = 0;
-	tail_idx = 0;
+	drop_count = 0;
 
     init();
 }
@@ -62,8 +49,11 @@ UdpBufferedTransmitter::~UdpBufferedTransmitter()
 		dest_socket = NULL;
 	}
 
-	// free buffer
-	// free send packet
+	if (buffer != NULL)
+	{
+		delete buffer;
+		buffer = NULL;
+	}
 }
 
 /*******************************************************************************
@@ -80,7 +70,7 @@ void UdpBufferedTransmitter::init()
 	dest_socket = new UdpSocket();
 	if (dest_socket == NULL)
 	{
-		printf("ERROR: UdpTransmitter could not create socket (ret=%d, err = %d)\n", (int)dest_socket, errno);
+		printf("ERROR: UdpTransmitter could not create socket (err = %d)\n", errno);
 		return;
 	}
 	else
@@ -88,133 +78,142 @@ void UdpBufferedTransmitter::init()
 		printf("UdpTransmitter socket created for sending to %s:%d\n", dest_host.c_str(), (int)dest_port);
 	}
 	
-	send_packet = new UdpBufferedPacket;
-	
-	buffer = (uint8_t *) new uint8_t[max_packet_size * max_packet_count];
-	head_idx = 0;
-	tail_idx = 0;
+	// resolve the destination once instead of on every send
+	UdpSocket::fillAddr(dest_host, dest_port, dest_addr);
+
+	// one extra byte per slot for the null toNetBytes adds after strings
+	buffer = new UdpBufferedRing(max_packet_size + 1, max_packet_count);
+	if (! buffer->isValid())
+	{
+		delete buffer;
+		buffer = NULL;
+	}
 }
 
 /*******************************************************************************
+ *
+ * Send everything in the buffer, up to UdpSocket::MAX_BATCH_COUNT packets
+ * per system call.  This is the only consumer of the buffer so it does not
+ * block threads that are adding packets.
  *
  ******************************************************************************/
-void UdpBufferedTransmitter::run(void)
+void UdpBufferedTransmitter::doPeriodic()
 {
-    printf("UdpBufferedTransmitter::running\n");
-    while (!isStopRequested())
+	if ((dest_socket == NULL) || (buffer == NULL))
 	{
-		try
-		{
-			doPeriodic();
-			
-//			//
-//			// Wait until the next update cycle should begin
-//			//
-//			double wait_time = (control_phase_time + (control_phase_count
-//			    * control_period)) - GetTime();
-//	
-//			if (wait_time > (3* control_period))
-//			{
-//				printf("PeriodicControl::run -- bad wait time of %f, waiting for period\n",
-//					wait_time);
-//				
-				sleep(0.01);
-//			}
-//			else if (wait_time >= MIN_SLEEP_TIME)
-//			{
-//				Wait(wait_time);
-//			}
-//			else
-//			{
-//				Wait(MIN_SLEEP_TIME);
-//			}
-		}
-		catch (...)
+		return;
+	}
+
+	uint8_t *slots[UdpSocket::MAX_BATCH_COUNT];
+	uint32_t lengths[UdpSocket::MAX_BATCH_COUNT];
+
+	uint32_t count = buffer->peek(slots, UdpSocket::MAX_BATCH_COUNT);
+	while (count > 0)
+	{
+		for (uint32_t i = 0; i < count; i++)
 		{
-			printf("EXCEPTION: caught in PeriodicControl::run -- \n");	
+			lengths[i] = ntohs(((UdpBufferedPacket *)slots[i])->length)
+				+ UDP_BUFFERED_HEADER_SIZE;
 		}
-	}	
+
+		dest_socket->sendToBatch((const void **)slots, lengths, count, dest_addr);
+
+		buffer->release(count);
+		count = buffer->peek(slots, UdpSocket::MAX_BATCH_COUNT);
+	}
 }
 
 /*******************************************************************************
+ *
+ * Add a packet to the buffer to be sent the next time doPeriodic() runs.
+ * This may be called from any thread.
+ *
+ * @param	data_sync	UDP_BUFFERED_SYNC_1 if the data holds coalesced
+ *						records, otherwise leave as UDP_BUFFERED_SYNC_0
  *
  ******************************************************************************/
-void UdpBufferedTransmitter::doPeriodic()
+void UdpBufferedTransmitter::putPacket(uint16_t data_type, uint16_t data_flags,
+	uint16_t data_length, const char *data, uint16_t data_sync)
 {
-	UdpBufferedPacket *pkt = NULL;
-    uint32_t send_length;
-
-	bool ready = ((dest_socket >= 0) && (buffer != NULL) && (send_packet != NULL));
-	
-	while (ready)
+	char *dest = reservePacket(data_type, data_flags, data_length, data_sync);
+	if (dest != NULL)
 	{
-		buffer_lock.lock();
-		try
-		{
-			if (head_idx == tail_idx)
-			{
-				ready = false;
-			}
-			else
-			{
-				pkt = (UdpBufferedPacket *)&(buffer[tail_idx * max_packet_size]);
-                send_length = pkt->length + UDP_BUFFERED_HEADER_SIZE;
-
-                send_packet->sync = htons(pkt->sync);
-                send_packet->flags = htons(pkt->flags);
-                send_packet->type = htons(pkt->type);
-                send_packet->length = htons(pkt->length);
-                memcpy(send_packet->data, pkt->data, pkt->length);
-			
-				tail_idx = (tail_idx + 1) % max_packet_count;
-			}
-		}
-		catch (...) {}
-		buffer_lock.unlock();
-		
-		if (ready)
-		{
-			hexDumpp((char *)send_packet, send_length);
-            dest_socket->sendTo(send_packet, send_length,
-				dest_host, dest_port);
-
-            printf("UdpBufferedTransmitter::doPeriodic sent  %d\n", (int)send_length);
-        }
+		memcpy(dest, data, data_length);
+		commitPacket();
 	}
 }
 
 /*******************************************************************************
+ *
+ * Reserve space in the buffer for a packet so the caller can build the data
+ * in place instead of building it elsewhere and having putPacket() copy it.
+ * This may be called from any thread.
+ *
+ * If a pointer is returned the caller must fill in exactly data_length bytes
+ * (one more byte may be written, it will be ignored) then call
+ * commitPacket(), other threads that add packets are blocked until then.
+ *
+ * @return	a pointer to where the data should be put, or NULL if the data
+ *			is too long or the buffer is full (do not call commitPacket())
  *
  ******************************************************************************/
-void UdpBufferedTransmitter::putPacket(uint16_t data_type, uint16_t data_flags,
-	uint16_t data_length, const char *data)
+char *UdpBufferedTransmitter::reservePacket(uint16_t data_type,
+	uint16_t data_flags, uint16_t data_length, uint16_t data_sync)
 {
+	if (buffer == NULL)
+	{
+		return NULL;
+	}
+
+	// a packet too long for a slot is lost the same as one that finds the
+	// buffer full
 	if (data_length + UDP_BUFFERED_HEADER_SIZE > max_packet_size)
 	{
-		return;
+		Atomic::fetchAdd(&drop_count, 1);
+		return NULL;
 	}
 
 	buffer_lock.lock();
-	try
-	{			
-		UdpBufferedPacket *pkt = (UdpBufferedPacket *)&(buffer[head_idx * max_packet_size]);
-		
-		pkt->sync = UDP_BUFFERED_SYNC_0;
-		pkt->flags = data_flags;
-		pkt->type = data_type;
-		pkt->length = data_length;
-		memcpy(pkt->data, data, data_length);
-		
-		head_idx = (head_idx + 1) % max_packet_count;
-		
-		// if the buffer is full, the oldest is lost
-		if (head_idx == tail_idx)
-		{
-			tail_idx = (tail_idx + 1) % max_packet_count;
-		}
+
+	UdpBufferedPacket *pkt = (UdpBufferedPacket *)buffer->reserve();
+	
+	// if the buffer is full, the newest is lost
+	if (pkt == NULL)
+	{
+		Atomic::fetchAdd(&drop_count, 1);
+		buffer_lock.unlock();
+		return NULL;
 	}
-	catch (...) {}
+
+	pkt->sync = htons(data_sync);
+	pkt->flags = htons(data_flags);
+	pkt->type = htons(data_type);
+	pkt->length = htons(data_length);
+
+	return pkt->data;
+}
+
+/*******************************************************************************
+ *
+ * Make the packet from the last successful reservePacket() available to be
+ * sent.
+ *
+ ******************************************************************************/
+void UdpBufferedTransmitter::commitPacket(void)
+{
+	buffer->commit();
 	buffer_lock.unlock();
 }
 
+/*******************************************************************************
+ *
+ * @return	the number of packets that were not sent because they were too
+ *			long for a slot or the buffer was full
+ *
+ ******************************************************************************/
+uint32_t UdpBufferedTransmitter::getDropCount(void)
+{
+	return Atomic::loadAcquire(&drop_count);
+}
+
 } // namespace gsi
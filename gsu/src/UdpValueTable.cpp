@@ -10,12 +10,24 @@
  *
  ******************************************************************************/
 #include "gsu/UdpValueTable.h"
+#include "gsu/TelemetryRecorder.h"
+
+#include "gsi/ByteOrder.h"
+#include "gsi/Time.h"
 
 namespace gsu
 {
 
 const std::string UdpValueTable::DEFAULT_DEST_HOST = "10.1.18.5";
 const double 	  UdpValueTable::DEFAULT_PERIOD	   = 0.05;
+const double 	  UdpValueTable::REGISTER_PERIOD   = 1.0;
+const double 	  UdpValueTable::DEFAULT_KEYFRAME_PERIOD = 1.0;
+
+// resize() takes its fill value by reference, so it needs a definition
+const uint16_t	  UdpValueTable::INVALID_ID;
+
+gsi::SocketReactor *UdpValueTable::shared_reactor = NULL;
+gsi::Mutex			UdpValueTable::reactor_lock;
 
 /*******************************************************************************
  *
@@ -31,6 +43,15 @@ UdpValueTable::UdpValueTable(std::string name, tinyxml2::XMLElement *xml)
 
     double 		period = 0.05;
 	int32_t 	priority = 0;
+	bool		coalesce = false;
+	bool		ids = false;
+	bool		delta = false;
+	bool		use_reactor = false;
+	bool		replay = false;
+	double		keyframe = DEFAULT_KEYFRAME_PERIOD;
+	uint32_t	sched_options = 0;
+	int32_t		cpu = CPU_ANY;
+	std::string	capture;
 	
 	txControl = NULL;
 	rxControl = NULL;
@@ -45,6 +66,23 @@ UdpValueTable::UdpValueTable(std::string name, tinyxml2::XMLElement *xml)
 
         period    = xml->FloatAttribute("period");
 		priority  = xml->IntAttribute("priority");
+		coalesce  = xml->BoolAttribute("coalesce");
+		ids       = xml->BoolAttribute("use_ids");
+		delta     = xml->BoolAttribute("delta");
+		use_reactor = xml->BoolAttribute("reactor");
+		replay    = xml->BoolAttribute("replay");
+		xml->QueryDoubleAttribute("keyframe_period", &keyframe);
+
+		if (xml->Attribute("sched") != NULL)
+		{
+			sched_options = getSchedulingOptions(xml->Attribute("sched"));
+		}
+		xml->QueryIntAttribute("cpu", &cpu);
+
+		if (xml->Attribute("capture") != NULL)
+		{
+			capture = xml->Attribute("capture");
+		}
 	}
 
     if (local_host.length() < 1)
@@ -91,20 +129,120 @@ UdpValueTable::UdpValueTable(std::string name, tinyxml2::XMLElement *xml)
 	}
 
 	echo_received_data = false;
+
+	use_ids = ids;
+	next_register_time = 0.0;
+
+	delta_publishing = delta;
+	keyframe_period = keyframe;
+	next_keyframe_time = 0.0;
+
+	parameter_count = 0;
+	parameter_store = new UdpValueTableParameter[MAX_PARAMETERS];
+	parameter_names.resize(MAX_PARAMETERS);
+	parameter_announced.resize(MAX_PARAMETERS, 0);
+	parameter_dirty.resize(MAX_PARAMETERS, 0);
+	parameter_published.resize(MAX_PARAMETERS, 0);
+	parameter_subscriptions.resize(MAX_PARAMETERS);
+
+	group_count = 0;
+	groups.resize(MAX_GROUPS);
+	applying_group = false;
+
+	telemetry_recorder = NULL;
+
+	replay_only = replay;
+
+	coalesce_updates = coalesce;
+	frame_length = 0;
+	frame_count = 0;
 	
 //	priority = DEFAULT_PRIORITY + priority;	// @TODO: fix priority
 	
+	// the remote table may coalesce even if this one does not, so always
+	// be ready to receive full frames
     rxControl = new gsi::UdpBufferedReceiver(name, local_host, local_port,
-		NAME_LENGTH + 4 + MAX_STR_LENGTH, 100, period, priority);
+		gsi::UDP_BUFFERED_MAX_FRAME_LENGTH, 100, period, priority);
+
+	if (replay_only)
+	{
+		rxControl->openReplay();
+	}
+	else if (! capture.empty())
+	{
+		rxControl->startCapture(capture.c_str());
+	}
 	
+	// the transmitter sends at the rate this table flushes its frames,
+	// groups and keyframes are sent as frames even when not coalescing
     txControl = new gsi::UdpBufferedTransmitter(name, remote_host, remote_port,
-		NAME_LENGTH + 4 + MAX_STR_LENGTH, 100, period, priority);
+		gsi::UDP_BUFFERED_MAX_FRAME_LENGTH, 100, getPeriod(), priority);
 		 
-    rxControl->start();
+	// the table and its receiver and transmitter share the scheduling
+	setPriority((ThreadPriority)priority);
+	addOptions(sched_options);
+	setAffinity(cpu);
+	rxControl->addOptions(sched_options);
+	rxControl->setAffinity(cpu);
+	txControl->addOptions(sched_options);
+	txControl->setAffinity(cpu);
+
+	if (replay_only)
+	{
+		// packets only come from replayPacket()
+	}
+	else if (use_reactor)
+	{
+		reactor_lock.lock();
+		if (shared_reactor == NULL)
+		{
+			shared_reactor = new gsi::SocketReactor("UdpValueTableReactor",
+				(ThreadPriority)priority, sched_options);
+			shared_reactor->setAffinity(cpu);
+			shared_reactor->start();
+		}
+		reactor_lock.unlock();
+
+		if (! rxControl->attach(shared_reactor))
+		{
+			printf("UdpValueTable %s could not use the reactor, starting a receiver thread\n",
+				name.c_str());
+			rxControl->start();
+		}
+	}
+	else
+	{
+		rxControl->start();
+	}
+
     txControl->start();
     start();
 }
 
+/*******************************************************************************
+ *
+ * @return	true if the table was made with the replay XML attribute, its
+ *			receiver has no socket and only takes packets from
+ *			replayPacket()
+ *
+ ******************************************************************************/
+bool UdpValueTable::isReplay(void)
+{
+	return replay_only;
+}
+
+/*******************************************************************************
+ *
+ * @return	the reactor shared by tables with the reactor XML attribute set,
+ *			other sockets may be added to it, NULL if no table has used it
+ *
+ ******************************************************************************/
+gsi::SocketReactor *UdpValueTable::getReactor(void)
+{
+	gsi::MutexScopeLock lock(reactor_lock);
+	return shared_reactor;
+}
+
 /*******************************************************************************
  *
  ******************************************************************************/
@@ -126,6 +264,7 @@ void UdpValueTable::init(std::string name, tinyxml2::XMLElement *xml)
  ******************************************************************************/
 void UdpValueTable::finalize(void)
 {
+    rxControl->detach();
     rxControl->requestStop();
     txControl->requestStop();
     requestStop();
@@ -135,140 +274,1368 @@ void UdpValueTable::finalize(void)
  *
  ******************************************************************************/
 void UdpValueTable::doPeriodic(void)
+{
+	applyReceived();
+
+	if (delta_publishing)
+	{
+		publishDirty();
+	}
+
+	// remind the remote table of the IDs in use in case it started late
+	// or lost a registration
+	if (use_ids && (gsi::Time::getTime() >= next_register_time))
+	{
+		uint16_t ids[MAX_PARAMETERS];
+		uint32_t announced = 0;
+		uint32_t count = gsi::Atomic::loadAcquire(&parameter_count);
+		for (uint16_t id = 0; id < count; id++)
+		{
+			if (parameter_announced[id])
+			{
+				ids[announced++] = id;
+			}
+		}
+		sendRegistrations(ids, announced);
+		next_register_time = gsi::Time::getTime() + REGISTER_PERIOD;
+	}
+
+	flushFrame();
+}
+
+/*******************************************************************************
+ *
+ * Apply every packet the receiver has buffered.  The table does this each
+ * period, a replay also does it when the buffer fills.
+ *
+ ******************************************************************************/
+void UdpValueTable::applyReceived(void)
 {
 	uint16_t type; 
 	uint16_t flags; 
 	uint16_t data_length;
-	char buffer[NAME_LENGTH + MAX_STR_LENGTH];
+	uint16_t sync;
+	char buffer[gsi::UDP_BUFFERED_MAX_FRAME_LENGTH + 1];
+
+	gsi::MutexScopeLock lock(receive_lock);
 	
-	while (rxControl->getPacket(&type, &flags, &data_length, buffer))
+	while (rxControl->getPacket(&type, &flags, &data_length, buffer, &sync))
 	{
-        put(&buffer[0], (UdpValueTableParameter::DataType)type, (uint8_t *)&buffer[NAME_LENGTH], 
-			data_length - NAME_LENGTH, false);
+		if ((sync == gsi::UDP_BUFFERED_SYNC_1) && (flags & FLAG_GROUP))
+		{
+			applyGroup(type, buffer, data_length);
+		}
+		else if (sync == gsi::UDP_BUFFERED_SYNC_1)
+		{
+			applyFrame(type, buffer, data_length);
+		}
+		else
+		{
+			applyPacket(type, flags, buffer, data_length);
+		}
 	}
 }
 
 /*******************************************************************************
+ *
+ * Give the table a packet as if its receiver had just taken it from the
+ * socket, when the receiver's buffer is full the buffered packets are
+ * applied first.  The table must have the replay XML attribute set, and
+ * only one thread may replay into it.
+ *
+ * @param	packet	a packet as it was received, in network byte order
+ *
+ * @return	false if the table is not a replay table or the receiver could
+ *			not take the packet yet
  *
  ******************************************************************************/
-void UdpValueTable::put(std::string name, UdpValueTableParameter::DataType type,
-    uint8_t *bytes, uint16_t length, bool do_send)
+bool UdpValueTable::replayPacket(const void *packet, uint32_t length)
 {
-    UdpValueTableParameter *p = getParameter(name);
-    if (p == NULL)
-    {
-        p = new UdpValueTableParameter();
+	if (! replay_only)
+	{
+		return false;
+	}
 
-        switch(type)
-        {
-            case UdpValueTableParameter::TYPE_BOOL:      p->init<bool>(false);   p->fromNetBytes(bytes, length); break;
-            case UdpValueTableParameter::TYPE_INT8:      p->init<int8_t>(0);     p->fromNetBytes(bytes, length); break;
-            case UdpValueTableParameter::TYPE_UINT8:     p->init<uint8_t>(0);    p->fromNetBytes(bytes, length); break;
-            case UdpValueTableParameter::TYPE_INT16:     p->init<int16_t>(0);    p->fromNetBytes(bytes, length); break;
-            case UdpValueTableParameter::TYPE_UINT16:    p->init<uint16_t>(0);   p->fromNetBytes(bytes, length); break;
-            case UdpValueTableParameter::TYPE_INT32:     p->init<int32_t>(0);    p->fromNetBytes(bytes, length); break;
-            case UdpValueTableParameter::TYPE_UINT32:    p->init<uint32_t>(0);   p->fromNetBytes(bytes, length); break;
-            case UdpValueTableParameter::TYPE_FLOAT32:   p->init<float>(0.0);    p->fromNetBytes(bytes, length); break;
-
-			case UdpValueTableParameter::TYPE_STRING:	
-				p->init<std::string>(std::string("")); 
-				p->fromNetBytes(bytes, length); 
-				break;
+	if (rxControl->injectPacket(packet, length))
+	{
+		return true;
+	}
 
-            case UdpValueTableParameter::TYPE_BLOB: 
-				p->init(bytes, length); 
-				break;
+	applyReceived();
+	return rxControl->injectPacket(packet, length);
+}
 
-            default: break;
-        }
-        parameters.insert(std::pair<std::string, UdpValueTableParameter *>(name, p));
-    }
-    else
+/*******************************************************************************
+ *
+ * Apply one received record.  Depending on the flags the data is either
+ * the parameter name followed by the value, the sender's ID followed by the
+ * value, or a registration of the sender's ID.  Values are in network byte
+ * order.
+ *
+ ******************************************************************************/
+void UdpValueTable::applyPacket(uint16_t type, uint16_t flags, char *data,
+	uint16_t length)
+{
+	if (flags & (FLAG_ID | FLAG_REGISTER))
+	{
+		if (length < ID_LENGTH)
+		{
+			return;
+		}
+
+		uint16_t remote_id;
+		memcpy(&remote_id, data, sizeof(remote_id));
+		remote_id = ntohs(remote_id);
+
+		if (flags & FLAG_REGISTER)
+		{
+			if (length < ID_LENGTH + NAME_LENGTH)
+			{
+				return;
+			}
+
+			char name[NAME_LENGTH + 1];
+			strncpy(name, &data[ID_LENGTH], NAME_LENGTH);
+			name[NAME_LENGTH] = 0;
+
+			uint16_t id = getId(name);
+			if (id == INVALID_ID)
+			{
+				UdpValueTableParameter p;
+				initParameter(p, (UdpValueTableParameter::DataType)type, NULL, 0);
+				id = addParameter(name, p);
+				if (id == INVALID_ID)
+				{
+					return;
+				}
+			}
+
+			if (remote_id >= remote_ids.size())
+			{
+				remote_ids.resize(remote_id + 1, INVALID_ID);
+			}
+			remote_ids[remote_id] = id;
+		}
+		else if ((remote_id < remote_ids.size()) && (remote_ids[remote_id] != INVALID_ID))
+		{
+			applyValue(remote_ids[remote_id], type, (uint8_t *)&data[ID_LENGTH],
+				length - ID_LENGTH);
+		}
+		// else the registration has not arrived yet, drop the update
+		return;
+	}
+
+	if (length < NAME_LENGTH)
+	{
+		return;
+	}
+
+	char name[NAME_LENGTH + 1];
+	strncpy(name, data, NAME_LENGTH);
+	name[NAME_LENGTH] = 0;
+
+	uint16_t id = getId(name);
+	if (id == INVALID_ID)
+	{
+		bool added = false;
+		UdpValueTableParameter p;
+		initParameter(p, (UdpValueTableParameter::DataType)type,
+			(uint8_t *)&data[NAME_LENGTH], length - NAME_LENGTH);
+		id = addParameter(name, p, &added);
+		if (id == INVALID_ID)
+		{
+			return;
+		}
+
+		if (added)
+		{
+			notify(id);
+			return;
+		}
+	}
+
+	applyValue(id, type, (uint8_t *)&data[NAME_LENGTH], length - NAME_LENGTH);
+}
+
+/*******************************************************************************
+ *
+ * Set an existing parameter from a received value and notify subscribers
+ * if the value changed.
+ *
+ ******************************************************************************/
+void UdpValueTable::applyValue(uint16_t id, uint16_t type, uint8_t *bytes,
+	uint16_t length)
+{
+	UdpValueTableParameter *p = getParameter(id);
+	if (p == NULL)
+	{
+		return;
+	}
+
+	if (p->getType() != type)
+	{
+		printf("UdpValueTable::put: type mismatch, for parameter %s\n", parameter_names[id].c_str());
+		return;
+	}
+
+	if (isRecording())
+	{
+		recordValue(id, type, bytes, length);
+	}
+
+	if (! isSubscribed(id))
+	{
+		p->fromNetBytes(bytes, length);
+		return;
+	}
+
+	// compare the value in network byte order before and after so every
+	// type, including strings and blobs, is handled the same way
+	uint8_t before[gsi::UDP_BUFFERED_MAX_FRAME_LENGTH + 1];
+	uint8_t after[gsi::UDP_BUFFERED_MAX_FRAME_LENGTH + 1];
+
+	uint16_t before_length = p->toNetBytes(before);
+	p->fromNetBytes(bytes, length);
+	uint16_t after_length = p->toNetBytes(after);
+
+	if ((before_length != after_length) || (memcmp(before, after, after_length) != 0))
+	{
+		notify(id);
+	}
+}
+
+/*******************************************************************************
+ *
+ * Apply each of the records in a coalesced frame.
+ *
+ * @param	count	the number of records the sender put in the frame
+ * @param	data	the records, each a packet header and data in network
+ *					byte order, padded to UDP_BUFFERED_RECORD_ALIGN bytes
+ * @param	length	the number of bytes in data
+ *
+ ******************************************************************************/
+void UdpValueTable::applyFrame(uint16_t count, char *data, uint16_t length)
+{
+	uint16_t offset = 0;
+
+	for (uint16_t i = 0; i < count; i++)
+	{
+		if (offset + gsi::UDP_BUFFERED_HEADER_SIZE > length)
+		{
+			break;
+		}
+
+		gsi::UdpBufferedPacket *rec = (gsi::UdpBufferedPacket *)&data[offset];
+		uint16_t rec_length = ntohs(rec->length);
+		if ((ntohs(rec->sync) != gsi::UDP_BUFFERED_SYNC_0) ||
+			(offset + gsi::UDP_BUFFERED_HEADER_SIZE + rec_length > length))
+		{
+			printf("UdpValueTable::applyFrame: bad record %d of %d\n", i, count);
+			break;
+		}
+
+		// save the byte after the record and null terminate it in case
+		// the data is a string
+		uint16_t end = offset + gsi::UDP_BUFFERED_HEADER_SIZE + rec_length;
+		char saved = data[end];
+		data[end] = 0;
+		applyPacket(ntohs(rec->type), ntohs(rec->flags), rec->data, rec_length);
+		data[end] = saved;
+
+		offset = end;
+		offset = (offset + gsi::UDP_BUFFERED_RECORD_ALIGN - 1) & ~(gsi::UDP_BUFFERED_RECORD_ALIGN - 1);
+	}
+}
+
+/*******************************************************************************
+ *
+ * Apply a frame sent by putGroup() so getGroup() sees all or none of it,
+ * subscribers are told once the whole group has been applied.
+ *
+ ******************************************************************************/
+void UdpValueTable::applyGroup(uint16_t count, char *data, uint16_t length)
+{
+	applying_group = true;
+	group_lock.beginWrite();
+	applyFrame(count, data, length);
+	group_lock.endWrite();
+	applying_group = false;
+
+	for (uint32_t i = 0; i < deferred_notifications.size(); i++)
+	{
+		notify(deferred_notifications[i]);
+	}
+	deferred_notifications.clear();
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+void UdpValueTable::put(std::string name, UdpValueTableParameter::DataType type,
+    uint8_t *bytes, uint16_t length, bool do_send)
+{
+	uint16_t id = getId(name);
+	bool added = false;
+    if (id == INVALID_ID)
     {
-        if (p->getType() != type)
-        {
-            printf("UdpValueTable::put: type mismatch, for parameter %s\n", name.c_str());
-            return;
-        }
+        UdpValueTableParameter p;
+        initParameter(p, type, bytes, length);
+        id = addParameter(name, p, &added);
+		if (id == INVALID_ID)
+		{
+			return;
+		}
+    }
 
-//        if (p->get<T>() != val)
-//        {
-            p->fromNetBytes(bytes, length);
-			// tell observers data changed
-//        }
+	if (! added)
+    {
+		UdpValueTableParameter *p = getParameter(id);
+		if (p->getType() != type)
+		{
+			printf("UdpValueTable::put: type mismatch, for parameter %s\n", name.c_str());
+			return;
+		}
+		p->fromNetBytes(bytes, length);
     }
 
+	if (isRecording())
+	{
+		recordValue(id, type, bytes, length);
+	}
+
     if (do_send)
     {
-        send(name, p);
+        publish(id, getParameter(id), true);
     }
 }
 
 /*******************************************************************************
+ *
+ * Set the type and initial value of a parameter that is not in a table yet.
+ *
+ * @param	bytes	the initial value in network byte order, or NULL to
+ *					leave the value zero/empty
  *
  ******************************************************************************/
-UdpValueTableParameter *UdpValueTable::getParameter(std::string name)
+void UdpValueTable::initParameter(UdpValueTableParameter &p,
+	UdpValueTableParameter::DataType type, uint8_t *bytes, uint16_t length)
 {
-	std::map<std::string, UdpValueTableParameter *>::iterator ittr = parameters.find(name);
-    if (ittr == parameters.end())
-    {
-        return NULL;
-    }
-    else
+    switch(type)
     {
-        return ittr->second;
+        case UdpValueTableParameter::TYPE_BOOL:      p.init<bool>(false);   break;
+        case UdpValueTableParameter::TYPE_INT8:      p.init<int8_t>(0);     break;
+        case UdpValueTableParameter::TYPE_UINT8:     p.init<uint8_t>(0);    break;
+        case UdpValueTableParameter::TYPE_INT16:     p.init<int16_t>(0);    break;
+        case UdpValueTableParameter::TYPE_UINT16:    p.init<uint16_t>(0);   break;
+        case UdpValueTableParameter::TYPE_INT32:     p.init<int32_t>(0);    break;
+        case UdpValueTableParameter::TYPE_UINT32:    p.init<uint32_t>(0);   break;
+        case UdpValueTableParameter::TYPE_FLOAT32:   p.init<float>(0.0);    break;
+		case UdpValueTableParameter::TYPE_STRING:	 p.init<std::string>(std::string("")); break;
+
+        case UdpValueTableParameter::TYPE_BLOB: 
+			p.init(bytes, (bytes == NULL) ? 0 : length); 
+			return;
+
+        default: break;
     }
+
+	if (bytes != NULL)
+	{
+		p.fromNetBytes(bytes, length);
+	}
+}
+
+/*******************************************************************************
+ *
+ * Give the parameter the next ID and move its type and value into the
+ * table's slot for that ID.  If a parameter with the name already exists
+ * p is left as it is.
+ *
+ * @param	added	if not NULL, set to true if p was added
+ *
+ * @return	the ID of the named parameter or INVALID_ID if the table is full
+ *
+ ******************************************************************************/
+uint16_t UdpValueTable::addParameter(std::string name, UdpValueTableParameter &p,
+	bool *added)
+{
+	if (added != NULL)
+	{
+		*added = false;
+	}
+
+	// subscription_lock is always taken before parameter_lock, a listener
+	// called by notify() may look up or add parameters
+	subscription_lock.lock();
+	parameter_lock.lock();
+
+	// another thread may have added the name since the caller looked
+	std::map<std::string, uint16_t>::iterator ittr = parameter_ids.find(name);
+	if (ittr != parameter_ids.end())
+	{
+		uint16_t id = ittr->second;
+		parameter_lock.unlock();
+		subscription_lock.unlock();
+		return id;
+	}
+
+	if (parameter_count >= MAX_PARAMETERS)
+	{
+		parameter_lock.unlock();
+		subscription_lock.unlock();
+		printf("UdpValueTable::addParameter: table full, cannot add %s\n", name.c_str());
+		return INVALID_ID;
+	}
+
+	// fill in the new slot before publishing the count so lock free
+	// readers never see a partly added parameter
+	uint16_t id = (uint16_t)parameter_count;
+	parameter_store[id].takeValue(p);
+	parameter_names[id] = name;
+	parameter_announced[id] = 0;
+	parameter_dirty[id] = 0;
+	parameter_published[id] = 0;
+	parameter_ids.insert(std::pair<std::string, uint16_t>(name, id));
+
+	// move any subscriptions made before the parameter existed, so once
+	// the ID is published it already has them
+	std::pair<std::multimap<std::string, Subscription>::iterator,
+		std::multimap<std::string, Subscription>::iterator> pending =
+		pending_subscriptions.equal_range(name);
+	parameter_subscriptions[id].clear();
+	for (std::multimap<std::string, Subscription>::iterator pittr = pending.first;
+		pittr != pending.second; ++pittr)
+	{
+		parameter_subscriptions[id].push_back(pittr->second);
+	}
+	pending_subscriptions.erase(pending.first, pending.second);
+
+	gsi::Atomic::storeRelease(&parameter_count, parameter_count + 1);
+
+	parameter_lock.unlock();
+	subscription_lock.unlock();
+
+	if (added != NULL)
+	{
+		*added = true;
+	}
+
+	if (isRecording())
+	{
+		recordValue(id, &parameter_store[id]);
+	}
+
+	return id;
+}
+
+/*******************************************************************************
+ *
+ * Add a group of already added parameters.
+ *
+ * @return	the new group or INVALID_ID if there are already MAX_GROUPS
+ *
+ ******************************************************************************/
+uint16_t UdpValueTable::addGroup(const std::vector<uint16_t> &ids)
+{
+	gsi::MutexScopeLock lock(parameter_lock);
+
+	if (group_count >= MAX_GROUPS)
+	{
+		printf("UdpValueTable::addGroup: too many groups\n");
+		return INVALID_ID;
+	}
+
+	// fill in the group before publishing the count
+	uint16_t group = (uint16_t)group_count;
+	groups[group] = ids;
+	gsi::Atomic::storeRelease(&group_count, group_count + 1);
+
+	return group;
 }
 
 /*******************************************************************************
+ *
+ * @return	the number of members in the group, 0 if it does not exist
  *
  ******************************************************************************/
-void UdpValueTable::send(std::string name, UdpValueTableParameter *p)
+uint16_t UdpValueTable::getGroupSize(uint16_t group)
 {
-    char *buffer = new char[NAME_LENGTH + p->getSize()];
-	strncpy(buffer, name.c_str(), NAME_LENGTH);
-    p->toNetBytes((uint8_t *)&buffer[NAME_LENGTH]);
+	if (group >= gsi::Atomic::loadAcquire(&group_count))
+	{
+		return 0;
+	}
 
-	txControl->putPacket(p->getType(), DEFAULT_FLAGS, NAME_LENGTH + p->getSize(), buffer);
+	return (uint16_t)groups[group].size();
 }
 
 /*******************************************************************************
+ *
+ * @return	true if the group exists and all of its members are of the type
  *
  ******************************************************************************/
-void UdpValueTable::printTable(void)
+bool UdpValueTable::isGroupType(uint16_t group, UdpValueTableParameter::DataType type)
 {
-	printf("---------------- --------\n");
-	for (std::map<std::string, UdpValueTableParameter *>::iterator it=parameters.begin(); it!=parameters.end(); ++it)
+	if (group >= gsi::Atomic::loadAcquire(&group_count))
 	{
-		switch(it->second->getType())
+		return false;
+	}
+
+	std::vector<uint16_t> &ids = groups[group];
+	for (uint32_t i = 0; i < ids.size(); i++)
+	{
+		if (parameter_store[ids[i]].getType() != type)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*******************************************************************************
+ *
+ * @return	the ID of the named parameter, INVALID_ID if it does not exist
+ *
+ ******************************************************************************/
+uint16_t UdpValueTable::getId(std::string name)
+{
+	uint16_t id = INVALID_ID;
+
+	parameter_lock.lock();
+	std::map<std::string, uint16_t>::iterator ittr = parameter_ids.find(name);
+    if (ittr != parameter_ids.end())
+    {
+        id = ittr->second;
+    }
+	parameter_lock.unlock();
+
+	return id;
+}
+
+/*******************************************************************************
+ *
+ * @return	the name of the parameter, an empty string if it does not exist
+ *
+ ******************************************************************************/
+std::string UdpValueTable::getName(uint16_t id)
+{
+	if (id >= gsi::Atomic::loadAcquire(&parameter_count))
+	{
+		return std::string("");
+	}
+
+	return parameter_names[id];
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+UdpValueTableParameter *UdpValueTable::getParameter(std::string name)
+{
+	return getParameter(getId(name));
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+UdpValueTableParameter *UdpValueTable::getParameter(uint16_t id)
+{
+	if (id >= gsi::Atomic::loadAcquire(&parameter_count))
+	{
+		return NULL;
+	}
+
+	return &parameter_store[id];
+}
+
+/*******************************************************************************
+ *
+ * Send a parameter that was put with do_send set, right away or, when
+ * delta publishing, on the next period if the value changed.
+ *
+ ******************************************************************************/
+void UdpValueTable::publish(uint16_t id, UdpValueTableParameter *p, bool changed)
+{
+	gsi::Atomic::storeRelease(&parameter_published[id], 1);
+
+	if (! delta_publishing)
+	{
+		send(id, p);
+	}
+	else if (changed)
+	{
+		gsi::Atomic::storeRelease(&parameter_dirty[id], 1);
+	}
+}
+
+/*******************************************************************************
+ *
+ * Record a parameter's new value in the flight recorder and the telemetry
+ * recorder.
+ *
+ ******************************************************************************/
+void UdpValueTable::recordValue(uint16_t id, UdpValueTableParameter *p)
+{
+	uint8_t bytes[gsi::UDP_BUFFERED_MAX_FRAME_LENGTH + 1];
+	uint16_t length = p->toNetBytes(bytes);
+	recordValue(id, p->getType(), bytes, length);
+}
+
+/*******************************************************************************
+ *
+ * @param	bytes	the value in network byte order
+ *
+ ******************************************************************************/
+void UdpValueTable::recordValue(uint16_t id, uint8_t type, uint8_t *bytes,
+	uint16_t length)
+{
+	gsi::FlightRecorder::recordValue(id, type, bytes, length);
+
+	TelemetryRecorder *recorder = telemetry_recorder;
+	if (recorder != NULL)
+	{
+		recorder->record(id, type, bytes, length);
+	}
+}
+
+/*******************************************************************************
+ *
+ * Start or stop feeding values to a telemetry recorder, when starting the
+ * value of every parameter is recorded.  This is called by the recorder,
+ * use TelemetryRecorder::open() and close().
+ *
+ ******************************************************************************/
+void UdpValueTable::setTelemetryRecorder(TelemetryRecorder *recorder)
+{
+	telemetry_recorder = recorder;
+	gsi::Atomic::fence();
+
+	if (recorder == NULL)
+	{
+		return;
+	}
+
+	uint8_t bytes[gsi::UDP_BUFFERED_MAX_FRAME_LENGTH + 1];
+	uint32_t count = gsi::Atomic::loadAcquire(&parameter_count);
+	for (uint32_t id = 0; id < count; id++)
+	{
+		UdpValueTableParameter *p = &parameter_store[id];
+		uint16_t length = p->toNetBytes(bytes);
+		recorder->record((uint16_t)id, p->getType(), bytes, length);
+	}
+}
+
+/*******************************************************************************
+ *
+ * Send the parameters that changed since the last period, or all of them
+ * when a keyframe is due.
+ *
+ ******************************************************************************/
+void UdpValueTable::publishDirty(void)
+{
+	bool keyframe = false;
+	if (keyframe_period > 0.0)
+	{
+		double now = gsi::Time::getTime();
+		if (now >= next_keyframe_time)
+		{
+			keyframe = true;
+			next_keyframe_time = now + keyframe_period;
+		}
+	}
+
+	uint32_t count = gsi::Atomic::loadAcquire(&parameter_count);
+	for (uint16_t id = 0; id < count; id++)
+	{
+		// clear the flag before sending so a put that lands while sending
+		// is sent next period
+		if (gsi::Atomic::compareExchange(&parameter_dirty[id], 1, 0) && (! keyframe))
+		{
+			send(id, &parameter_store[id]);
+		}
+	}
+
+	if (keyframe)
+	{
+		sendKeyframe(count);
+	}
+}
+
+/*******************************************************************************
+ *
+ * Send the parameters of the first count that were ever sent from this
+ * side in as few frames as they fit in.  Parameters that were only set by
+ * the remote table are left out, they belong to it.
+ *
+ ******************************************************************************/
+void UdpValueTable::sendKeyframe(uint32_t count)
+{
+	uint16_t ids[MAX_PARAMETERS];
+	uint32_t published = 0;
+	for (uint32_t id = 0; id < count; id++)
+	{
+		if (gsi::Atomic::loadAcquire(&parameter_published[id]))
+		{
+			ids[published++] = id;
+		}
+	}
+	count = published;
+
+	announce(ids, count);
+
+	char buffer[gsi::UDP_BUFFERED_MAX_FRAME_LENGTH];
+	uint32_t sent = 0;
+	while (sent < count)
+	{
+		uint16_t length = 0;
+		uint32_t records = buildFrame(buffer, &length, &ids[sent], count - sent);
+		if (records == 0)
+		{
+			printf("UdpValueTable::sendKeyframe: parameter %s does not fit in a frame\n",
+				parameter_names[ids[sent]].c_str());
+			sent++;
+			continue;
+		}
+
+		txControl->putPacket(records, DEFAULT_FLAGS, length, buffer, gsi::UDP_BUFFERED_SYNC_1);
+		sent += records;
+	}
+}
+
+/*******************************************************************************
+ *
+ * Send the current value of a parameter, keyed by name or by ID.
+ *
+ ******************************************************************************/
+void UdpValueTable::send(uint16_t id, UdpValueTableParameter *p)
+{
+	if (use_ids && (! parameter_announced[id]))
+	{
+		sendRegistration(id);
+		parameter_announced[id] = 1;
+	}
+
+	char key[NAME_LENGTH];
+	uint16_t flags;
+	uint16_t key_length = getKey(id, key, &flags);
+
+	putRecord(p->getType(), flags, key, key_length, p);
+}
+
+/*******************************************************************************
+ *
+ * Fill in the key that goes in front of a parameter's value, the ID
+ * followed by padding or the name depending on use_ids.
+ *
+ * @param	key		a buffer of at least NAME_LENGTH bytes
+ * @param	flags	set to the record flags that go with the key
+ *
+ * @return	the length of the key
+ *
+ ******************************************************************************/
+uint16_t UdpValueTable::getKey(uint16_t id, char *key, uint16_t *flags)
+{
+	if (use_ids)
+	{
+		uint16_t net_id = htons(id);
+		memset(key, 0, ID_LENGTH);
+		memcpy(key, &net_id, sizeof(net_id));
+
+		*flags = FLAG_ID;
+		return ID_LENGTH;
+	}
+
+	strncpy(key, parameter_names[id].c_str(), NAME_LENGTH);
+
+	*flags = DEFAULT_FLAGS;
+	return NAME_LENGTH;
+}
+
+/*******************************************************************************
+ *
+ * Send every member of a group in one frame flagged FLAG_GROUP so the
+ * remote table applies them together.
+ *
+ ******************************************************************************/
+void UdpValueTable::sendGroup(uint16_t group)
+{
+	std::vector<uint16_t> &ids = groups[group];
+	if (ids.empty())
+	{
+		return;
+	}
+
+	for (uint32_t i = 0; i < ids.size(); i++)
+	{
+		gsi::Atomic::storeRelease(&parameter_published[ids[i]], 1);
+	}
+
+	announce(&ids[0], ids.size());
+
+	char buffer[gsi::UDP_BUFFERED_MAX_FRAME_LENGTH];
+	uint16_t length = 0;
+
+	// copy the values under the group lock so the frame holds one update
+	uint32_t seq;
+	do
+	{
+		seq = group_lock.beginRead();
+		length = 0;
+		if (buildFrame(buffer, &length, &ids[0], ids.size()) != ids.size())
+		{
+			printf("UdpValueTable::sendGroup: group %d does not fit in a frame\n", group);
+			return;
+		}
+	} while (! group_lock.endRead(seq));
+
+	txControl->putPacket(ids.size(), FLAG_GROUP, length, buffer, gsi::UDP_BUFFERED_SYNC_1);
+}
+
+/*******************************************************************************
+ *
+ * When sending IDs, send the registrations of any of the parameters that
+ * have not been sent before so they get there before a frame of values.
+ *
+ ******************************************************************************/
+void UdpValueTable::announce(const uint16_t *ids, uint32_t count)
+{
+	if (! use_ids)
+	{
+		return;
+	}
+
+	uint16_t new_ids[MAX_PARAMETERS];
+	uint32_t new_count = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (! parameter_announced[ids[i]])
+		{
+			new_ids[new_count++] = ids[i];
+			parameter_announced[ids[i]] = 1;
+		}
+	}
+
+	sendRegistrations(new_ids, new_count);
+}
+
+/*******************************************************************************
+ *
+ * Fill a frame with a record for each parameter in the list, until the
+ * next one does not fit.  The 16 and 32 bit values are collected and
+ * changed to network byte order together once the frame is full.
+ *
+ * @param	buffer	a frame of UDP_BUFFERED_MAX_FRAME_LENGTH bytes
+ * @param	length	the bytes used in the frame, advanced past the records
+ *
+ * @return	the number of parameters put in the frame
+ *
+ ******************************************************************************/
+uint32_t UdpValueTable::buildFrame(char *buffer, uint16_t *length, const uint16_t *ids,
+	uint32_t count)
+{
+	uint16_t values16[MAX_FRAME_RECORDS];
+	uint32_t values32[MAX_FRAME_RECORDS];
+	char *dest16[MAX_FRAME_RECORDS];
+	char *dest32[MAX_FRAME_RECORDS];
+	uint32_t count16 = 0;
+	uint32_t count32 = 0;
+
+	uint32_t i;
+	for (i = 0; i < count; i++)
+	{
+		char key[NAME_LENGTH];
+		uint16_t flags;
+		uint16_t key_length = getKey(ids[i], key, &flags);
+
+		UdpValueTableParameter *p = &parameter_store[ids[i]];
+		uint16_t type = p->getType();
+
+		uint16_t width = 0;
+		switch (type)
+		{
+			case UdpValueTableParameter::TYPE_INT16:
+			case UdpValueTableParameter::TYPE_UINT16:
+				width = 2;
+				break;
+
+			case UdpValueTableParameter::TYPE_INT32:
+			case UdpValueTableParameter::TYPE_UINT32:
+			case UdpValueTableParameter::TYPE_FLOAT32:
+				width = 4;
+				break;
+		}
+
+		if (width == 0)
+		{
+			if (! appendRecord(buffer, length, type, flags, key, key_length, p))
+			{
+				break;
+			}
+			continue;
+		}
+
+		uint16_t data_length = key_length + width;
+		if (*length + gsi::UDP_BUFFERED_HEADER_SIZE + data_length > gsi::UDP_BUFFERED_MAX_FRAME_LENGTH)
+		{
+			break;
+		}
+
+		gsi::UdpBufferedPacket *rec = (gsi::UdpBufferedPacket *)&buffer[*length];
+		rec->sync = htons(gsi::UDP_BUFFERED_SYNC_0);
+		rec->type = htons(type);
+		rec->flags = htons(flags);
+		rec->length = htons(data_length);
+		memcpy(rec->data, key, key_length);
+
+		// the value slot is a union, so these are the bits of any type of
+		// the same width
+		if (width == 2)
+		{
+			values16[count16] = p->get<uint16_t>();
+			dest16[count16++] = &rec->data[key_length];
+		}
+		else
+		{
+			values32[count32] = p->get<uint32_t>();
+			dest32[count32++] = &rec->data[key_length];
+		}
+
+		*length += gsi::UDP_BUFFERED_HEADER_SIZE + data_length;
+		*length = (*length + gsi::UDP_BUFFERED_RECORD_ALIGN - 1) & ~(gsi::UDP_BUFFERED_RECORD_ALIGN - 1);
+	}
+
+	gsi::ByteOrder::toNet16(values16, values16, count16);
+	gsi::ByteOrder::toNet32(values32, values32, count32);
+
+	for (uint32_t j = 0; j < count16; j++)
+	{
+		memcpy(dest16[j], &values16[j], sizeof(uint16_t));
+	}
+	for (uint32_t j = 0; j < count32; j++)
+	{
+		memcpy(dest32[j], &values32[j], sizeof(uint32_t));
+	}
+
+	return i;
+}
+
+/*******************************************************************************
+ *
+ * Tell the remote table which name goes with one of this table's IDs.
+ *
+ ******************************************************************************/
+void UdpValueTable::sendRegistration(uint16_t id)
+{
+	char key[ID_LENGTH + NAME_LENGTH];
+	getRegistrationKey(id, key);
+
+	putRecord(parameter_store[id].getType(), FLAG_REGISTER, key, sizeof(key), NULL);
+}
+
+/*******************************************************************************
+ *
+ * Send the registrations of many parameters in as few frames as they fit
+ * in, after any records that are waiting to be coalesced.
+ *
+ ******************************************************************************/
+void UdpValueTable::sendRegistrations(const uint16_t *ids, uint32_t count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	flushFrame();
+
+	char buffer[gsi::UDP_BUFFERED_MAX_FRAME_LENGTH];
+	uint16_t length = 0;
+	uint16_t records = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		char key[ID_LENGTH + NAME_LENGTH];
+		getRegistrationKey(ids[i], key);
+
+		uint16_t type = parameter_store[ids[i]].getType();
+		if (! appendRecord(buffer, &length, type, FLAG_REGISTER, key, sizeof(key), NULL))
+		{
+			txControl->putPacket(records, DEFAULT_FLAGS, length, buffer, gsi::UDP_BUFFERED_SYNC_1);
+			length = 0;
+			records = 0;
+			appendRecord(buffer, &length, type, FLAG_REGISTER, key, sizeof(key), NULL);
+		}
+		records++;
+	}
+
+	txControl->putPacket(records, DEFAULT_FLAGS, length, buffer, gsi::UDP_BUFFERED_SYNC_1);
+}
+
+/*******************************************************************************
+ *
+ * Fill in the key of a registration, the ID followed by padding and the
+ * name.
+ *
+ * @param	key		a buffer of ID_LENGTH + NAME_LENGTH bytes
+ *
+ ******************************************************************************/
+void UdpValueTable::getRegistrationKey(uint16_t id, char *key)
+{
+	memset(key, 0, ID_LENGTH + NAME_LENGTH);
+
+	uint16_t net_id = htons(id);
+	memcpy(key, &net_id, sizeof(net_id));
+	strncpy(&key[ID_LENGTH], parameter_names[id].c_str(), NAME_LENGTH);
+}
+
+/*******************************************************************************
+ *
+ * Queue one record made of the key followed by the parameter's value in
+ * network byte order.
+ *
+ * @param	p	the parameter with the value, or NULL to send only the key
+ *
+ ******************************************************************************/
+void UdpValueTable::putRecord(uint16_t type, uint16_t flags, const char *key,
+	uint16_t key_length, UdpValueTableParameter *p)
+{
+	if (coalesce_updates)
+	{
+		gsi::MutexScopeLock lock(frame_lock);
+
+		if (! appendRecord(frame_buffer, &frame_length, type, flags, key, key_length, p))
+		{
+			sendFrame();
+			appendRecord(frame_buffer, &frame_length, type, flags, key, key_length, p);
+		}
+		frame_count++;
+		return;
+	}
+
+	// the size of a string or BLOB can change until it is copied, so copy
+	// it first and send what was copied
+	if ((p != NULL) && ((p->getType() == UdpValueTableParameter::TYPE_STRING)
+		|| (p->getType() == UdpValueTableParameter::TYPE_BLOB)))
+	{
+		char buffer[NAME_LENGTH + UdpValueTableParameter::VALUE_CAPACITY + 1];
+		memcpy(buffer, key, key_length);
+		uint16_t value_length = p->toNetBytes((uint8_t *)&buffer[key_length]);
+		txControl->putPacket(type, flags, key_length + value_length, buffer);
+		return;
+	}
+
+	// serialize straight into the transmitter's buffer
+	uint16_t data_length = key_length + ((p == NULL) ? 0 : p->getSize());
+	char *buffer = txControl->reservePacket(type, flags, data_length);
+	if (buffer == NULL)
+	{
+		return;
+	}
+
+	memcpy(buffer, key, key_length);
+	if (p != NULL)
+	{
+		p->toNetBytes((uint8_t *)&buffer[key_length]);
+	}
+
+	txControl->commitPacket();
+}
+
+/*******************************************************************************
+ *
+ * Add a record to the end of a frame.
+ *
+ * @param	buffer	a frame of UDP_BUFFERED_MAX_FRAME_LENGTH bytes
+ * @param	length	the bytes used in the frame, advanced past the record
+ *					and its padding
+ *
+ * @return	false if the record does not fit
+ *
+ ******************************************************************************/
+bool UdpValueTable::appendRecord(char *buffer, uint16_t *length, uint16_t type,
+	uint16_t flags, const char *key, uint16_t key_length, UdpValueTableParameter *p)
+{
+	// header, key, the most the value can be, and the null toNetBytes adds
+	// to strings, the value's size can change until it is copied
+	uint16_t max_length = gsi::UDP_BUFFERED_HEADER_SIZE + key_length
+		+ ((p == NULL) ? 0 : p->getCapacity());
+	if (*length + max_length + 1 > gsi::UDP_BUFFERED_MAX_FRAME_LENGTH)
+	{
+		return false;
+	}
+
+	gsi::UdpBufferedPacket *rec = (gsi::UdpBufferedPacket *)&buffer[*length];
+	memcpy(rec->data, key, key_length);
+	uint16_t data_length = key_length;
+	if (p != NULL)
+	{
+		data_length += p->toNetBytes((uint8_t *)&rec->data[key_length]);
+	}
+
+	rec->sync = htons(gsi::UDP_BUFFERED_SYNC_0);
+	rec->type = htons(type);
+	rec->flags = htons(flags);
+	rec->length = htons(data_length);
+
+	*length += gsi::UDP_BUFFERED_HEADER_SIZE + data_length;
+	*length = (*length + gsi::UDP_BUFFERED_RECORD_ALIGN - 1) & ~(gsi::UDP_BUFFERED_RECORD_ALIGN - 1);
+	return true;
+}
+
+/*******************************************************************************
+ *
+ * Hand the records collected since the last flush to the transmitter as a
+ * single coalesced frame.
+ *
+ ******************************************************************************/
+void UdpValueTable::flushFrame(void)
+{
+	gsi::MutexScopeLock lock(frame_lock);
+	sendFrame();
+}
+
+/*******************************************************************************
+ *
+ * The caller must hold frame_lock.
+ *
+ ******************************************************************************/
+void UdpValueTable::sendFrame(void)
+{
+	if (frame_count > 0)
+	{
+		txControl->putPacket(frame_count, DEFAULT_FLAGS, frame_length,
+			frame_buffer, gsi::UDP_BUFFERED_SYNC_1);
+	}
+
+	frame_length = 0;
+	frame_count = 0;
+}
+
+/*******************************************************************************
+ *
+ * Call the listener's valueChanged() method when a received update changes
+ * the named parameter.  The parameter does not need to exist yet.
+ *
+ ******************************************************************************/
+void UdpValueTable::subscribe(std::string name, UdpValueTableListener *listener)
+{
+	Subscription sub = { listener, NULL };
+	addSubscription(name, getId(name), sub);
+}
+
+/*******************************************************************************
+ *
+ * Give the semaphore when a received update changes the named parameter so
+ * a thread waiting on it wakes up.  The parameter does not need to exist yet.
+ *
+ ******************************************************************************/
+void UdpValueTable::subscribe(std::string name, gsi::Semaphore *semaphore)
+{
+	Subscription sub = { NULL, semaphore };
+	addSubscription(name, getId(name), sub);
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+void UdpValueTable::subscribe(uint16_t id, UdpValueTableListener *listener)
+{
+	Subscription sub = { listener, NULL };
+	addSubscription(std::string(""), id, sub);
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+void UdpValueTable::subscribe(uint16_t id, gsi::Semaphore *semaphore)
+{
+	Subscription sub = { NULL, semaphore };
+	addSubscription(std::string(""), id, sub);
+}
+
+/*******************************************************************************
+ *
+ * Remove every subscription of the listener.
+ *
+ ******************************************************************************/
+void UdpValueTable::unsubscribe(UdpValueTableListener *listener)
+{
+	removeSubscription(listener, NULL);
+}
+
+/*******************************************************************************
+ *
+ * Remove every subscription of the semaphore.
+ *
+ ******************************************************************************/
+void UdpValueTable::unsubscribe(gsi::Semaphore *semaphore)
+{
+	removeSubscription(NULL, semaphore);
+}
+
+/*******************************************************************************
+ *
+ * Add a subscription to the parameter with the ID, or if the ID is not
+ * valid hold it by name until a parameter with the name is added.  The
+ * name is looked up again under subscription_lock, addParameter() holds it
+ * while it moves the held subscriptions, so none is left behind when the
+ * parameter is added at the same time.
+ *
+ ******************************************************************************/
+void UdpValueTable::addSubscription(std::string name, uint16_t id, Subscription sub)
+{
+	subscription_lock.lock();
+	if ((id == INVALID_ID) && (name.length() > 0))
+	{
+		id = getId(name);
+	}
+
+	if (id < gsi::Atomic::loadAcquire(&parameter_count))
+	{
+		parameter_subscriptions[id].push_back(sub);
+	}
+	else if (name.length() > 0)
+	{
+		pending_subscriptions.insert(std::pair<std::string, Subscription>(name, sub));
+	}
+	else
+	{
+		printf("UdpValueTable::subscribe: no parameter with ID %d\n", id);
+	}
+	subscription_lock.unlock();
+}
+
+/*******************************************************************************
+ *
+ * Remove the subscriptions that match the listener or the semaphore.
+ *
+ ******************************************************************************/
+void UdpValueTable::removeSubscription(UdpValueTableListener *listener,
+	gsi::Semaphore *semaphore)
+{
+	subscription_lock.lock();
+	uint32_t count = gsi::Atomic::loadAcquire(&parameter_count);
+	for (uint32_t id = 0; id < count; id++)
+	{
+		std::vector<Subscription> &subs = parameter_subscriptions[id];
+		for (uint32_t i = 0; i < subs.size(); )
+		{
+			if ((subs[i].listener == listener) && (subs[i].semaphore == semaphore))
+			{
+				subs.erase(subs.begin() + i);
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+
+	std::multimap<std::string, Subscription>::iterator ittr = pending_subscriptions.begin();
+	while (ittr != pending_subscriptions.end())
+	{
+		if ((ittr->second.listener == listener) && (ittr->second.semaphore == semaphore))
+		{
+			pending_subscriptions.erase(ittr++);
+		}
+		else
+		{
+			++ittr;
+		}
+	}
+	subscription_lock.unlock();
+}
+
+/*******************************************************************************
+ *
+ * @return	true if anything is subscribed to the parameter
+ *
+ ******************************************************************************/
+bool UdpValueTable::isSubscribed(uint16_t id)
+{
+	subscription_lock.lock();
+	bool subscribed = (id < parameter_subscriptions.size()) &&
+		(! parameter_subscriptions[id].empty());
+	subscription_lock.unlock();
+
+	return subscribed;
+}
+
+/*******************************************************************************
+ *
+ * Tell the subscribers of a parameter that its value changed.  The lock is
+ * held while listeners are called so a listener is never called after
+ * unsubscribe() returns.
+ *
+ ******************************************************************************/
+void UdpValueTable::notify(uint16_t id)
+{
+	if (applying_group)
+	{
+		deferred_notifications.push_back(id);
+		return;
+	}
+
+	subscription_lock.lock();
+	if (id < parameter_subscriptions.size())
+	{
+		std::vector<Subscription> &subs = parameter_subscriptions[id];
+		for (uint32_t i = 0; i < subs.size(); i++)
+		{
+			if (subs[i].listener != NULL)
+			{
+				subs[i].listener->valueChanged(this, id);
+			}
+
+			if (subs[i].semaphore != NULL)
+			{
+				subs[i].semaphore->give();
+			}
+		}
+	}
+	subscription_lock.unlock();
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+void UdpValueTable::printTable(void)
+{
+	printf("---------------- --------\n");
+	parameter_lock.lock();
+	for (uint16_t id = 0; id < parameter_count; id++)
+	{
+		const char *name = parameter_names[id].c_str();
+		UdpValueTableParameter *p = &parameter_store[id];
+
+		switch(p->getType())
 		{
 			case UdpValueTableParameter::TYPE_BOOL:
-				printf("%-16s %3d %8s\n", it->first.c_str(), it->second->getSize(), it->second->get<bool>()?"true":"false");
+				printf("%-16s %3d %8s\n", name, p->getSize(), p->get<bool>()?"true":"false");
 				break;
 		
 			case UdpValueTableParameter::TYPE_FLOAT32:
-				printf("%-16s %3d %8.2f\n", it->first.c_str(), it->second->getSize(), it->second->get<float>());
+				printf("%-16s %3d %8.2f\n", name, p->getSize(), p->get<float>());
 				break;
 
 			case UdpValueTableParameter::TYPE_STRING:
-				printf("%-16s %3d %s\n", it->first.c_str(), it->second->getSize(), it->second->get<std::string>().c_str());
+				printf("%-16s %3d %s\n", name, p->getSize(), p->get<std::string>().c_str());
 				break;
 
 			case UdpValueTableParameter::TYPE_BLOB:
 			{
-				printf("%-16s %3d", it->first.c_str(), it->second->getSize());
-				for (int i = 0; i<it->second->getSize(); i++)
+				printf("%-16s %3d", name, p->getSize());
+				for (int i = 0; i<p->getSize(); i++)
 				{
-					printf(" %02X", ((unsigned char *)(it->second->get<void *>()))[i]);
+					printf(" %02X", ((unsigned char *)(p->get<void *>()))[i]);
 				}
 				printf("\n");
 			} break;
 
 			default:
-				printf("%-16s %3d %08X\n", it->first.c_str(), it->second->getSize(), (unsigned int)it->second->get<uint32_t>());
+				printf("%-16s %3d %08X\n", name, p->getSize(), (unsigned int)p->get<uint32_t>());
 				break;
 		}
 	}
+	parameter_lock.unlock();
 	printf("\n");
 }
 
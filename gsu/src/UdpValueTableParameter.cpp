@@ -12,6 +12,9 @@
 #include <string>
 #include <vector>
 
+#include <stdio.h>
+#include <string.h>
+
 #include <gsi/UdpSocket.h>
 
 #include "gsu/UdpValueTableParameter.h"
@@ -19,6 +22,10 @@
 namespace gsu
 {
 
+// blocks are big enough for the longest string or BLOB
+UdpValueTableSlab UdpValueTableParameter::value_slab(
+	UdpValueTableParameter::VALUE_CAPACITY, 64);
+
 /*******************************************************************************
  *
  * The default constructor initializes this parameter with a type of NONE,
@@ -29,7 +36,7 @@ UdpValueTableParameter::UdpValueTableParameter()
 {
 	type = TYPE_NONE;
 	length = 0;
-	value.blob = NULL;
+	value.storage = NULL;
 }
 
 /*******************************************************************************
@@ -48,10 +55,24 @@ UdpValueTableParameter::UdpValueTableParameter(void *bytes, uint16_t len)
 {
 	type = TYPE_BLOB;
 	length = 0;
-	value.blob = NULL;
+	value.storage = NULL;
 	set(bytes, len);
 }
 
+/*******************************************************************************
+ *
+ * Give the storage block back to the slab.
+ *
+ ******************************************************************************/
+UdpValueTableParameter::~UdpValueTableParameter()
+{
+	if ((type == TYPE_STRING) || (type == TYPE_BLOB))
+	{
+		value_slab.release(value.storage);
+	}
+	value.storage = NULL;
+}
+
 /*******************************************************************************
  *
  * This method is for initializing a parameter of type Binary Large Object
@@ -80,36 +101,134 @@ void UdpValueTableParameter::init(void *bytes, uint16_t len)
  *		 byte order, that is left to the user
  *
  * @param	bytes	a pointer to the data
- * @param	len		the number of bytes in this BLOB
+ * @param	len		the number of bytes in this BLOB, at most
+ *					MAX_BLOB_LENGTH are kept
  *
  ******************************************************************************/
 void UdpValueTableParameter::set(void *bytes, uint16_t len)
 {
-	if (value.blob != NULL)
+	setBytes(bytes, len, false);
+}
+
+/*******************************************************************************
+ *
+ * @return	the most bytes toNetBytes() can put in its buffer, not counting
+ *			the null it adds after strings
+ *
+ ******************************************************************************/
+uint16_t UdpValueTableParameter::getCapacity(void)
+{
+	switch (type)
 	{
-		delete value.blob;
-		value.blob = NULL;
+		case TYPE_STRING:	return VALUE_CAPACITY;
+		case TYPE_BLOB:		return MAX_BLOB_LENGTH;
+		default:			return length;
 	}
+}
 
-	length = len;
-
-	if (len > 0)
+/*******************************************************************************
+ *
+ * Copy a string or BLOB into the storage block, taking a block from the
+ * slab the first time.
+ *
+ * @param	is_string	true to add a null after the bytes, the length then
+ *						counts the null like sizeOf<std::string>()
+ *
+ ******************************************************************************/
+void UdpValueTableParameter::setBytes(const void *bytes, uint16_t len, bool is_string)
+{
+	uint8_t *block = NULL;
+	if (readValue(&value.storage) == NULL)
 	{
-		value.blob = new uint8_t[len];
-		if (value.blob == NULL)
+		block = value_slab.allocate();
+		if (block == NULL)
 		{
-			length = 0;
+			printf("UdpValueTableParameter::setBytes: no storage for value\n");
+			return;
 		}
 	}
-	else
+
+	uint16_t max = is_string ? MAX_STR_LENGTH : MAX_BLOB_LENGTH;
+	if (len > max)
 	{
-		value.blob = NULL;
+		len = max;
 	}
 
-	if (value.blob != NULL)
+	value_lock.beginWrite();
+	if (value.storage == NULL)
+	{
+		value.storage = block;
+		block = NULL;
+	}
+
+	if (len > 0)
 	{
-		memcpy(value.blob, bytes, length);
+		memmove(value.storage, bytes, len);
 	}
+	if (is_string)
+	{
+		value.storage[len] = 0;
+		len++;
+	}
+	length = len;
+	value_lock.endWrite();
+
+	// another thread set the first value at the same time
+	value_slab.release(block);
+}
+
+/*******************************************************************************
+ *
+ * Copy the string or BLOB, retrying until no writer changed it.
+ *
+ * @param	dest	a buffer of at least VALUE_CAPACITY bytes
+ *
+ * @return	the number of bytes copied
+ *
+ ******************************************************************************/
+uint16_t UdpValueTableParameter::readBytes(uint8_t *dest)
+{
+	uint32_t seq;
+	uint16_t len;
+	do
+	{
+		seq = value_lock.beginRead();
+		len = *((volatile uint16_t *)&length);
+		uint8_t *src = *((uint8_t * volatile *)&value.storage);
+		if ((src == NULL) || (len > VALUE_CAPACITY))
+		{
+			len = 0;
+		}
+		else
+		{
+			memcpy(dest, src, len);
+		}
+	} while (! value_lock.endRead(seq));
+
+	return len;
+}
+
+/*******************************************************************************
+ *
+ * Move the type and value of another parameter into this one, including
+ * the storage block of a string or BLOB, the other parameter is left with
+ * no type.  Neither parameter may be used by other threads while this runs.
+ *
+ ******************************************************************************/
+void UdpValueTableParameter::takeValue(UdpValueTableParameter &src)
+{
+	if ((type == TYPE_STRING) || (type == TYPE_BLOB))
+	{
+		value_slab.release(value.storage);
+	}
+
+	type = src.type;
+	length = src.length;
+	value = src.value;
+
+	src.type = TYPE_NONE;
+	src.length = 0;
+	src.value.storage = NULL;
 }
 
 /*******************************************************************************
@@ -119,7 +238,8 @@ void UdpValueTableParameter::set(void *bytes, uint16_t len)
  * byte order, BLOBs are sent as is with no byte swapping
  *
  * @param	dest	a pointer to a buffer in which the bytes in network 
- *					byte order should be put
+ *					byte order should be put, at least getCapacity() + 1
+ *					bytes long
  *
  * @return	the number of bytes put into the destination buffer.
  *
@@ -128,58 +248,25 @@ uint16_t UdpValueTableParameter::toNetBytes(uint8_t  *dest)
 {
 	switch (type)
 	{
-		case TYPE_BOOL:
-		{
-			// NOTE: transmitted as uint8_t because receiver may
-			// declare bools as different sizes
-			*((uint8_t *)(dest)) = get<bool>();
-		} break;
-		
-		case TYPE_INT8:
-		{
-			*((int8_t *)(dest)) = get<int8_t>();			
-		} break;
-		
-		case TYPE_UINT8:
-		{
-			*((uint8_t *)(dest)) = get<uint8_t>();	
-		} break;
-		
-		case TYPE_INT16:
-		{
-			*((int16_t *)(dest)) = htons(get<int16_t>());
-		} break;
-		
-		case TYPE_UINT16:
-		{
-			*((uint16_t *)(dest)) = htons(get<uint16_t>());
-		} break;
-		
-		case TYPE_INT32:
-		{
-			*((int32_t *)(dest)) = htonl(get<int32_t>());
-		} break;
-		
-		case TYPE_UINT32:
-		{
-			*((uint32_t *)(dest)) = htonl(get<uint32_t>());
-		} break;
-		
-		case TYPE_FLOAT32:
-		{
-			float f = get<float>();
-			*((uint32_t *)(dest)) = htonl(*((uint32_t *)(&f)));
-		} break;
+		case TYPE_BOOL:		return toNetBytes<bool>(get<bool>(), dest);
+		case TYPE_INT8:		return toNetBytes<int8_t>(get<int8_t>(), dest);
+		case TYPE_UINT8:	return toNetBytes<uint8_t>(get<uint8_t>(), dest);
+		case TYPE_INT16:	return toNetBytes<int16_t>(get<int16_t>(), dest);
+		case TYPE_UINT16:	return toNetBytes<uint16_t>(get<uint16_t>(), dest);
+		case TYPE_INT32:	return toNetBytes<int32_t>(get<int32_t>(), dest);
+		case TYPE_UINT32:	return toNetBytes<uint32_t>(get<uint32_t>(), dest);
+		case TYPE_FLOAT32:	return toNetBytes<float>(get<float>(), dest);
 
 	 	case TYPE_STRING:
 		{
-    		memcpy(dest, ((std::string *)(value.blob))->c_str(), length);
-			dest[length] = 0;
+			uint16_t len = readBytes(dest);
+			dest[len] = 0;
+			return len;
 		} break;
 
 		case TYPE_BLOB:
 		{
-			memcpy(dest, value.blob, length);
+			return readBytes(dest);
 		} break;
 	
 		default:
@@ -205,51 +292,20 @@ uint16_t UdpValueTableParameter::fromNetBytes(uint8_t *src, uint32_t length_arg)
 {
 	switch(type)
 	{
-		case TYPE_BOOL:
-		{
-			set<bool>( *((bool *)(src)));
-		} break;
-		
-		case TYPE_INT8:
-		{
-			set<int8_t>(*((int8_t *)(src)));
-		} break;
-		
-		case TYPE_UINT8:
-		{
-			set<uint8_t>( *((uint8_t *)(src)));
-		} break;
-		
-		case TYPE_INT16:
-		{
-			set<int16_t>((int16_t)ntohs(*((int16_t *)(src))));
-		} break;
-		
-		case TYPE_UINT16:
-		{
-			set<uint16_t>((uint16_t)ntohs(*((uint16_t *)(src))));
-		} break;
-		
-		case TYPE_INT32:
-		{
-			set<int32_t>((int32_t)ntohl(*((int32_t *)(src))));
-		} break;
-		
-		case TYPE_UINT32:
-		{
-			set<uint32_t>((uint32_t)ntohl(*((uint32_t *)(src))));
-		} break;
-		
-		case TYPE_FLOAT32:
-		{
-			float f;
-			*((uint32_t *)(&f)) = ntohl(*((uint32_t *)(src)));
-			set<float>(f);
-		} break;
+		case TYPE_BOOL:		set<bool>(fromNetBytes<bool>(src));			break;
+		case TYPE_INT8:		set<int8_t>(fromNetBytes<int8_t>(src));		break;
+		case TYPE_UINT8:	set<uint8_t>(fromNetBytes<uint8_t>(src));		break;
+		case TYPE_INT16:	set<int16_t>(fromNetBytes<int16_t>(src));		break;
+		case TYPE_UINT16:	set<uint16_t>(fromNetBytes<uint16_t>(src));	break;
+		case TYPE_INT32:	set<int32_t>(fromNetBytes<int32_t>(src));		break;
+		case TYPE_UINT32:	set<uint32_t>(fromNetBytes<uint32_t>(src));	break;
+		case TYPE_FLOAT32:	set<float>(fromNetBytes<float>(src));			break;
 
 		case TYPE_STRING:
 		{
-			set<std::string>(std::string((char *)src));		
+			// copy the string straight in, without a std::string
+			uint8_t *end = (uint8_t *)memchr(src, 0, length_arg);
+			setBytes(src, (end == NULL) ? length_arg : end - src, true);
 		} break;
 		
 		case TYPE_BLOB:
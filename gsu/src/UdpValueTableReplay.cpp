@@ -0,0 +1,109 @@
+/*******************************************************************************
+ *
+ * File: UdpValueTableReplay.cpp
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include "gsu/UdpValueTableReplay.h"
+#include "gsu/UdpValueTable.h"
+#include "gsu/UdpBufferedCapture.h"
+
+#include "gsi/Thread.h"
+#include "gsi/Time.h"
+
+namespace gsu
+{
+
+const double UdpValueTableReplay::STALL_TIMEOUT = 2.0;
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+UdpValueTableReplay::UdpValueTableReplay(UdpValueTable *table)
+{
+	replay_table = table;
+	packet_count = 0;
+	capture_length = 0.0;
+	elapsed_time = 0.0;
+}
+
+/*******************************************************************************
+ *
+ * Give every packet in the capture to the table, and apply what is left
+ * once they have all been given.
+ *
+ * @param	real_time	true to keep the timing of the capture, false to go
+ *						as fast as the table takes the packets
+ *
+ * @return	false if the table is not a replay table, the capture could not
+ *			be read, or the table stopped taking packets
+ *
+ ******************************************************************************/
+bool UdpValueTableReplay::replay(const char *file_name, bool real_time)
+{
+	packet_count = 0;
+	capture_length = 0.0;
+	elapsed_time = 0.0;
+
+	if ((replay_table == NULL) || (! replay_table->isReplay()))
+	{
+		printf("UdpValueTableReplay::replay - the table must set the replay XML attribute\n");
+		return false;
+	}
+
+	gsi::UdpBufferedCapture capture;
+	if (! capture.openRead(file_name))
+	{
+		return false;
+	}
+
+	uint8_t packet[gsi::UDP_BUFFERED_MAX_DATAGRAM + 1];
+	uint32_t length;
+	double time;
+	bool ok = true;
+
+	double start = gsi::Time::getMonotonicTime();
+	while (ok && capture.read(&time, packet, &length, gsi::UDP_BUFFERED_MAX_DATAGRAM))
+	{
+		if (real_time)
+		{
+			gsi::Thread::sleepUntil(start + time);
+		}
+
+		// the table's thread may be applying the buffer
+		double stall_time = 0.0;
+		while (! replay_table->replayPacket(packet, length))
+		{
+			double now = gsi::Time::getMonotonicTime();
+			if (stall_time == 0.0)
+			{
+				stall_time = now;
+			}
+			else if (now - stall_time > STALL_TIMEOUT)
+			{
+				printf("UdpValueTableReplay::replay - the table stopped taking packets\n");
+				ok = false;
+				break;
+			}
+			gsi::Thread::sleep(0.001);
+		}
+
+		if (ok)
+		{
+			packet_count++;
+			capture_length = time;
+		}
+	}
+
+	replay_table->applyReceived();
+	elapsed_time = gsi::Time::getMonotonicTime() - start;
+
+	return ok;
+}
+
+} // namespace gsu
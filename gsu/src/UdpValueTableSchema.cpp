@@ -0,0 +1,76 @@
+/*******************************************************************************
+ *
+ * File: UdpValueTableSchema.cpp
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include "gsu/UdpValueTableSchema.h"
+
+#include <stdio.h>
+
+namespace gsu
+{
+
+/*******************************************************************************
+ *
+ * @param	ids		the derived class's array of one ID for each entry
+ * @param	count	the number of entries
+ *
+ ******************************************************************************/
+UdpValueTableSchema::UdpValueTableSchema(uint16_t *ids, uint16_t count)
+{
+	table = NULL;
+	bind_table = NULL;
+	entry_ids = ids;
+	entry_count = count;
+
+	for (uint16_t i = 0; i < entry_count; i++)
+	{
+		entry_ids[i] = UdpValueTable::INVALID_ID;
+	}
+}
+
+/*******************************************************************************
+ *
+ * Unbind the schema before its entries are bound to a table.
+ *
+ * @return	false if there is no table
+ *
+ ******************************************************************************/
+bool UdpValueTableSchema::beginBind(UdpValueTable *t)
+{
+	table = NULL;
+	bind_table = t;
+
+	return (t != NULL);
+}
+
+/*******************************************************************************
+ *
+ * Finish binding, the schema is only used with the table if every entry
+ * was bound.
+ *
+ * @return	true if the schema is bound
+ *
+ ******************************************************************************/
+bool UdpValueTableSchema::endBind(bool ok)
+{
+	if (ok)
+	{
+		table = bind_table;
+	}
+	else
+	{
+		printf("UdpValueTableSchema::bind: a parameter has the wrong type or the table is full\n");
+	}
+
+	bind_table = NULL;
+	return ok;
+}
+
+} // namespace gsu
@@ -0,0 +1,165 @@
+/*******************************************************************************
+ *
+ * File: UdpValueTableSlab.cpp
+ * 
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include "gsu/UdpValueTableSlab.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace gsu
+{
+
+/*******************************************************************************
+ *
+ * No memory is allocated until the first block is needed.
+ *
+ * @param	block_size		the bytes in each block, rounded up to a
+ *							multiple of 8 so blocks stay aligned
+ * @param	blocks_per_slab	the number of blocks allocated at one time
+ *
+ ******************************************************************************/
+UdpValueTableSlab::UdpValueTableSlab(uint16_t block_size, uint16_t blocks_per_slab)
+{
+	this->block_size = (block_size + 7) & ~7;
+	this->blocks_per_slab = (blocks_per_slab < 1) ? 1 : blocks_per_slab;
+}
+
+/*******************************************************************************
+ *
+ * Free every slab, blocks that were not released are no longer valid.
+ *
+ ******************************************************************************/
+UdpValueTableSlab::~UdpValueTableSlab(void)
+{
+	for (uint32_t i = 0; i < slab_list.size(); i++)
+	{
+		delete[] slab_list[i];
+	}
+	slab_list.clear();
+	free_list.clear();
+}
+
+/*******************************************************************************
+ *
+ * @return	a block of getBlockSize() bytes set to 0, or NULL if a new slab
+ *			was needed and could not be allocated
+ *
+ ******************************************************************************/
+uint8_t *UdpValueTableSlab::allocate(void)
+{
+	gsi::MutexScopeLock lock(slab_lock);
+
+	if (free_list.empty() && (! addSlab()))
+	{
+		return NULL;
+	}
+
+	uint8_t *block = free_list.back();
+	free_list.pop_back();
+	memset(block, 0, block_size);
+
+	return block;
+}
+
+/*******************************************************************************
+ *
+ * Give back a block from allocate(), this never allocates memory.
+ *
+ ******************************************************************************/
+void UdpValueTableSlab::release(uint8_t *block)
+{
+	if (block == NULL)
+	{
+		return;
+	}
+
+	gsi::MutexScopeLock lock(slab_lock);
+	free_list.push_back(block);
+}
+
+/*******************************************************************************
+ *
+ * Allocate slabs now until at least count blocks are free, so later calls
+ * to allocate() do not.
+ *
+ ******************************************************************************/
+void UdpValueTableSlab::reserve(uint32_t count)
+{
+	gsi::MutexScopeLock lock(slab_lock);
+
+	while (free_list.size() < count)
+	{
+		if (! addSlab())
+		{
+			return;
+		}
+	}
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+uint16_t UdpValueTableSlab::getBlockSize(void)
+{
+	return block_size;
+}
+
+/*******************************************************************************
+ *
+ * @return	the number of blocks in all slabs, used or free
+ *
+ ******************************************************************************/
+uint32_t UdpValueTableSlab::getBlockCount(void)
+{
+	gsi::MutexScopeLock lock(slab_lock);
+	return slab_list.size() * blocks_per_slab;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+uint32_t UdpValueTableSlab::getFreeCount(void)
+{
+	gsi::MutexScopeLock lock(slab_lock);
+	return free_list.size();
+}
+
+/*******************************************************************************
+ *
+ * Allocate one more slab and put its blocks on the free list, the caller
+ * must hold slab_lock.  The free list gets room for every block so
+ * release() never makes it grow.
+ *
+ * @return	true if the slab was added
+ *
+ ******************************************************************************/
+bool UdpValueTableSlab::addSlab(void)
+{
+	uint8_t *slab = new uint8_t[(uint32_t)block_size * blocks_per_slab];
+	if (slab == NULL)
+	{
+		printf("UdpValueTableSlab::addSlab: could not allocate %d blocks\n",
+			(int)blocks_per_slab);
+		return false;
+	}
+
+	slab_list.push_back(slab);
+	free_list.reserve(slab_list.size() * blocks_per_slab);
+
+	for (int32_t i = blocks_per_slab - 1; i >= 0; i--)
+	{
+		free_list.push_back(&slab[(uint32_t)i * block_size]);
+	}
+
+	return true;
+}
+
+} // namespace gsu
@@ -0,0 +1,82 @@
+/*******************************************************************************
+ *
+ * File: UdpValueTableThreadStats.cpp
+ *
+ * Written by:
+ * 	The Robonauts
+ * 	FRC Team 118
+ * 	NASA, Johnson Space Center
+ * 	Clear Creek Independent School District
+ *
+ ******************************************************************************/
+#include "gsu/UdpValueTableThreadStats.h"
+
+namespace gsu
+{
+
+/*******************************************************************************
+ *
+ * Add the statistics parameters to the table, they are not sent until
+ * publish() is called.
+ *
+ ******************************************************************************/
+UdpValueTableThreadStats::UdpValueTableThreadStats(UdpValueTable *table,
+	gsi::PeriodicThread *thread, std::string prefix)
+{
+	stats_thread = thread;
+
+	if (prefix.length() > MAX_PREFIX_LENGTH)
+	{
+		printf("UdpValueTableThreadStats: prefix %s cut to %d characters\n",
+			prefix.c_str(), MAX_PREFIX_LENGTH);
+		prefix = prefix.substr(0, MAX_PREFIX_LENGTH);
+	}
+
+	ex50    = table->getHandle<float>(prefix + "_ex50", 0.0f);
+	ex99    = table->getHandle<float>(prefix + "_ex99", 0.0f);
+	ex999   = table->getHandle<float>(prefix + "_ex999", 0.0f);
+	exmax   = table->getHandle<float>(prefix + "_exmax", 0.0f);
+
+	lat50   = table->getHandle<float>(prefix + "_lat50", 0.0f);
+	lat99   = table->getHandle<float>(prefix + "_lat99", 0.0f);
+	lat999  = table->getHandle<float>(prefix + "_lat999", 0.0f);
+	latmax  = table->getHandle<float>(prefix + "_latmax", 0.0f);
+
+	per99   = table->getHandle<float>(prefix + "_per99", 0.0f);
+	permax  = table->getHandle<float>(prefix + "_permax", 0.0f);
+
+	cycles  = table->getHandle<uint32_t>(prefix + "_cycles", 0);
+	overrun = table->getHandle<uint32_t>(prefix + "_overrun", 0);
+	skipped = table->getHandle<uint32_t>(prefix + "_skipped", 0);
+}
+
+/*******************************************************************************
+ *
+ * Copy the thread's current statistics into the table.
+ *
+ ******************************************************************************/
+void UdpValueTableThreadStats::publish(bool do_send)
+{
+	gsi::TimingHistogram &ex = stats_thread->getExecutionHistogram();
+	gsi::TimingHistogram &lat = stats_thread->getLatencyHistogram();
+	gsi::TimingHistogram &per = stats_thread->getPeriodErrorHistogram();
+
+	ex50.put((float)(ex.getPercentile(50.0) * 1000.0), do_send);
+	ex99.put((float)(ex.getPercentile(99.0) * 1000.0), do_send);
+	ex999.put((float)(ex.getPercentile(99.9) * 1000.0), do_send);
+	exmax.put((float)(ex.getMax() * 1000.0), do_send);
+
+	lat50.put((float)(lat.getPercentile(50.0) * 1000.0), do_send);
+	lat99.put((float)(lat.getPercentile(99.0) * 1000.0), do_send);
+	lat999.put((float)(lat.getPercentile(99.9) * 1000.0), do_send);
+	latmax.put((float)(lat.getMax() * 1000.0), do_send);
+
+	per99.put((float)(per.getPercentile(99.0) * 1000.0), do_send);
+	permax.put((float)(per.getMax() * 1000.0), do_send);
+
+	cycles.put(stats_thread->getCycleCount(), do_send);
+	overrun.put(stats_thread->getOverrunCount(), do_send);
+	skipped.put(stats_thread->getSkippedCount(), do_send);
+}
+
+} // namespace gsu